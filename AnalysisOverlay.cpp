@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstdio>
+#include "AnalysisOverlay.hpp"
+
+namespace
+{
+    constexpr int PanelPadding = 6;
+    constexpr int MaxPvMoves = 8; // longer lines don't fit across the board
+
+    std::string formatScore(int score)
+    {
+        char text[16];
+        if (isMateScore(score))
+        {
+            int plies = MateScore - (score > 0 ? score : -score);
+            std::snprintf(text, sizeof(text), "%sM%d", score > 0 ? "" : "-", (plies + 1) / 2);
+        }
+        else
+        {
+            std::snprintf(text, sizeof(text), "%+.2f", score / 100.0);
+        }
+        return text;
+    }
+}
+
+AnalysisOverlay::AnalysisOverlay(SDL_Renderer *renderer, TTF_Font *font, int x, int y) : m_renderer(renderer), m_font(font), m_x(x), m_y(y)
+{
+}
+
+AnalysisOverlay::~AnalysisOverlay()
+{
+    clear();
+}
+
+void AnalysisOverlay::clear()
+{
+    for (auto texture : m_lineTextures)
+    {
+        SDL_DestroyTexture(texture);
+    }
+    m_lineTextures.clear();
+    m_lineRects.clear();
+}
+
+void AnalysisOverlay::update(const SearchResult &result, Color sideToMove)
+{
+    std::vector<std::string> lines;
+
+    char header[64];
+    std::snprintf(header, sizeof(header), "depth %d  nodes %llu", result.depth, static_cast<unsigned long long>(result.nodes));
+    lines.push_back(header);
+
+    for (const PvLine &line : result.lines)
+    {
+        int whiteScore = (sideToMove == Color::White) ? line.score : -line.score;
+        std::string text = formatScore(whiteScore) + " ";
+        for (size_t i = 0; i < line.pv.size() && i < MaxPvMoves; i++)
+        {
+            text += " " + moveToString(line.pv[i]);
+        }
+        lines.push_back(text);
+    }
+
+    setLines(lines);
+}
+
+void AnalysisOverlay::setLines(const std::vector<std::string> &lines)
+{
+    clear();
+    if (!m_font)
+    {
+        return;
+    }
+
+    SDL_Color textColor = {0xff, 0xff, 0xff, 0xff};
+    int y = m_y + PanelPadding;
+
+    for (const auto &line : lines)
+    {
+        SDL_Surface *surface = TTF_RenderText_Blended(m_font, line.c_str(), textColor);
+        if (!surface)
+        {
+            continue;
+        }
+        m_lineTextures.push_back(SDL_CreateTextureFromSurface(m_renderer, surface));
+        m_lineRects.push_back({m_x + PanelPadding, y, surface->w, surface->h});
+        y += surface->h;
+        SDL_FreeSurface(surface);
+    }
+}
+
+SDL_Rect AnalysisOverlay::bounds() const
+{
+    if (m_lineRects.empty())
+    {
+        return {m_x, m_y, 0, 0};
+    }
+
+    int width = 0;
+    for (const auto &rect : m_lineRects)
+    {
+        width = std::max(width, rect.w);
+    }
+    const SDL_Rect &last = m_lineRects.back();
+    return {m_x, m_y, width + 2 * PanelPadding, last.y + last.h + PanelPadding - m_y};
+}
+
+void AnalysisOverlay::render()
+{
+    if (m_lineTextures.empty())
+    {
+        return;
+    }
+
+    SDL_Rect panel = bounds();
+
+    SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(m_renderer, 0x00, 0x00, 0x00, 0xb0);
+    SDL_RenderFillRect(m_renderer, &panel);
+    SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_NONE);
+
+    for (size_t i = 0; i < m_lineTextures.size(); i++)
+    {
+        SDL_RenderCopy(m_renderer, m_lineTextures[i], nullptr, &m_lineRects[i]);
+    }
+}
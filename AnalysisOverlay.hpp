@@ -0,0 +1,37 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string>
+#include <vector>
+#include "Search.hpp"
+
+// Translucent text panel drawn on top of the board: the analysis engine's candidate lines, or
+// any other short list such as the opening explorer's moves. Text is only rasterised when the
+// content changes; render() just blits cached textures, so drawing a frame never waits on the
+// search.
+class AnalysisOverlay
+{
+public:
+    AnalysisOverlay(SDL_Renderer *renderer, TTF_Font *font, int x = 10, int y = 10);
+    ~AnalysisOverlay();
+
+    AnalysisOverlay(const AnalysisOverlay &) = delete;
+    AnalysisOverlay &operator=(const AnalysisOverlay &) = delete;
+
+    // Scores are shown from White's point of view
+    void update(const SearchResult &result, Color sideToMove);
+    void setLines(const std::vector<std::string> &lines);
+    void clear();
+    void render();
+    // Area the panel covers, empty when there is nothing to show
+    SDL_Rect bounds() const;
+
+private:
+    SDL_Renderer *m_renderer;
+    TTF_Font *m_font;
+    int m_x;
+    int m_y;
+    std::vector<SDL_Texture *> m_lineTextures;
+    std::vector<SDL_Rect> m_lineRects;
+};
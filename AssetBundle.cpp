@@ -0,0 +1,170 @@
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include "AssetBundle.hpp"
+#include "Trace.hpp"
+
+AssetBundle::~AssetBundle()
+{
+    if (m_data)
+    {
+        munmap(const_cast<unsigned char *>(m_data), m_size);
+    }
+}
+
+bool AssetBundle::Open(const std::string &path)
+{
+    TRACE_ZONE("AssetBundle::Open");
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open asset bundle: " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(BundleHeader))
+    {
+        std::cerr << "Asset bundle is truncated: " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Failed to map asset bundle: " << path << std::endl;
+        return false;
+    }
+
+    // Everything gets touched during startup decoding anyway
+    madvise(mapping, info.st_size, MADV_WILLNEED);
+
+    m_data = static_cast<const unsigned char *>(mapping);
+    m_size = info.st_size;
+
+    const BundleHeader *header = reinterpret_cast<const BundleHeader *>(m_data);
+    if (std::memcmp(header->magic, BundleMagic, sizeof(BundleMagic)) != 0 || header->version != BundleVersion ||
+        sizeof(BundleHeader) + static_cast<size_t>(header->entryCount) * sizeof(BundleEntry) > m_size)
+    {
+        std::cerr << "Not a valid asset bundle: " << path << std::endl;
+        return false;
+    }
+
+    m_entries = reinterpret_cast<const BundleEntry *>(m_data + sizeof(BundleHeader));
+    m_entryCount = header->entryCount;
+    return true;
+}
+
+const BundleEntry *AssetBundle::Find(const std::string &name) const
+{
+    const BundleEntry *end = m_entries + m_entryCount;
+    const BundleEntry *it = std::lower_bound(m_entries, end, name, [](const BundleEntry &entry, const std::string &key)
+                                             { return std::strncmp(entry.name, key.c_str(), BundleNameLength) < 0; });
+
+    if (it == end || std::strncmp(it->name, name.c_str(), BundleNameLength) != 0 || it->offset + it->size > m_size)
+    {
+        return nullptr;
+    }
+    return it;
+}
+
+const void *AssetBundle::Data(const std::string &name, size_t &size) const
+{
+    const BundleEntry *entry = Find(name);
+    if (!entry)
+    {
+        size = 0;
+        return nullptr;
+    }
+    size = entry->size;
+    return m_data + entry->offset;
+}
+
+SDL_RWops *AssetBundle::OpenRW(const std::string &name) const
+{
+    size_t size;
+    const void *data = Data(name, size);
+    if (!data)
+    {
+        std::cerr << "Asset missing from bundle: " << name << std::endl;
+        return nullptr;
+    }
+    return SDL_RWFromConstMem(data, static_cast<int>(size));
+}
+
+void AssetBundle::DecodeParallel(const std::vector<std::string> &imageNames, std::vector<SDL_Surface *> &images,
+                                 const std::vector<std::string> &soundNames, std::vector<Mix_Chunk *> &sounds) const
+{
+    TRACE_ZONE("AssetBundle::DecodeParallel");
+    images.assign(imageNames.size(), nullptr);
+    sounds.assign(soundNames.size(), nullptr);
+
+    // Jobs [0, images) decode images, the rest decode sounds; workers pull the next index
+    size_t jobCount = imageNames.size() + soundNames.size();
+    std::atomic<size_t> nextJob{0};
+
+    auto worker = [&]()
+    {
+        for (size_t job = nextJob++; job < jobCount; job = nextJob++)
+        {
+            TRACE_ZONE(job < imageNames.size() ? "decodeImage" : "decodeSound");
+            if (job < imageNames.size())
+            {
+                SDL_RWops *rw = OpenRW(imageNames[job]);
+                images[job] = rw ? IMG_Load_RW(rw, 1) : nullptr;
+                if (rw && !images[job])
+                {
+                    std::cerr << "Failed to decode image " << imageNames[job] << ": " << IMG_GetError() << std::endl;
+                }
+            }
+            else
+            {
+                size_t index = job - imageNames.size();
+                SDL_RWops *rw = OpenRW(soundNames[index]);
+                sounds[index] = rw ? Mix_LoadWAV_RW(rw, 1) : nullptr;
+                if (rw && !sounds[index])
+                {
+                    std::cerr << "Failed to decode sound " << soundNames[index] << ": " << Mix_GetError() << std::endl;
+                }
+            }
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), jobCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++)
+    {
+        workers.emplace_back(worker);
+    }
+    worker(); // the calling thread helps out instead of idling
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+}
+
+std::string ExecutableDirectory()
+{
+    std::string path;
+    char *basePath = SDL_GetBasePath();
+    if (basePath)
+    {
+        path = basePath;
+        SDL_free(basePath);
+    }
+    return path;
+}
+
+std::string DefaultBundlePath()
+{
+    return ExecutableDirectory() + "assets.pak";
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <string>
+#include <vector>
+#include "AssetBundleFormat.hpp"
+
+// Read-only view of the packed asset bundle. The whole file is mmapped once; lookups hand out
+// pointers straight into the mapping, so the bundle must outlive anything opened from it
+// (fonts opened through OpenRW keep reading from it).
+class AssetBundle
+{
+public:
+    AssetBundle() = default;
+    ~AssetBundle();
+
+    AssetBundle(const AssetBundle &) = delete;
+    AssetBundle &operator=(const AssetBundle &) = delete;
+
+    bool Open(const std::string &path);
+
+    // Returns the payload of an asset, or nullptr if the bundle doesn't contain it
+    const void *Data(const std::string &name, size_t &size) const;
+
+    // SDL stream over an asset's bytes; nullptr if missing
+    SDL_RWops *OpenRW(const std::string &name) const;
+
+    // Decodes the requested images and sounds on worker threads. Results line up with the
+    // requested names and are nullptr for assets that failed to decode. Textures still have
+    // to be created from the surfaces on the render thread.
+    void DecodeParallel(const std::vector<std::string> &imageNames, std::vector<SDL_Surface *> &images,
+                        const std::vector<std::string> &soundNames, std::vector<Mix_Chunk *> &sounds) const;
+
+private:
+    const BundleEntry *Find(const std::string &name) const;
+
+    const unsigned char *m_data = nullptr;
+    size_t m_size = 0;
+    const BundleEntry *m_entries = nullptr;
+    uint32_t m_entryCount = 0;
+};
+
+// Directory holding the executable, with a trailing separator; data files live next to it
+// so the game doesn't depend on the working directory
+std::string ExecutableDirectory();
+
+// Location of the bundle next to the executable
+std::string DefaultBundlePath();
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of the packed asset bundle written by tools/pack_assets.cpp.
+//
+//   BundleHeader
+//   BundleEntry[entryCount]   sorted by name so lookups can binary search
+//   payloads                  each one aligned to BundleAlignment
+//
+// All integers are little endian; offsets are from the start of the file.
+
+constexpr char BundleMagic[8] = {'C', 'H', 'E', 'S', 'S', 'P', 'A', 'K'};
+constexpr uint32_t BundleVersion = 1;
+constexpr uint32_t BundleAlignment = 16;
+constexpr int BundleNameLength = 48;
+
+struct BundleHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+};
+
+struct BundleEntry
+{
+    char name[BundleNameLength]; // path relative to the repo root, e.g. "textures/White_King.png", NUL padded
+    uint64_t offset;
+    uint64_t size;
+};
+
+static_assert(sizeof(BundleHeader) == 16, "bundle header must stay packed");
+static_assert(sizeof(BundleEntry) == 64, "bundle entry must stay packed");
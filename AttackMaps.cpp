@@ -0,0 +1,318 @@
+#include <cstdlib>
+#include "AttackMaps.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr uint64_t NotFileA = ~0x0101010101010101ull; // x == 0
+    constexpr uint64_t NotFileH = ~0x8080808080808080ull; // x == 7
+    constexpr uint64_t NotFilesAB = ~0x0303030303030303ull;
+    constexpr uint64_t NotFilesGH = ~0xc0c0c0c0c0c0c0c0ull;
+
+    // One step along a ray: a positive shift moves to higher squares (towards rank 1), a negative
+    // one to lower squares; mask drops the squares a step would wrap onto the other edge
+    struct Direction
+    {
+        int shift;
+        uint64_t mask;
+    };
+
+    constexpr Direction Diagonals[4] = {{9, NotFileA}, {7, NotFileH}, {-9, NotFileH}, {-7, NotFileA}};
+    constexpr Direction Orthogonals[4] = {{1, NotFileA}, {8, ~0ull}, {-1, NotFileH}, {-8, ~0ull}};
+
+    // What each colour's sliders attack, filled in by one of the kernels below
+    struct SliderAttacks
+    {
+        uint64_t bishops;
+        uint64_t rooks;
+        uint64_t queens;
+    };
+
+    uint64_t shifted(uint64_t squares, int shift)
+    {
+        return shift > 0 ? squares << shift : squares >> -shift;
+    }
+
+    uint64_t step(uint64_t squares, const Direction &direction)
+    {
+        return shifted(squares, direction.shift) & direction.mask;
+    }
+
+    int troop(Troops type)
+    {
+        return static_cast<int>(type);
+    }
+
+#if defined(__AVX2__)
+    // Four directions that all shift the same way, one per lane: two diagonals then two
+    // orthogonals, so the lanes can carry bishops, bishops, rooks, rooks or queens in all four
+    struct DirectionLanes
+    {
+        __m256i counts[3]; // for the 1-, 2- and 4-square steps of the fill
+        __m256i mask;
+    };
+
+    DirectionLanes makeLanes(const Direction &a, const Direction &b, const Direction &c, const Direction &d)
+    {
+        DirectionLanes lanes;
+        for (int i = 0; i < 3; i++)
+        {
+            lanes.counts[i] = _mm256_setr_epi64x(std::abs(a.shift) << i, std::abs(b.shift) << i, std::abs(c.shift) << i, std::abs(d.shift) << i);
+        }
+        lanes.mask = _mm256_setr_epi64x(static_cast<int64_t>(a.mask), static_cast<int64_t>(b.mask), static_cast<int64_t>(c.mask),
+                                        static_cast<int64_t>(d.mask));
+        return lanes;
+    }
+
+    const DirectionLanes UpLanes = makeLanes(Diagonals[0], Diagonals[1], Orthogonals[0], Orthogonals[1]);
+    const DirectionLanes DownLanes = makeLanes(Diagonals[2], Diagonals[3], Orthogonals[2], Orthogonals[3]);
+
+    template <bool Up>
+    __m256i shiftLanes(__m256i squares, __m256i counts)
+    {
+        return Up ? _mm256_sllv_epi64(squares, counts) : _mm256_srlv_epi64(squares, counts);
+    }
+
+    // The squares each lane's generators reach along its direction, up to and including the
+    // first piece in the way
+    template <bool Up>
+    __m256i slide(__m256i gen, __m256i empty, const DirectionLanes &lanes)
+    {
+        __m256i pro = _mm256_and_si256(empty, lanes.mask);
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shiftLanes<Up>(gen, lanes.counts[0])));
+        pro = _mm256_and_si256(pro, shiftLanes<Up>(pro, lanes.counts[0]));
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shiftLanes<Up>(gen, lanes.counts[1])));
+        pro = _mm256_and_si256(pro, shiftLanes<Up>(pro, lanes.counts[1]));
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shiftLanes<Up>(gen, lanes.counts[2])));
+        return _mm256_and_si256(shiftLanes<Up>(gen, lanes.counts[0]), lanes.mask);
+    }
+
+    void slideAll(const uint64_t pieces[2][EvalParams::PieceTypes], uint64_t empty, SliderAttacks attacks[2])
+    {
+        const __m256i emptyLanes = _mm256_set1_epi64x(static_cast<int64_t>(empty));
+        for (int color = 0; color < 2; color++)
+        {
+            int64_t bishops = static_cast<int64_t>(pieces[color][troop(Troops::Bishop)]);
+            int64_t rooks = static_cast<int64_t>(pieces[color][troop(Troops::Rook)]);
+            __m256i bishopsAndRooks = _mm256_setr_epi64x(bishops, bishops, rooks, rooks);
+            __m256i queens = _mm256_set1_epi64x(static_cast<int64_t>(pieces[color][troop(Troops::Queen)]));
+
+            __m256i pieceRays = _mm256_or_si256(slide<true>(bishopsAndRooks, emptyLanes, UpLanes), slide<false>(bishopsAndRooks, emptyLanes, DownLanes));
+            __m256i queenRays = _mm256_or_si256(slide<true>(queens, emptyLanes, UpLanes), slide<false>(queens, emptyLanes, DownLanes));
+
+            // Fold the lane pairs: bishops end up in lane 0, rooks in lane 2
+            pieceRays = _mm256_or_si256(pieceRays, _mm256_shuffle_epi32(pieceRays, 0x4e));
+            __m128i queenHalf = _mm_or_si128(_mm256_castsi256_si128(queenRays), _mm256_extracti128_si256(queenRays, 1));
+            queenHalf = _mm_or_si128(queenHalf, _mm_unpackhi_epi64(queenHalf, queenHalf));
+
+            attacks[color].bishops = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm256_castsi256_si128(pieceRays)));
+            attacks[color].rooks = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm256_extracti128_si256(pieceRays, 1)));
+            attacks[color].queens = static_cast<uint64_t>(_mm_cvtsi128_si64(queenHalf));
+        }
+    }
+#elif defined(__SSE2__)
+    // SSE2 only shifts both lanes by the same count, so the lanes hold the two colours and each
+    // direction gets its own immediate shift
+    template <int Shift>
+    __m128i shiftLanes(__m128i squares)
+    {
+        if constexpr (Shift > 0)
+        {
+            return _mm_slli_epi64(squares, Shift);
+        }
+        else
+        {
+            return _mm_srli_epi64(squares, -Shift);
+        }
+    }
+
+    template <int Shift>
+    __m128i slide(__m128i gen, __m128i empty, uint64_t edgeMask)
+    {
+        const __m128i mask = _mm_set1_epi64x(static_cast<int64_t>(edgeMask));
+        __m128i pro = _mm_and_si128(empty, mask);
+        gen = _mm_or_si128(gen, _mm_and_si128(pro, shiftLanes<Shift>(gen)));
+        pro = _mm_and_si128(pro, shiftLanes<Shift>(pro));
+        gen = _mm_or_si128(gen, _mm_and_si128(pro, shiftLanes<Shift * 2>(gen)));
+        pro = _mm_and_si128(pro, shiftLanes<Shift * 2>(pro));
+        gen = _mm_or_si128(gen, _mm_and_si128(pro, shiftLanes<Shift * 4>(gen)));
+        return _mm_and_si128(shiftLanes<Shift>(gen), mask);
+    }
+
+    __m128i slideDiagonals(__m128i gen, __m128i empty)
+    {
+        return _mm_or_si128(_mm_or_si128(slide<9>(gen, empty, NotFileA), slide<7>(gen, empty, NotFileH)),
+                            _mm_or_si128(slide<-9>(gen, empty, NotFileH), slide<-7>(gen, empty, NotFileA)));
+    }
+
+    __m128i slideOrthogonals(__m128i gen, __m128i empty)
+    {
+        return _mm_or_si128(_mm_or_si128(slide<1>(gen, empty, NotFileA), slide<8>(gen, empty, ~0ull)),
+                            _mm_or_si128(slide<-1>(gen, empty, NotFileH), slide<-8>(gen, empty, ~0ull)));
+    }
+
+    __m128i bothColors(const uint64_t pieces[2][EvalParams::PieceTypes], Troops type)
+    {
+        return _mm_set_epi64x(static_cast<int64_t>(pieces[1][troop(type)]), static_cast<int64_t>(pieces[0][troop(type)]));
+    }
+
+    void slideAll(const uint64_t pieces[2][EvalParams::PieceTypes], uint64_t empty, SliderAttacks attacks[2])
+    {
+        const __m128i emptyLanes = _mm_set1_epi64x(static_cast<int64_t>(empty));
+        __m128i queens = bothColors(pieces, Troops::Queen);
+        __m128i bishopRays = slideDiagonals(bothColors(pieces, Troops::Bishop), emptyLanes);
+        __m128i rookRays = slideOrthogonals(bothColors(pieces, Troops::Rook), emptyLanes);
+        __m128i queenRays = _mm_or_si128(slideDiagonals(queens, emptyLanes), slideOrthogonals(queens, emptyLanes));
+
+        attacks[0] = {static_cast<uint64_t>(_mm_cvtsi128_si64(bishopRays)), static_cast<uint64_t>(_mm_cvtsi128_si64(rookRays)),
+                      static_cast<uint64_t>(_mm_cvtsi128_si64(queenRays))};
+        attacks[1] = {static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(bishopRays, bishopRays))),
+                      static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(rookRays, rookRays))),
+                      static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(queenRays, queenRays)))};
+    }
+#else
+    uint64_t slide(uint64_t gen, uint64_t empty, const Direction &direction)
+    {
+        uint64_t pro = empty & direction.mask;
+        gen |= pro & shifted(gen, direction.shift);
+        pro &= shifted(pro, direction.shift);
+        gen |= pro & shifted(gen, direction.shift * 2);
+        pro &= shifted(pro, direction.shift * 2);
+        gen |= pro & shifted(gen, direction.shift * 4);
+        return step(gen, direction);
+    }
+
+    uint64_t slideAlong(uint64_t gen, uint64_t empty, const Direction (&directions)[4])
+    {
+        uint64_t attacks = 0;
+        for (int i = 0; gen && i < 4; i++)
+        {
+            attacks |= slide(gen, empty, directions[i]);
+        }
+        return attacks;
+    }
+
+    void slideAll(const uint64_t pieces[2][EvalParams::PieceTypes], uint64_t empty, SliderAttacks attacks[2])
+    {
+        for (int color = 0; color < 2; color++)
+        {
+            uint64_t queens = pieces[color][troop(Troops::Queen)];
+            attacks[color].bishops = slideAlong(pieces[color][troop(Troops::Bishop)], empty, Diagonals);
+            attacks[color].rooks = slideAlong(pieces[color][troop(Troops::Rook)], empty, Orthogonals);
+            attacks[color].queens = slideAlong(queens, empty, Diagonals) | slideAlong(queens, empty, Orthogonals);
+        }
+    }
+#endif
+
+    uint64_t kingAttacks(uint64_t kings)
+    {
+        uint64_t attacks = 0;
+        for (const Direction &direction : Diagonals)
+        {
+            attacks |= step(kings, direction);
+        }
+        for (const Direction &direction : Orthogonals)
+        {
+            attacks |= step(kings, direction);
+        }
+        return attacks;
+    }
+
+    uint64_t knightAttacks(uint64_t knights)
+    {
+        return ((knights << 17) & NotFileA) | ((knights << 15) & NotFileH) | ((knights << 10) & NotFilesAB) | ((knights << 6) & NotFilesGH) |
+               ((knights >> 17) & NotFileH) | ((knights >> 15) & NotFileA) | ((knights >> 10) & NotFilesGH) | ((knights >> 6) & NotFilesAB);
+    }
+
+    // White pawns move towards row 0, Black pawns towards row 7
+    uint64_t pawnAttacks(Color color, uint64_t pawns)
+    {
+        if (color == Color::White)
+        {
+            return ((pawns >> 9) & NotFileH) | ((pawns >> 7) & NotFileA);
+        }
+        return ((pawns << 7) & NotFileH) | ((pawns << 9) & NotFileA);
+    }
+}
+
+void computeAttackMaps(const uint64_t pieces[2][EvalParams::PieceTypes], AttackMaps &maps)
+{
+    uint64_t occupied = 0;
+    for (int color = 0; color < 2; color++)
+    {
+        for (int type = 0; type < EvalParams::PieceTypes; type++)
+        {
+            occupied |= pieces[color][type];
+        }
+    }
+
+    SliderAttacks sliding[2];
+    slideAll(pieces, ~occupied, sliding);
+
+    for (int color = 0; color < 2; color++)
+    {
+        uint64_t *byTroop = maps.byTroop[color];
+        byTroop[troop(Troops::Bishop)] = sliding[color].bishops;
+        byTroop[troop(Troops::Knight)] = knightAttacks(pieces[color][troop(Troops::Knight)]);
+        byTroop[troop(Troops::Rook)] = sliding[color].rooks;
+        byTroop[troop(Troops::King)] = kingAttacks(pieces[color][troop(Troops::King)]);
+        byTroop[troop(Troops::Queen)] = sliding[color].queens;
+        byTroop[troop(Troops::Pawn)] = pawnAttacks(static_cast<Color>(color), pieces[color][troop(Troops::Pawn)]);
+
+        maps.all[color] = 0;
+        for (int type = 0; type < EvalParams::PieceTypes; type++)
+        {
+            maps.all[color] |= byTroop[type];
+        }
+    }
+}
+
+void countAttackTerms(const uint64_t pieces[2][EvalParams::PieceTypes], const AttackMaps &maps, int counts[2][EvalParams::AttackTermCount])
+{
+    const Troops mobilityTroops[] = {Troops::Bishop, Troops::Knight, Troops::Rook, Troops::Queen};
+    const EvalParams::AttackTerm mobilityTerms[] = {EvalParams::BishopMobility, EvalParams::KnightMobility, EvalParams::RookMobility,
+                                                    EvalParams::QueenMobility};
+
+    for (int us = 0; us < 2; us++)
+    {
+        int them = us ^ 1;
+        uint64_t own = 0;
+        for (int type = 0; type < EvalParams::PieceTypes; type++)
+        {
+            own |= pieces[us][type];
+        }
+
+        // Squares worth counting: not blocked by our own pieces and not covered by an enemy pawn.
+        // The maps are per piece type, so two knights reaching the same square count it once.
+        uint64_t mobilityArea = ~own & ~maps.byTroop[them][troop(Troops::Pawn)];
+        uint64_t pieceAttacks = 0;
+        uint64_t minorsAndMajors = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            uint64_t attacks = maps.byTroop[us][troop(mobilityTroops[i])];
+            counts[us][mobilityTerms[i]] = __builtin_popcountll(attacks & mobilityArea);
+            pieceAttacks |= attacks;
+            minorsAndMajors |= pieces[us][troop(mobilityTroops[i])];
+        }
+
+        uint64_t theirKing = pieces[them][troop(Troops::King)];
+        counts[us][EvalParams::KingZoneAttack] = __builtin_popcountll(pieceAttacks & (theirKing | kingAttacks(theirKing)));
+        counts[us][EvalParams::HangingPiece] = __builtin_popcountll(minorsAndMajors & maps.all[them] & ~maps.all[us]);
+    }
+}
+
+const char *attackKernelName()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
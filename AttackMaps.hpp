@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include "EvalParams.hpp"
+
+// Attack maps for the evaluation: every square each side attacks, by piece type, for the whole
+// board at once instead of square by square through move generation. Sliders use Kogge-Stone
+// fills, which spread all of a side's bishops, rooks or queens along one direction in three
+// shift-and-mask steps however many there are; the kernels run several directions side by side
+// in vector registers. Bitboards use bit y * 8 + x, rank 8 first, like the board; arrays are
+// indexed by static_cast<int>(Color) and static_cast<int>(Troops).
+
+struct AttackMaps
+{
+    uint64_t byTroop[2][EvalParams::PieceTypes]; // squares each colour's pieces of each type attack
+    uint64_t all[2];                             // squares each colour attacks at all
+};
+
+// pieces[color][troop] holds the squares each colour's pieces of each type stand on
+void computeAttackMaps(const uint64_t pieces[2][EvalParams::PieceTypes], AttackMaps &maps);
+
+// Counts the attack terms (mobility, king-zone attacks, hanging pieces) each colour earns;
+// counts is indexed by colour and EvalParams::AttackTerm. The evaluation and the tuner share it
+// so they agree on the features.
+void countAttackTerms(const uint64_t pieces[2][EvalParams::PieceTypes], const AttackMaps &maps, int counts[2][EvalParams::AttackTermCount]);
+
+// Which fill kernel this build uses: "avx2", "sse2" or "scalar"
+const char *attackKernelName();
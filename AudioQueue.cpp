@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdlib>
+#include "AudioQueue.hpp"
+#include "Trace.hpp"
+
+AudioQueue::AudioQueue(int channels) : m_channelCount(std::min(std::max(channels, 1), 32))
+{
+}
+
+AudioQueue::~AudioQueue()
+{
+    stop();
+}
+
+void AudioQueue::setSound(SoundEvent event, Sound *sound)
+{
+    m_sounds[static_cast<int>(event)] = sound;
+}
+
+void AudioQueue::start()
+{
+    stop();
+    Mix_AllocateChannels(m_channelCount);
+    m_running = true;
+    m_thread = std::thread(&AudioQueue::run, this);
+}
+
+void AudioQueue::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void AudioQueue::post(SoundEvent event)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running || m_count == RingSize)
+        {
+            return;
+        }
+        m_ring[(m_head + m_count) % RingSize] = event;
+        m_count++;
+    }
+    m_wake.notify_one();
+}
+
+void AudioQueue::run()
+{
+    Trace::setThreadName("audio");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]()
+                    { return m_count > 0 || !m_running; });
+        if (m_count == 0)
+        {
+            return;
+        }
+        SoundEvent event = m_ring[m_head];
+        m_head = (m_head + 1) % RingSize;
+        m_count--;
+
+        // The mixer takes its own lock, so play without holding ours
+        lock.unlock();
+        dispatch(event);
+        lock.lock();
+    }
+}
+
+// A free channel if there is one, otherwise the one playing the least important sound, the
+// longest playing of those. Sound::play halts whatever the channel was playing first.
+void AudioQueue::dispatch(SoundEvent event)
+{
+    Sound *sound = m_sounds[static_cast<int>(event)];
+    if (!sound)
+    {
+        return;
+    }
+
+    int channel = -1;
+    for (int i = 0; i < m_channelCount; i++)
+    {
+        if (!Mix_Playing(i))
+        {
+            channel = i;
+            break;
+        }
+        if (channel < 0 || m_voices[i].event < m_voices[channel].event ||
+            (m_voices[i].event == m_voices[channel].event && m_voices[i].started < m_voices[channel].started))
+        {
+            channel = i;
+        }
+    }
+
+    m_voices[channel].event = event;
+    m_voices[channel].started = m_dispatched++;
+    sound->play(channel);
+}
+
+int audioBufferSize()
+{
+    if (const char *value = std::getenv("CHESS_AUDIO_BUFFER"))
+    {
+        int frames = std::atoi(value);
+        if (frames >= 128 && frames <= 8192 && (frames & (frames - 1)) == 0)
+        {
+            return frames;
+        }
+    }
+    return 512;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "Sound.hpp"
+
+// Game sounds, in rising priority: when every channel is busy a new sound takes over the
+// channel of the least important one playing
+enum class SoundEvent : uint8_t
+{
+    Move,
+    Capture,
+    Promote,
+    Check,
+    GameStart,
+    GameEnd,
+    Count
+};
+
+// Plays game sounds off the main thread. Gameplay code posts events, which only appends to a
+// small ring and wakes the dispatch thread; that thread starts each sound on a free channel of
+// its pool, or steals one. Only the GUI's own moves post here, never the engine's searches.
+//
+// Mix_OpenAudio has to succeed before start(); the sounds must outlive the queue.
+class AudioQueue
+{
+public:
+    explicit AudioQueue(int channels = 8);
+    ~AudioQueue();
+
+    AudioQueue(const AudioQueue &) = delete;
+    AudioQueue &operator=(const AudioQueue &) = delete;
+
+    // Sound played for event; nullptr keeps it silent
+    void setSound(SoundEvent event, Sound *sound);
+
+    // Allocates the channel pool and starts the dispatch thread
+    void start();
+    // Finishes the events already posted and joins the thread
+    void stop();
+
+    // Never blocks on the mixer; drops the event if the ring is full
+    void post(SoundEvent event);
+
+private:
+    static constexpr int RingSize = 16;
+
+    struct Voice
+    {
+        SoundEvent event = SoundEvent::Move;
+        uint64_t started = 0; // dispatch order, to steal the oldest of equals
+    };
+
+    void run();
+    void dispatch(SoundEvent event);
+
+    std::array<Sound *, static_cast<int>(SoundEvent::Count)> m_sounds = {};
+    int m_channelCount;
+    Voice m_voices[32];
+    uint64_t m_dispatched = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    SoundEvent m_ring[RingSize];
+    int m_head = 0; // next event to dispatch
+    int m_count = 0;
+    bool m_running = false;
+    std::thread m_thread;
+};
+
+// Mixer buffer in sample frames: CHESS_AUDIO_BUFFER when set to a power of two from 128 to
+// 8192, otherwise 512, about 12 ms at 44.1 kHz
+int audioBufferSize();
@@ -0,0 +1,192 @@
+#include <fstream>
+#include <iostream>
+#include "EvalParams.hpp"
+
+namespace
+{
+    const char *const TableNames[EvalParams::PieceTypes] = {"bishop", "knight", "rook", "king", "queen", "pawn"};
+
+    const EvalParams Defaults = {
+        // Bishop, Knight, Rook, King, Queen, Pawn
+        {330, 320, 500, 0, 900, 100},
+        {
+            // Bishop
+            {-20, -10, -10, -10, -10, -10, -10, -20,
+             -10, 0, 0, 0, 0, 0, 0, -10,
+             -10, 0, 5, 10, 10, 5, 0, -10,
+             -10, 5, 5, 10, 10, 5, 5, -10,
+             -10, 0, 10, 10, 10, 10, 0, -10,
+             -10, 10, 10, 10, 10, 10, 10, -10,
+             -10, 5, 0, 0, 0, 0, 5, -10,
+             -20, -10, -10, -10, -10, -10, -10, -20},
+            // Knight
+            {-50, -40, -30, -30, -30, -30, -40, -50,
+             -40, -20, 0, 0, 0, 0, -20, -40,
+             -30, 0, 10, 15, 15, 10, 0, -30,
+             -30, 5, 15, 20, 20, 15, 5, -30,
+             -30, 0, 15, 20, 20, 15, 0, -30,
+             -30, 5, 10, 15, 15, 10, 5, -30,
+             -40, -20, 0, 5, 5, 0, -20, -40,
+             -50, -40, -30, -30, -30, -30, -40, -50},
+            // Rook
+            {0, 0, 0, 0, 0, 0, 0, 0,
+             5, 10, 10, 10, 10, 10, 10, 5,
+             -5, 0, 0, 0, 0, 0, 0, -5,
+             -5, 0, 0, 0, 0, 0, 0, -5,
+             -5, 0, 0, 0, 0, 0, 0, -5,
+             -5, 0, 0, 0, 0, 0, 0, -5,
+             -5, 0, 0, 0, 0, 0, 0, -5,
+             0, 0, 0, 5, 5, 0, 0, 0},
+            // King
+            {-30, -40, -40, -50, -50, -40, -40, -30,
+             -30, -40, -40, -50, -50, -40, -40, -30,
+             -30, -40, -40, -50, -50, -40, -40, -30,
+             -30, -40, -40, -50, -50, -40, -40, -30,
+             -20, -30, -30, -40, -40, -30, -30, -20,
+             -10, -20, -20, -20, -20, -20, -20, -10,
+             20, 20, 0, 0, 0, 0, 20, 20,
+             20, 30, 10, 0, 0, 10, 30, 20},
+            // Queen
+            {-20, -10, -10, -5, -5, -10, -10, -20,
+             -10, 0, 0, 0, 0, 0, 0, -10,
+             -10, 0, 5, 5, 5, 5, 0, -10,
+             -5, 0, 5, 5, 5, 5, 0, -5,
+             0, 0, 5, 5, 5, 5, 0, -5,
+             -10, 5, 5, 5, 5, 5, 0, -10,
+             -10, 0, 5, 0, 0, 0, 0, -10,
+             -20, -10, -10, -5, -5, -10, -10, -20},
+            // Pawn
+            {0, 0, 0, 0, 0, 0, 0, 0,
+             50, 50, 50, 50, 50, 50, 50, 50,
+             10, 10, 20, 30, 30, 20, 10, 10,
+             5, 5, 10, 25, 25, 10, 5, 5,
+             0, 0, 0, 20, 20, 0, 0, 0,
+             5, -5, -10, 0, 0, -10, -5, 5,
+             5, 10, 10, -20, -20, 10, 10, 5,
+             0, 0, 0, 0, 0, 0, 0, 0},
+        },
+        // Doubled, isolated, backward, rook on open / half-open file, king on open / half-open
+        // file, then passed pawns by rank from their own side
+        {-10, -12, -8, 25, 12, -20, -10,
+         0, 5, 10, 20, 35, 60, 100, 0},
+        // Bishop, knight, rook and queen mobility, king-zone attacks, hanging pieces
+        {4, 4, 2, 1, 6, -12}};
+
+    EvalParams current = Defaults;
+}
+
+const EvalParams &evalParams()
+{
+    return current;
+}
+
+const EvalParams &defaultEvalParams()
+{
+    return Defaults;
+}
+
+void setEvalParams(const EvalParams &params)
+{
+    current = params;
+}
+
+bool loadEvalParams(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        return false;
+    }
+
+    EvalParams params = Defaults;
+    std::string name;
+    while (in >> name)
+    {
+        if (name[0] == '#')
+        {
+            std::getline(in, name);
+            continue;
+        }
+
+        int *values = nullptr;
+        int count = 64;
+        if (name == "values")
+        {
+            values = params.pieceValues;
+            count = EvalParams::PieceTypes;
+        }
+        else if (name == "pawn")
+        {
+            values = params.pawnTerms;
+            count = EvalParams::PawnTermCount;
+        }
+        else if (name == "attack")
+        {
+            values = params.attackTerms;
+            count = EvalParams::AttackTermCount;
+        }
+        for (int troop = 0; troop < EvalParams::PieceTypes; troop++)
+        {
+            if (name == std::string("pst.") + TableNames[troop])
+            {
+                values = params.pieceSquare[troop];
+            }
+        }
+        if (!values)
+        {
+            std::cerr << "Unknown table '" << name << "' in " << path << std::endl;
+            return false;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            if (!(in >> values[i]))
+            {
+                std::cerr << "Table '" << name << "' is incomplete in " << path << std::endl;
+                return false;
+            }
+        }
+    }
+
+    setEvalParams(params);
+    return true;
+}
+
+bool saveEvalParams(const std::string &path, const EvalParams &params)
+{
+    std::ofstream out(path);
+    out << "# Evaluation parameters in centipawns, tables rank 8 first from White's side\n";
+    out << "values";
+    for (int value : params.pieceValues)
+    {
+        out << ' ' << value;
+    }
+    out << '\n';
+
+    for (int troop = 0; troop < EvalParams::PieceTypes; troop++)
+    {
+        out << "pst." << TableNames[troop] << '\n';
+        for (int y = 0; y < 8; y++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                out << (x ? " " : "  ") << params.pieceSquare[troop][y * 8 + x];
+            }
+            out << '\n';
+        }
+    }
+
+    out << "pawn";
+    for (int value : params.pawnTerms)
+    {
+        out << ' ' << value;
+    }
+    out << '\n';
+
+    out << "attack";
+    for (int value : params.attackTerms)
+    {
+        out << ' ' << value;
+    }
+    out << '\n';
+    return static_cast<bool>(out);
+}
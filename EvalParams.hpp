@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include "Position.hpp"
+
+// The hand-written evaluation as a table of numbers: a value per piece type, a piece-square
+// bonus, the pawn-structure terms and the attack-map terms, all in centipawns. Tables are laid
+// out like the board, rank 8 first, from White's side; Black reads them through relativeSquare.
+// Index with static_cast<int>(Troops).
+//
+// tools/texel_tune.cpp fits these against game results and writes them out in the text format
+// read by loadEvalParams:
+//   values <6 ints>
+//   pst.<piece> <64 ints>     for bishop, knight, rook, king, queen, pawn
+//   pawn <15 ints>            in PawnTerm order
+//   attack <6 ints>           in AttackTerm order
+struct EvalParams
+{
+    static constexpr int PieceTypes = 6;
+
+    // Each is earned once per pawn or piece of the side it applies to. Passed pawns are valued
+    // by rank counted from their own side, PassedPawn + 1 being a pawn on its second rank.
+    enum PawnTerm
+    {
+        DoubledPawn,      // per pawn beyond the first on a file
+        IsolatedPawn,
+        BackwardPawn,     // no pawn beside or behind it and its stop square held by an enemy pawn
+        RookOpenFile,
+        RookHalfOpenFile, // only the opponent's pawns on the file
+        KingOpenFile,     // per file under or beside the king with no pawns
+        KingHalfOpenFile, // per such file with only the opponent's pawns
+        PassedPawn,
+        PawnTermCount = PassedPawn + 8
+    };
+
+    // Worked out from the attack maps (AttackMaps.hpp). Mobility is per square a piece type
+    // reaches that holds none of our pieces and no enemy pawn covers.
+    enum AttackTerm
+    {
+        BishopMobility,
+        KnightMobility,
+        RookMobility,
+        QueenMobility,
+        KingZoneAttack, // per square around or under the enemy king our pieces (not pawns) attack
+        HangingPiece,   // per knight, bishop, rook or queen the opponent attacks and we don't defend
+        AttackTermCount
+    };
+
+    static constexpr int Count = PieceTypes + PieceTypes * 64 + PawnTermCount + AttackTermCount;
+
+    int pieceValues[PieceTypes];
+    int pieceSquare[PieceTypes][64];
+    int pawnTerms[PawnTermCount];
+    int attackTerms[AttackTermCount];
+
+    // Flat view used by the tuner: values first, then the tables in piece order, then the pawn
+    // terms and the attack terms
+    int get(int index) const { return at(*this, index); }
+    void set(int index, int value) { at(*this, index) = value; }
+
+    static int valueIndex(Troops troop) { return static_cast<int>(troop); }
+    static int squareIndex(Troops troop, int square) { return PieceTypes + static_cast<int>(troop) * 64 + square; }
+    static int termIndex(int term) { return PieceTypes + PieceTypes * 64 + term; }
+    static int attackIndex(int term) { return termIndex(PawnTermCount) + term; }
+
+private:
+    template <typename Params>
+    static auto at(Params &params, int index) -> decltype((params.pieceValues[0]))
+    {
+        if (index < PieceTypes)
+        {
+            return params.pieceValues[index];
+        }
+        if (index < termIndex(0))
+        {
+            return params.pieceSquare[(index - PieceTypes) / 64][(index - PieceTypes) % 64];
+        }
+        if (index < attackIndex(0))
+        {
+            return params.pawnTerms[index - termIndex(0)];
+        }
+        return params.attackTerms[index - attackIndex(0)];
+    }
+};
+
+inline int relativeSquare(Color color, int square) { return color == Color::White ? square : square ^ 56; }
+
+const EvalParams &evalParams();
+const EvalParams &defaultEvalParams();
+
+// Replaces the parameters used by Position::evaluateBoard; call before any search starts
+void setEvalParams(const EvalParams &params);
+bool loadEvalParams(const std::string &path);
+bool saveEvalParams(const std::string &path, const EvalParams &params);
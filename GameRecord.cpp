@@ -0,0 +1,122 @@
+#include "GameRecord.hpp"
+
+void GameRecord::reset(const Position &position, Color sideToMove)
+{
+    m_moves.clear();
+    m_checkpoints.clear();
+    m_checkpoints.push_back(makeCheckpoint(position, sideToMove));
+    m_ply = 0;
+}
+
+void GameRecord::push(const Move &move, const Position &position)
+{
+    m_moves.resize(m_ply);
+    m_checkpoints.resize(m_ply / CheckpointInterval + 1);
+
+    m_moves.push_back(packMove(move) | (position.getHalfmoveClock() == 0 ? ResetsClock : 0));
+    m_ply++;
+    if (m_ply % CheckpointInterval == 0)
+    {
+        m_checkpoints.push_back(makeCheckpoint(position, sideToMoveAt(m_ply)));
+    }
+}
+
+Color GameRecord::sideToMoveAt(int ply) const
+{
+    Color first = static_cast<Color>(m_checkpoints[0].sideToMove);
+    return ply % 2 == 0 ? first : Position::getOppositeColor(first);
+}
+
+bool GameRecord::stepBack(Position &position)
+{
+    if (m_ply == 0)
+    {
+        return false;
+    }
+    if (position.plyCount() == 0)
+    {
+        seek(m_ply - 1, position);
+        return true;
+    }
+    position.unmakeMove();
+    m_ply--;
+
+    // Earlier plies can need history from before the last seek started replaying
+    if (position.plyCount() < position.getHalfmoveClock() && position.plyCount() < m_ply)
+    {
+        seek(m_ply, position);
+    }
+    return true;
+}
+
+bool GameRecord::stepForward(Position &position)
+{
+    if (m_ply == length())
+    {
+        return false;
+    }
+    position.makeMove(moveAt(m_ply));
+    m_ply++;
+    return true;
+}
+
+void GameRecord::seek(int ply, Position &position)
+{
+    // Positions before the last capture or pawn move can't come back
+    int start = ply;
+    while (start > 0 && !(m_moves[start - 1] & ResetsClock))
+    {
+        start--;
+    }
+
+    int checkpoint = start / CheckpointInterval;
+    restore(m_checkpoints[checkpoint], position);
+    for (int i = checkpoint * CheckpointInterval; i < ply; i++)
+    {
+        position.makeMove(moveAt(i));
+    }
+    m_ply = ply;
+}
+
+GameRecord::Checkpoint GameRecord::makeCheckpoint(const Position &position, Color sideToMove)
+{
+    Checkpoint checkpoint = {};
+    int count = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        const Piece &piece = position.get_PieceAt(square % 8, square / 8);
+        if (piece.TroopType == Troops::None)
+        {
+            continue;
+        }
+        checkpoint.occupancy |= 1ULL << square;
+        int code = static_cast<int>(piece.color) * 6 + static_cast<int>(piece.TroopType);
+        checkpoint.pieces[count / 2] |= static_cast<uint8_t>(code << ((count % 2) * 4));
+        count++;
+    }
+
+    const PositionState &state = position.getState();
+    checkpoint.halfmoveClock = state.halfmoveClock;
+    checkpoint.castlingRights = state.castlingRights;
+    checkpoint.enPassantSquare = state.enPassantSquare;
+    checkpoint.sideToMove = static_cast<uint8_t>(sideToMove);
+    return checkpoint;
+}
+
+void GameRecord::restore(const Checkpoint &checkpoint, Position &position)
+{
+    Piece pieces[8][8];
+    uint64_t occupied = checkpoint.occupancy;
+    for (int i = 0; occupied; i++, occupied &= occupied - 1)
+    {
+        int square = __builtin_ctzll(occupied);
+        int code = (checkpoint.pieces[i / 2] >> ((i % 2) * 4)) & 15;
+        pieces[square / 8][square % 8] = Piece(static_cast<Troops>(code % 6), static_cast<Color>(code / 6));
+    }
+
+    PositionState rights;
+    rights.halfmoveClock = checkpoint.halfmoveClock;
+    rights.castlingRights = checkpoint.castlingRights;
+    rights.enPassantSquare = checkpoint.enPassantSquare;
+    position.setPosition(pieces, rights);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Position.hpp"
+
+// The moves of one game, for takeback, seeking and replay. Each move takes 16 bits and every
+// CheckpointInterval plies a 32-byte snapshot of the whole position is kept, so a long game
+// costs about three bytes a ply.
+//
+// A cursor marks the ply shown on the board, and the record drives that board's Position.
+// Stepping one ply is a makeMove or unmakeMove. A seek restores the nearest checkpoint and
+// replays from there. It starts early enough to put every position since the last capture or
+// pawn move back on the history stack, so repetitions are still detected after a jump. Pushing
+// a move away from the end drops the moves after the cursor.
+class GameRecord
+{
+public:
+    static constexpr int CheckpointInterval = 32;
+
+    struct Checkpoint
+    {
+        uint64_t occupancy; // bit y * 8 + x set for every occupied square
+        uint8_t pieces[16]; // one nibble per occupied square in square order: color * 6 + troop
+        int16_t halfmoveClock;
+        uint8_t castlingRights;
+        int8_t enPassantSquare;
+        uint8_t sideToMove; // Color
+        uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(Checkpoint) == 32, "checkpoint must stay 32 bytes");
+
+    // Starts a new game from position, which becomes ply 0
+    void reset(const Position &position, Color sideToMove);
+    // Records the move just played on position, which is now the position after it
+    void push(const Move &move, const Position &position);
+
+    int ply() const { return m_ply; }
+    int length() const { return static_cast<int>(m_moves.size()); }
+    // The move played from ply, for ply < length()
+    Move moveAt(int ply) const { return unpackMove(m_moves[ply]); } // unpackMove ignores ResetsClock
+    Color sideToMoveAt(int ply) const;
+
+    // One ply either way, false at either end. Both are O(1) unless stepping back leaves the
+    // repetition history short of what the last seek replayed; then stepBack seeks again.
+    bool stepBack(Position &position);
+    bool stepForward(Position &position);
+    // Rebuilds position at any ply up to length()
+    void seek(int ply, Position &position);
+
+    size_t memoryBytes() const { return m_moves.capacity() * sizeof(uint16_t) + m_checkpoints.capacity() * sizeof(Checkpoint); }
+
+private:
+    // Set on top of packMove's bits when the move was a capture or pawn move
+    static constexpr uint16_t ResetsClock = 1 << 15;
+
+    static Checkpoint makeCheckpoint(const Position &position, Color sideToMove);
+    static void restore(const Checkpoint &checkpoint, Position &position);
+
+    std::vector<uint16_t> m_moves;
+    std::vector<Checkpoint> m_checkpoints; // m_checkpoints[i] is the position at ply i * CheckpointInterval
+    int m_ply = 0;
+};
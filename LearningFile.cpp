@@ -0,0 +1,222 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LearningFile.hpp"
+
+namespace
+{
+    // Writes an empty file under a temporary name and renames it over path once it is on disk
+    bool createFile(const std::string &path, uint64_t bucketCount)
+    {
+        std::string temporary = path + ".tmp";
+        int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        LearningHeader header = {};
+        std::memcpy(header.magic, LearningMagic, sizeof(header.magic));
+        header.version = LearningVersion;
+        header.bucketCount = bucketCount;
+        off_t size = sizeof(LearningHeader) + bucketCount * LearningFile::BucketSlots * sizeof(LearningSlot);
+
+        // The slots are the zeros ftruncate fills in, which read as empty
+        bool written = ftruncate(fd, size) == 0 && pwrite(fd, &header, sizeof(header), 0) == sizeof(header) && fsync(fd) == 0;
+        close(fd);
+        if (!written || std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            unlink(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool validFile(int fd)
+    {
+        struct stat info;
+        LearningHeader header;
+        if (fstat(fd, &info) < 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            return false;
+        }
+        uint64_t buckets = header.bucketCount;
+        return std::memcmp(header.magic, LearningMagic, sizeof(LearningMagic)) == 0 && header.version == LearningVersion &&
+               buckets != 0 && (buckets & (buckets - 1)) == 0 &&
+               sizeof(LearningHeader) + buckets * LearningFile::BucketSlots * sizeof(LearningSlot) == static_cast<uint64_t>(info.st_size);
+    }
+}
+
+LearningFile::~LearningFile()
+{
+    if (m_mapping)
+    {
+        msync(m_mapping, m_size, MS_SYNC);
+        munmap(m_mapping, m_size);
+    }
+}
+
+bool LearningFile::Open(const std::string &path, size_t megabytes)
+{
+    // Largest power of two number of buckets that fits, so a key picks its bucket with a mask
+    uint64_t bucketCount = 1;
+    while (bucketCount * 2 * BucketSlots * sizeof(LearningSlot) <= megabytes * 1024 * 1024)
+    {
+        bucketCount *= 2;
+    }
+
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd >= 0 && !validFile(fd))
+    {
+        std::cerr << "Not a valid learning file, starting a new one: " << path << std::endl;
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0)
+    {
+        if (!createFile(path, bucketCount) || (fd = open(path.c_str(), O_RDWR)) < 0)
+        {
+            return false;
+        }
+    }
+
+    struct stat info;
+    fstat(fd, &info);
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    m_mapping = mapping;
+    m_size = info.st_size;
+    m_header = static_cast<LearningHeader *>(mapping);
+    m_slots = reinterpret_cast<LearningSlot *>(static_cast<char *>(mapping) + sizeof(LearningHeader));
+    m_bucketCount = m_header->bucketCount;
+
+    m_generation = ++m_header->generation;
+    msync(m_mapping, sizeof(LearningHeader), MS_ASYNC);
+    return true;
+}
+
+// Bits 0-15 move (from, to, promotion, present), 16-31 score, 32-39 depth, 48-55 generation,
+// the same layout as the search's table apart from the generation
+uint64_t LearningFile::pack(const LearningEntry &entry, uint32_t generation)
+{
+    uint64_t move = packMove(entry.move) | (1 << 15);
+    return move | (static_cast<uint64_t>(static_cast<uint16_t>(entry.score)) << 16) |
+           (static_cast<uint64_t>(static_cast<uint8_t>(entry.depth)) << 32) | (static_cast<uint64_t>(generation & 0xff) << 48);
+}
+
+LearningEntry LearningFile::unpack(uint64_t data)
+{
+    LearningEntry entry;
+    entry.move = unpackMove(static_cast<uint16_t>(data));
+    entry.score = static_cast<int16_t>(data >> 16);
+    entry.depth = static_cast<int8_t>(data >> 32);
+    return entry;
+}
+
+const LearningSlot *LearningFile::find(uint64_t key) const
+{
+    const LearningSlot *bucket = m_slots + (key & (m_bucketCount - 1)) * BucketSlots;
+    for (int i = 0; i < BucketSlots; i++)
+    {
+        if (bucket[i].data != 0 && (bucket[i].keyXorData ^ bucket[i].data) == key)
+        {
+            return &bucket[i];
+        }
+    }
+    return nullptr;
+}
+
+bool LearningFile::probe(uint64_t key, LearningEntry &entry) const
+{
+    if (!m_slots)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const LearningSlot *slot = find(key);
+    if (!slot)
+    {
+        return false;
+    }
+    entry = unpack(slot->data);
+    return true;
+}
+
+void LearningFile::store(uint64_t key, const LearningEntry &entry)
+{
+    if (!m_slots || entry.move.isNull())
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    LearningSlot *slot = const_cast<LearningSlot *>(find(key));
+    LearningEntry kept = entry;
+    if (slot)
+    {
+        // A deeper result stays, marked as still in use by this session
+        LearningEntry existing = unpack(slot->data);
+        if (existing.depth > entry.depth)
+        {
+            kept = existing;
+        }
+    }
+    else
+    {
+        // An empty slot, else the shallowest result, the oldest session's among equals
+        LearningSlot *bucket = m_slots + (key & (m_bucketCount - 1)) * BucketSlots;
+        slot = &bucket[0];
+        for (int i = 0; i < BucketSlots; i++)
+        {
+            LearningSlot *candidate = &bucket[i];
+            if (candidate->data == 0)
+            {
+                slot = candidate;
+                break;
+            }
+            int depth = unpack(candidate->data).depth;
+            int slotDepth = unpack(slot->data).depth;
+            uint8_t age = static_cast<uint8_t>(m_generation - generationOf(candidate->data));
+            uint8_t slotAge = static_cast<uint8_t>(m_generation - generationOf(slot->data));
+            if (depth < slotDepth || (depth == slotDepth && age > slotAge))
+            {
+                slot = candidate;
+            }
+        }
+    }
+
+    uint64_t data = pack(kept, m_generation);
+    slot->keyXorData = key ^ data;
+    slot->data = data;
+}
+
+void LearningFile::flush()
+{
+    if (m_mapping)
+    {
+        msync(m_mapping, m_size, MS_ASYNC);
+    }
+}
+
+size_t LearningFile::count() const
+{
+    if (!m_slots)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t used = 0;
+    for (size_t i = 0; i < capacity(); i++)
+    {
+        used += m_slots[i].data != 0;
+    }
+    return used;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "Position.hpp"
+
+// Search results that outlive the process: the GUI stores the outcome of every finished search
+// and, when the same position comes up again in a later session, answers from the file instead
+// of searching it from scratch.
+//
+//   LearningHeader
+//   LearningSlot[bucketCount * BucketSlots]
+//
+// The file's size is fixed when it is created, which caps it; once a bucket is full the
+// shallowest result in it (the oldest session's among equals) makes room for the new one.
+//
+// Writes go straight into a shared read-write mapping. The file is built under a temporary
+// name and renamed into place, so a crash never leaves a half-made one. Each slot holds its
+// entry packed into one word plus the key xor'd with that word, like the search's table, so a
+// slot left half written by a crash no longer matches its key and reads as empty.
+//
+// key is Position::hash() ^ Position::sideKey(side to move), as in the search.
+
+constexpr char LearningMagic[8] = {'C', 'H', 'E', 'S', 'S', 'L', 'R', 'N'};
+constexpr uint32_t LearningVersion = 1;
+
+struct LearningHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t generation; // sessions that opened the file, so replacement can tell old results
+    uint64_t bucketCount;
+};
+
+struct LearningSlot
+{
+    uint64_t keyXorData;
+    uint64_t data; // 0 when empty
+};
+
+static_assert(sizeof(LearningHeader) == 24, "learning header must stay packed");
+static_assert(sizeof(LearningSlot) == 16, "learning slot must stay packed");
+
+struct LearningEntry
+{
+    Move move;
+    int16_t score = 0; // from the side to move's point of view
+    int8_t depth = 0;  // completed iterations of the search that found it
+};
+
+class LearningFile
+{
+public:
+    static constexpr int BucketSlots = 4; // one cache line per bucket
+
+    LearningFile() = default;
+    ~LearningFile();
+
+    LearningFile(const LearningFile &) = delete;
+    LearningFile &operator=(const LearningFile &) = delete;
+
+    // Maps the file, creating it with room for about megabytes of results if it is missing or
+    // not a learning file. An existing file keeps the size it was created with.
+    bool Open(const std::string &path, size_t megabytes = 16);
+    bool isOpen() const { return m_slots != nullptr; }
+
+    bool probe(uint64_t key, LearningEntry &entry) const;
+    // Keeps an earlier result for the position if it came from a deeper search
+    void store(uint64_t key, const LearningEntry &entry);
+    // Schedules the written pages for the disk; the kernel writes them even if we crash later
+    void flush();
+
+    size_t capacity() const { return m_bucketCount * BucketSlots; }
+    // Slots in use; walks the whole file
+    size_t count() const;
+
+private:
+    static uint64_t pack(const LearningEntry &entry, uint32_t generation);
+    static LearningEntry unpack(uint64_t data);
+    static uint8_t generationOf(uint64_t data) { return static_cast<uint8_t>(data >> 48); }
+
+    // Slot holding key, or nullptr
+    const LearningSlot *find(uint64_t key) const;
+
+    mutable std::mutex m_mutex; // the GUI's search thread stores while the main thread probes
+    void *m_mapping = nullptr;
+    size_t m_size = 0;
+    LearningHeader *m_header = nullptr;
+    LearningSlot *m_slots = nullptr;
+    uint64_t m_bucketCount = 0;
+    uint32_t m_generation = 0;
+};
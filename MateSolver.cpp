@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include "MateSolver.hpp"
+#include "Trace.hpp"
+
+namespace
+{
+    // Proof and disproof numbers saturate one below Infinity, so only a real proof or disproof
+    // ever reaches it
+    constexpr uint32_t Infinity = 1u << 31;
+
+    // Lets the chosen child run a quarter past the second best before switching back, which
+    // saves re-expanding two nearly equal children in turn (the 1 + epsilon trick)
+    uint64_t widen(uint32_t second)
+    {
+        return static_cast<uint64_t>(second) + second / 4 + 1;
+    }
+
+    uint32_t saturate(uint64_t value)
+    {
+        return static_cast<uint32_t>(std::min<uint64_t>(value, Infinity - 1));
+    }
+
+    int64_t nowTicks()
+    {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+}
+
+MateSolver::MateSolver(size_t megabytes)
+{
+    size_t count = BucketSize;
+    while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024)
+    {
+        count *= 2;
+    }
+    table.resize(count);
+    bucketMask = count / BucketSize - 1;
+}
+
+void MateSolver::clear()
+{
+    std::fill(table.begin(), table.end(), Entry());
+}
+
+uint64_t MateSolver::nodeKey(const Position &position, Color sideToMove, int pliesLeft)
+{
+    return position.hash() ^ Position::sideKey(sideToMove) ^ splitmix(static_cast<uint64_t>(pliesLeft));
+}
+
+bool MateSolver::probe(uint64_t key, Numbers &numbers) const
+{
+    const Entry *bucket = &table[(key & bucketMask) * BucketSize];
+    for (int i = 0; i < BucketSize; i++)
+    {
+        if (bucket[i].key == key && (bucket[i].proof | bucket[i].disproof) != 0)
+        {
+            numbers = {bucket[i].proof, bucket[i].disproof};
+            return true;
+        }
+    }
+    return false;
+}
+
+void MateSolver::store(uint64_t key, Numbers numbers)
+{
+    Entry *bucket = &table[(key & bucketMask) * BucketSize];
+
+    // The same node, else an empty slot, else the unsolved node that looked cheapest; solved
+    // nodes are kept as long as anything else can go
+    Entry *victim = nullptr;
+    uint64_t victimCost = UINT64_MAX;
+    for (int i = 0; i < BucketSize; i++)
+    {
+        Entry &entry = bucket[i];
+        if (entry.key == key || (entry.proof | entry.disproof) == 0)
+        {
+            victim = &entry;
+            break;
+        }
+        bool solved = entry.proof == 0 || entry.disproof == 0;
+        uint64_t cost = solved ? UINT64_MAX - 1 : static_cast<uint64_t>(entry.proof) + entry.disproof;
+        if (cost < victimCost)
+        {
+            victim = &entry;
+            victimCost = cost;
+        }
+    }
+    victim->key = key;
+    victim->proof = numbers.proof;
+    victim->disproof = numbers.disproof;
+}
+
+bool MateSolver::shouldStop()
+{
+    if (activeLimits.stopSignal && activeLimits.stopSignal->load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    if (activeLimits.maxNodes && nodes >= activeLimits.maxNodes)
+    {
+        return true;
+    }
+    return deadlineTicks && nowTicks() >= deadlineTicks;
+}
+
+// First proof and disproof numbers of a node nobody has searched: solved outright when the
+// game or the plies are over, otherwise seeded with the number of moves, so narrow defences
+// look easy to prove and narrow attacks easy to disprove
+MateSolver::Numbers MateSolver::evaluateNew(Position &position, Color sideToMove, bool attacking, int pliesLeft)
+{
+    const Numbers proven = {0, Infinity};
+    const Numbers disproven = {Infinity, 0};
+
+    if (attacking)
+    {
+        if (pliesLeft == 0)
+        {
+            return disproven;
+        }
+        // Pseudo-legal moves are close enough for a first disproof number and skip the legality
+        // checks; an attacker without legal moves is caught once the node is expanded
+        size_t moveCount = sideToMove == Color::White ? position.generateAllMoves<Color::White>().size() : position.generateAllMoves<Color::Black>().size();
+        return Numbers{1, static_cast<uint32_t>(std::max<size_t>(moveCount, 1))};
+    }
+
+    bool check = position.inCheck(sideToMove);
+    if (pliesLeft == 0)
+    {
+        // Out of plies: only a mate already on the board counts
+        if (!check)
+        {
+            return disproven;
+        }
+        bool hasMove = sideToMove == Color::White ? position.hasLegalMove<Color::White>() : position.hasLegalMove<Color::Black>();
+        return hasMove ? disproven : proven;
+    }
+    size_t moveCount = position.generateLegalMoves(sideToMove).size();
+    if (moveCount == 0)
+    {
+        return check ? proven : disproven;
+    }
+    return {static_cast<uint32_t>(moveCount), 1};
+}
+
+MateSolver::Numbers MateSolver::lookupOrEvaluate(Position &position, Color sideToMove, bool attacking, int pliesLeft)
+{
+    uint64_t key = nodeKey(position, sideToMove, pliesLeft);
+    Numbers numbers;
+    if (!probe(key, numbers))
+    {
+        numbers = evaluateNew(position, sideToMove, attacking, pliesLeft);
+        store(key, numbers);
+    }
+    return numbers;
+}
+
+// Expands the node until its proof number reaches proofLimit or its disproof number reaches
+// disproofLimit, each time descending into the child that looks easiest to settle it with
+MateSolver::Numbers MateSolver::search(Position &position, Color sideToMove, bool attacking, int pliesLeft, uint32_t proofLimit, uint32_t disproofLimit)
+{
+    Numbers current = {1, 1};
+    if ((++nodes & 1023) == 0 && shouldStop())
+    {
+        aborted = true;
+    }
+    if (aborted)
+    {
+        return current;
+    }
+
+    uint64_t key = nodeKey(position, sideToMove, pliesLeft);
+    std::vector<Move> moves = position.generateLegalMoves(sideToMove);
+    if (moves.empty() && attacking)
+    {
+        current = {Infinity, 0};
+        store(key, current);
+        return current;
+    }
+    if (moves.empty() || pliesLeft == 0)
+    {
+        current = evaluateNew(position, sideToMove, attacking, pliesLeft);
+        store(key, current);
+        return current;
+    }
+
+    Color opponent = Position::getOppositeColor(sideToMove);
+    std::vector<uint64_t> childKeys(moves.size());
+    std::vector<Numbers> children(moves.size());
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        position.makeMove(moves[i]);
+        childKeys[i] = nodeKey(position, opponent, pliesLeft - 1);
+        children[i] = lookupOrEvaluate(position, opponent, !attacking, pliesLeft - 1);
+        position.unmakeMove();
+    }
+
+    for (;;)
+    {
+        // The attacker needs one child proved and all disproved to fail; the defender the reverse
+        uint64_t sum = 0;
+        bool settled = false; // a child already decides the other number outright
+        uint32_t smallest = Infinity;
+        uint32_t second = Infinity;
+        size_t best = 0;
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            // Children can be settled through transpositions meanwhile
+            probe(childKeys[i], children[i]);
+            uint32_t own = attacking ? children[i].proof : children[i].disproof;
+            uint32_t other = attacking ? children[i].disproof : children[i].proof;
+            sum += other;
+            settled = settled || other == Infinity;
+            if (own < smallest)
+            {
+                second = smallest;
+                smallest = own;
+                best = i;
+            }
+            else if (own < second)
+            {
+                second = own;
+            }
+        }
+
+        uint32_t otherTotal = settled ? Infinity : saturate(sum);
+        current = attacking ? Numbers{smallest, otherTotal} : Numbers{otherTotal, smallest};
+        if (current.proof >= proofLimit || current.disproof >= disproofLimit)
+        {
+            break;
+        }
+
+        // The chosen child may work until it stops being the smallest, or until the sum over
+        // the children would reach this node's limit
+        uint32_t childProof;
+        uint32_t childDisproof;
+        if (attacking)
+        {
+            childProof = saturate(std::min<uint64_t>(proofLimit, widen(second)));
+            childDisproof = saturate(static_cast<uint64_t>(disproofLimit) - current.disproof + children[best].disproof);
+        }
+        else
+        {
+            childDisproof = saturate(std::min<uint64_t>(disproofLimit, widen(second)));
+            childProof = saturate(static_cast<uint64_t>(proofLimit) - current.proof + children[best].proof);
+        }
+
+        position.makeMove(moves[best]);
+        children[best] = search(position, opponent, !attacking, pliesLeft - 1, childProof, childDisproof);
+        position.unmakeMove();
+        if (aborted)
+        {
+            return current;
+        }
+    }
+
+    store(key, current);
+    return current;
+}
+
+// Fewest plies, down to 0 for a mate on the board, in which the node is known to be proved,
+// or -1 when the table has no proof for it
+int MateSolver::provenDistance(Position &position, Color sideToMove, bool attacking, int pliesLeft)
+{
+    for (int plies = attacking ? 1 : 0; plies <= pliesLeft; plies += 2)
+    {
+        Numbers numbers;
+        if (plies == 0)
+        {
+            numbers = evaluateNew(position, sideToMove, false, 0);
+        }
+        else if (!probe(nodeKey(position, sideToMove, plies), numbers))
+        {
+            continue;
+        }
+        if (numbers.proof == 0)
+        {
+            return plies;
+        }
+    }
+    return -1;
+}
+
+// Walks a proved root down to the mate: the attacker takes the quickest proved move, the
+// defender the reply that holds out longest. Proofs lost to table replacement are redone.
+std::vector<Move> MateSolver::mateLine(Position position, Color attacker, int pliesLeft)
+{
+    std::vector<Move> line;
+    Color side = attacker;
+    bool attacking = true;
+
+    while (pliesLeft > 0)
+    {
+        std::vector<Move> moves = position.generateLegalMoves(side);
+        if (moves.empty())
+        {
+            break;
+        }
+        Color opponent = Position::getOppositeColor(side);
+
+        Move best;
+        int bestDistance = -1;
+        for (int attempt = 0; attempt < 2 && best.isNull(); attempt++)
+        {
+            for (const Move &move : moves)
+            {
+                position.makeMove(move);
+                int distance = provenDistance(position, opponent, !attacking, pliesLeft - 1);
+                if (distance < 0 && !attacking)
+                {
+                    // Every reply was part of the proof; redo this one's
+                    search(position, opponent, true, pliesLeft - 1, Infinity, Infinity);
+                    distance = provenDistance(position, opponent, true, pliesLeft - 1);
+                }
+                position.unmakeMove();
+
+                if (distance >= 0 && (best.isNull() || (attacking ? distance < bestDistance : distance > bestDistance)))
+                {
+                    best = move;
+                    bestDistance = distance;
+                }
+            }
+            if (best.isNull() && attacking)
+            {
+                search(position, side, true, pliesLeft, Infinity, Infinity);
+            }
+        }
+        if (best.isNull() || aborted)
+        {
+            break;
+        }
+
+        line.push_back(best);
+        position.makeMove(best);
+        pliesLeft = bestDistance;
+        side = opponent;
+        attacking = !attacking;
+    }
+    return line;
+}
+
+MateResult MateSolver::solve(const Position &position, Color attacker, const MateLimits &limits)
+{
+    TRACE_ZONE("MateSolver::solve");
+    activeLimits = limits;
+    nodes = 0;
+    aborted = false;
+    deadlineTicks = 0;
+    if (limits.timeMs > 0)
+    {
+        deadlineTicks = nowTicks() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::milliseconds(limits.timeMs)).count();
+    }
+
+    MateResult result;
+    Position root = position;
+    for (int moves = 1; moves <= limits.maxMoves; moves++)
+    {
+        int plies = 2 * moves - 1;
+        Numbers numbers = search(root, attacker, true, plies, Infinity, Infinity);
+        if (aborted)
+        {
+            break;
+        }
+        result.decidedMoves = moves;
+        if (numbers.proof == 0)
+        {
+            result.outcome = MateResult::Mate;
+            result.mateIn = moves;
+            result.line = mateLine(root, attacker, plies);
+            break;
+        }
+    }
+
+    if (result.outcome != MateResult::Mate && !aborted)
+    {
+        result.outcome = MateResult::NoMate;
+    }
+    result.nodes = nodes;
+    return result;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "Position.hpp"
+
+struct MateLimits
+{
+    int maxMoves = 8;     // longest mate to look for, in moves of the attacking side
+    uint64_t maxNodes = 0; // 0 for no limit
+    int timeMs = 0;        // 0 for no limit
+    // Set from another thread to give up early; the result is then Unknown past the last
+    // mate length fully decided
+    const std::atomic<bool> *stopSignal = nullptr;
+};
+
+struct MateResult
+{
+    enum Outcome : uint8_t
+    {
+        Mate,   // forced mate in mateIn moves, the shortest there is
+        NoMate, // no forced mate in up to MateLimits::maxMoves moves
+        Unknown // stopped or out of nodes or time first
+    };
+
+    Outcome outcome = Unknown;
+    int mateIn = 0;
+    std::vector<Move> line; // attacker and defender moves alternately, ending in mate
+    int decidedMoves = 0;   // every mate length up to this one was proved or disproved
+    uint64_t nodes = 0;
+};
+
+// Depth-first proof-number search (df-pn) for forced mates. Instead of scoring positions it
+// counts how many positions still need proving (proof number) or disproving (disproof number)
+// and always expands where those are smallest, which is what finds deep, narrow mates quickly.
+// Nodes are keyed by position and plies left, so the search graph has no cycles, and the
+// proof and disproof numbers go into a fixed-size table that bounds the memory used.
+// Mate lengths are tried in increasing order, so the first proof is the shortest mate.
+class MateSolver
+{
+public:
+    explicit MateSolver(size_t megabytes = 64);
+
+    MateSolver(const MateSolver &) = delete;
+    MateSolver &operator=(const MateSolver &) = delete;
+
+    // Can the attacker, who is to move, force mate? Runs on the calling thread.
+    MateResult solve(const Position &position, Color attacker, const MateLimits &limits);
+    void clear();
+    size_t memoryBytes() const { return table.size() * sizeof(Entry); }
+
+private:
+    struct Entry
+    {
+        uint64_t key = 0;
+        uint32_t proof = 0;    // 0 for an empty slot together with disproof 0
+        uint32_t disproof = 0;
+    };
+
+    struct Numbers
+    {
+        uint32_t proof;
+        uint32_t disproof;
+    };
+
+    static constexpr int BucketSize = 4; // one cache line
+
+    static uint64_t nodeKey(const Position &position, Color sideToMove, int pliesLeft);
+    bool probe(uint64_t key, Numbers &numbers) const;
+    void store(uint64_t key, Numbers numbers);
+
+    Numbers evaluateNew(Position &position, Color sideToMove, bool attacking, int pliesLeft);
+    Numbers lookupOrEvaluate(Position &position, Color sideToMove, bool attacking, int pliesLeft);
+    Numbers search(Position &position, Color sideToMove, bool attacking, int pliesLeft, uint32_t proofLimit, uint32_t disproofLimit);
+    int provenDistance(Position &position, Color sideToMove, bool attacking, int pliesLeft);
+    std::vector<Move> mateLine(Position position, Color attacker, int pliesLeft);
+    bool shouldStop();
+
+    std::vector<Entry> table;
+    size_t bucketMask;
+
+    // Only touched by the thread running solve()
+    MateLimits activeLimits;
+    uint64_t nodes = 0;
+    int64_t deadlineTicks = 0;
+    bool aborted = false;
+};
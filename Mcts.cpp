@@ -0,0 +1,609 @@
+#include <algorithm>
+#include <cmath>
+#include "Mcts.hpp"
+#include "Trace.hpp"
+
+namespace
+{
+    // UCT exploration constant for results between 0 and 1
+    constexpr double Exploration = 0.7;
+
+    constexpr int CapturePlies = 6;  // depth of the capture search at the leaves
+    constexpr int RolloutPlies = 40; // random moves per rollout before evaluating
+
+    uint64_t nextRandom(uint64_t &state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // Captured piece value, counting an en passant capture as a pawn and a promotion as the
+    // queen it makes; 0 for quiet moves
+    int tacticalGain(const Position &position, const Move &move)
+    {
+        const Piece &victim = position.get_PieceAt(move.destX, move.destY);
+        int gain = victim.TroopType == Troops::None ? 0 : Position::getPieceValue(victim);
+        const Piece &mover = position.get_PieceAt(move.srcX, move.srcY);
+        if (mover.TroopType == Troops::Pawn)
+        {
+            if (victim.TroopType == Troops::None && move.srcX != move.destX)
+            {
+                gain = Position::getPieceValue(Piece(Troops::Pawn));
+            }
+            if (move.destY == 0 || move.destY == 7)
+            {
+                gain += Position::getPieceValue(Piece(Troops::Queen));
+            }
+        }
+        return gain;
+    }
+
+    // Static evaluation once the captures have been played out, so a leaf in the middle of an
+    // exchange isn't scored a piece up or down
+    int captureSearch(Position &position, Color side, int alpha, int beta, int pliesLeft)
+    {
+        int standPat = position.evaluateBoard(side);
+        if (standPat >= beta || pliesLeft == 0)
+        {
+            return standPat;
+        }
+        alpha = std::max(alpha, standPat);
+
+        std::vector<std::pair<int, Move>> captures;
+        for (const Move &move : position.generateAllMoves(side))
+        {
+            int gain = tacticalGain(position, move);
+            if (gain > 0)
+            {
+                captures.push_back({gain, move});
+            }
+        }
+        std::sort(captures.begin(), captures.end(), [](const std::pair<int, Move> &a, const std::pair<int, Move> &b)
+                  { return a.first > b.first; });
+
+        Color opponent = Position::getOppositeColor(side);
+        for (const auto &capture : captures)
+        {
+            position.makeMove(capture.second);
+            if (position.inCheck(side))
+            {
+                position.unmakeMove();
+                continue;
+            }
+            int score = -captureSearch(position, opponent, -beta, -alpha, pliesLeft - 1);
+            position.unmakeMove();
+            if (score >= beta)
+            {
+                return score;
+            }
+            alpha = std::max(alpha, score);
+        }
+        return alpha;
+    }
+
+    // Expected result for the side the centipawns are for, on the usual logistic Elo curve
+    double winProbability(int centipawns)
+    {
+        return 1.0 / (1.0 + std::pow(10.0, -centipawns / 400.0));
+    }
+
+    int centipawnsFor(double winProbability)
+    {
+        double p = std::min(std::max(winProbability, 0.001), 0.999);
+        return static_cast<int>(std::lround(-400.0 * std::log10(1.0 / p - 1.0)));
+    }
+}
+
+uint32_t Mcts::NodePool::allocate(size_t count)
+{
+    size_t first = used.fetch_add(count, std::memory_order_relaxed);
+    return first + count <= capacity ? static_cast<uint32_t>(first) : 0;
+}
+
+Mcts::Mcts(size_t megabytes)
+{
+    static_assert(sizeof(Node) == 32, "tree nodes should stay two to a cache line");
+    size_t perPool = std::max<size_t>(megabytes * 1024 * 1024 / 2 / sizeof(Node), 1024);
+    perPool = std::min<size_t>(perPool, UINT32_MAX);
+    for (NodePool &nodePool : pools)
+    {
+        nodePool.nodes.reset(new Node[perPool]);
+        nodePool.capacity = perPool;
+    }
+}
+
+Mcts::~Mcts()
+{
+    stop();
+}
+
+void Mcts::initNode(Node &node, Move move)
+{
+    node.visits.store(0, std::memory_order_relaxed);
+    node.virtualLoss.store(0, std::memory_order_relaxed);
+    node.valueSum.store(0, std::memory_order_relaxed);
+    node.firstChild.store(0, std::memory_order_relaxed);
+    node.state.store(Unexpanded, std::memory_order_relaxed);
+    node.childCount = 0;
+    node.move = move;
+}
+
+// The node for this position among the last root, its children and its grandchildren, or 0
+uint32_t Mcts::findInTree(const Position &position, Color sideToMove)
+{
+    uint64_t target = position.hash() ^ Position::sideKey(sideToMove);
+    Position walk = rootPosition;
+    if ((walk.hash() ^ Position::sideKey(rootSide)) == target)
+    {
+        return root;
+    }
+
+    const Node &rootNode = pool->nodes[root];
+    if (rootNode.state.load(std::memory_order_relaxed) != Expanded)
+    {
+        return 0;
+    }
+    Color opponent = Position::getOppositeColor(rootSide);
+    uint32_t first = rootNode.firstChild.load(std::memory_order_relaxed);
+    for (uint32_t child = first; child < first + rootNode.childCount; child++)
+    {
+        const Node &childNode = pool->nodes[child];
+        walk.makeMove(childNode.move);
+        if ((walk.hash() ^ Position::sideKey(opponent)) == target)
+        {
+            return child;
+        }
+        if (childNode.state.load(std::memory_order_relaxed) == Expanded)
+        {
+            uint32_t firstGrandchild = childNode.firstChild.load(std::memory_order_relaxed);
+            for (uint32_t grandchild = firstGrandchild; grandchild < firstGrandchild + childNode.childCount; grandchild++)
+            {
+                walk.makeMove(pool->nodes[grandchild].move);
+                bool found = (walk.hash() ^ Position::sideKey(rootSide)) == target;
+                walk.unmakeMove();
+                if (found)
+                {
+                    return grandchild;
+                }
+            }
+        }
+        walk.unmakeMove();
+    }
+    return 0;
+}
+
+// Copies the subtree under from into another pool breadth first, which keeps every node's
+// children side by side, and returns the new index of from. Nodes whose children no longer fit
+// are copied unexpanded.
+uint32_t Mcts::copySubtree(uint32_t from, NodePool &to)
+{
+    auto copyNode = [](const Node &source, Node &target)
+    {
+        target.visits.store(source.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        target.virtualLoss.store(0, std::memory_order_relaxed);
+        target.valueSum.store(source.valueSum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        target.firstChild.store(0, std::memory_order_relaxed);
+        uint8_t state = source.state.load(std::memory_order_relaxed);
+        target.state.store(state == Expanded ? static_cast<uint8_t>(Unexpanded) : state, std::memory_order_relaxed);
+        target.childCount = 0;
+        target.move = source.move;
+    };
+
+    to.used = 1;
+    uint32_t newRoot = to.allocate(1);
+    copyNode(pool->nodes[from], to.nodes[newRoot]);
+
+    std::vector<std::pair<uint32_t, uint32_t>> queue = {{from, newRoot}};
+    for (size_t next = 0; next < queue.size(); next++)
+    {
+        const Node &source = pool->nodes[queue[next].first];
+        Node &target = to.nodes[queue[next].second];
+        if (source.state.load(std::memory_order_relaxed) != Expanded)
+        {
+            continue;
+        }
+        uint32_t first = to.allocate(source.childCount);
+        if (first == 0)
+        {
+            continue;
+        }
+        uint32_t sourceFirst = source.firstChild.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < source.childCount; i++)
+        {
+            copyNode(pool->nodes[sourceFirst + i], to.nodes[first + i]);
+            queue.push_back({sourceFirst + i, first + i});
+        }
+        target.childCount = source.childCount;
+        target.firstChild.store(first, std::memory_order_relaxed);
+        target.state.store(Expanded, std::memory_order_relaxed);
+    }
+    return newRoot;
+}
+
+void Mcts::prepareRoot(const Position &position, Color sideToMove)
+{
+    uint32_t found = root ? findInTree(position, sideToMove) : 0;
+    if (found && found != root)
+    {
+        NodePool &other = pool == &pools[0] ? pools[1] : pools[0];
+        root = copySubtree(found, other);
+        pool = &other;
+    }
+    else if (!found)
+    {
+        pool->used = 1;
+        root = pool->allocate(1);
+        initNode(pool->nodes[root], Move());
+    }
+    rootPosition = position;
+    rootSide = sideToMove;
+    reused = pool->nodes[root].visits.load(std::memory_order_relaxed);
+}
+
+// Creates the node's children unless another thread got there first; false when the node has
+// no children to descend into (game over, or the pool is full)
+bool Mcts::expand(Node &node, Position &position, Color sideToMove, int depth)
+{
+    if (pool->used.load(std::memory_order_relaxed) >= pool->capacity)
+    {
+        return false;
+    }
+    uint8_t expected = Unexpanded;
+    if (!node.state.compare_exchange_strong(expected, Expanding, std::memory_order_acq_rel))
+    {
+        return expected == Expanded;
+    }
+
+    if (depth > 0 && position.isDraw())
+    {
+        node.state.store(Drawn, std::memory_order_release);
+        return false;
+    }
+    std::vector<Move> moves = position.generateLegalMoves(sideToMove);
+    if (moves.empty())
+    {
+        node.state.store(position.inCheck(sideToMove) ? Mated : Drawn, std::memory_order_release);
+        return false;
+    }
+
+    uint32_t first = pool->allocate(moves.size());
+    if (first == 0)
+    {
+        node.state.store(Unexpanded, std::memory_order_release);
+        return false;
+    }
+
+    // Unvisited children are tried in order, so captures and promotions go first
+    std::stable_sort(moves.begin(), moves.end(), [&position](const Move &a, const Move &b)
+                     { return tacticalGain(position, a) > tacticalGain(position, b); });
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        initNode(pool->nodes[first + i], moves[i]);
+    }
+    node.childCount = static_cast<uint8_t>(moves.size());
+    node.firstChild.store(first, std::memory_order_relaxed);
+    node.state.store(Expanded, std::memory_order_release);
+    return true;
+}
+
+// Highest upper confidence bound, an unvisited child before any other. Visits still in
+// flight on other threads count as losses.
+uint32_t Mcts::selectChild(const Node &node) const
+{
+    uint32_t first = node.firstChild.load(std::memory_order_relaxed);
+    double parentVisits = node.visits.load(std::memory_order_relaxed) + node.virtualLoss.load(std::memory_order_relaxed);
+    double logParent = std::log(std::max(parentVisits, 1.0));
+
+    uint32_t best = first;
+    double bestScore = -1;
+    for (uint32_t child = first; child < first + node.childCount; child++)
+    {
+        const Node &childNode = pool->nodes[child];
+        uint32_t visits = childNode.visits.load(std::memory_order_relaxed) + childNode.virtualLoss.load(std::memory_order_relaxed);
+        if (visits == 0)
+        {
+            return child;
+        }
+        double value = static_cast<double>(childNode.valueSum.load(std::memory_order_relaxed)) / (ValueScale * visits);
+        double score = value + Exploration * std::sqrt(logParent / visits);
+        if (score > bestScore)
+        {
+            best = child;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+// Expected result for the side to move at a leaf
+double Mcts::evaluateLeaf(Position &position, Color sideToMove, uint64_t &rng)
+{
+    if (position.isDraw())
+    {
+        return 0.5;
+    }
+    if (!activeLimits.rollouts)
+    {
+        return winProbability(captureSearch(position, sideToMove, -MateScore, MateScore, CapturePlies));
+    }
+
+    // Random legal moves until the game ends or the rollout is long enough, then the evaluation
+    Color side = sideToMove;
+    int played = 0;
+    double value = -1; // for side, once known
+    while (played < RolloutPlies)
+    {
+        std::vector<Move> moves = position.generateLegalMoves(side);
+        if (moves.empty())
+        {
+            value = position.inCheck(side) ? 0.0 : 0.5;
+            break;
+        }
+        position.makeMove(moves[nextRandom(rng) % moves.size()]);
+        played++;
+        side = Position::getOppositeColor(side);
+        if (position.isDraw())
+        {
+            value = 0.5;
+            break;
+        }
+    }
+    if (value < 0)
+    {
+        value = winProbability(position.evaluateBoard(side));
+    }
+    for (int i = 0; i < played; i++)
+    {
+        position.unmakeMove();
+    }
+    return side == sideToMove ? value : 1.0 - value;
+}
+
+// One playout: down the tree to a leaf, expanding it if it was visited before, then the
+// leaf's result back up to the root
+void Mcts::playout(Position &position, Color sideToMove, uint64_t &rng)
+{
+    uint32_t path[MaxDepth + 1];
+    int depth = 0;
+    Color side = sideToMove;
+    Node *node = &pool->nodes[root];
+    node->virtualLoss.fetch_add(1, std::memory_order_relaxed);
+    path[0] = root;
+
+    for (;;)
+    {
+        uint8_t state = node->state.load(std::memory_order_acquire);
+        if (state == Unexpanded && depth < MaxDepth && node->visits.load(std::memory_order_relaxed) > 0 && expand(*node, position, side, depth))
+        {
+            state = Expanded;
+        }
+        if (state != Expanded)
+        {
+            break;
+        }
+
+        uint32_t child = selectChild(*node);
+        node = &pool->nodes[child];
+        node->virtualLoss.fetch_add(1, std::memory_order_relaxed);
+        position.makeMove(node->move);
+        side = Position::getOppositeColor(side);
+        path[++depth] = child;
+    }
+
+    uint8_t state = node->state.load(std::memory_order_acquire);
+    double value = state == Mated ? 0.0 : state == Drawn ? 0.5 : evaluateLeaf(position, side, rng);
+
+    // Each node keeps the results of the side that moved into it
+    for (int i = depth; i >= 0; i--)
+    {
+        value = 1.0 - value;
+        Node &visited = pool->nodes[path[i]];
+        visited.valueSum.fetch_add(static_cast<uint64_t>(value * ValueScale), std::memory_order_relaxed);
+        visited.visits.fetch_add(1, std::memory_order_relaxed);
+        visited.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < depth; i++)
+    {
+        position.unmakeMove();
+    }
+
+    int deepest = maxDepth.load(std::memory_order_relaxed);
+    while (depth > deepest && !maxDepth.compare_exchange_weak(deepest, depth, std::memory_order_relaxed))
+    {
+    }
+}
+
+bool Mcts::shouldStop() const
+{
+    if (stopRequested.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    if (activeLimits.stopSignal && activeLimits.stopSignal->load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    if (activeLimits.maxPlayouts && playouts.load(std::memory_order_relaxed) >= activeLimits.maxPlayouts)
+    {
+        return true;
+    }
+    return activeLimits.moveTimeMs > 0 && std::chrono::steady_clock::now() >= deadline;
+}
+
+void Mcts::worker(Position position, Color sideToMove, int index)
+{
+    Trace::setThreadName("mcts");
+    TRACE_ZONE("mcts worker");
+    position.refreshAccumulator();
+    uint64_t rng = splitmix(static_cast<uint64_t>(index) ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    if (rng == 0)
+    {
+        rng = 1;
+    }
+
+    // The shared counters are only touched every few playouts so the threads don't queue on them
+    constexpr int Batch = 16;
+    while (!shouldStop())
+    {
+        for (int i = 0; i < Batch; i++)
+        {
+            playout(position, sideToMove, rng);
+        }
+        playouts.fetch_add(Batch, std::memory_order_relaxed);
+        size_t used = std::min(pool->used.load(std::memory_order_relaxed), pool->capacity);
+        liveHashfull.store(static_cast<int>(used * 1000 / pool->capacity), std::memory_order_relaxed);
+    }
+}
+
+// The most visited root move, and the line of most visited replies after it
+SearchResult Mcts::collectResult(uint64_t playoutCount) const
+{
+    SearchResult best;
+    best.nodes = playoutCount;
+    best.depth = maxDepth.load(std::memory_order_relaxed);
+
+    const Node *node = &pool->nodes[root];
+    double rootValue = 0.5;
+    while (node->state.load(std::memory_order_relaxed) == Expanded && best.pv.size() < MaxDepth)
+    {
+        uint32_t first = node->firstChild.load(std::memory_order_relaxed);
+        const Node *bestChild = nullptr;
+        for (uint32_t child = first; child < first + node->childCount; child++)
+        {
+            const Node &childNode = pool->nodes[child];
+            if (!bestChild || childNode.visits.load(std::memory_order_relaxed) > bestChild->visits.load(std::memory_order_relaxed))
+            {
+                bestChild = &childNode;
+            }
+        }
+        uint32_t visits = bestChild->visits.load(std::memory_order_relaxed);
+        if (best.pv.empty())
+        {
+            rootValue = visits ? static_cast<double>(bestChild->valueSum.load(std::memory_order_relaxed)) / (ValueScale * visits) : 0.5;
+            if (bestChild->state.load(std::memory_order_relaxed) == Mated)
+            {
+                best.score = MateScore - 1;
+            }
+        }
+        else if (visits == 0)
+        {
+            break;
+        }
+        best.pv.push_back(bestChild->move);
+        node = bestChild;
+    }
+
+    if (best.score == 0)
+    {
+        best.score = centipawnsFor(rootValue);
+    }
+    if (!best.pv.empty())
+    {
+        best.bestMove = best.pv[0];
+        best.ponderMove = best.pv.size() > 1 ? best.pv[1] : Move();
+        best.lines = {{best.score, best.pv}};
+    }
+    return best;
+}
+
+SearchResult Mcts::search(const Position &position, Color sideToMove, const MctsLimits &limits)
+{
+    TRACE_ZONE("mcts");
+    searching = true;
+    activeLimits = limits;
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.moveTimeMs);
+    playouts = 0;
+    maxDepth = 0;
+
+    prepareRoot(position, sideToMove);
+    liveHashfull = static_cast<int>(std::min(pool->used.load(), pool->capacity) * 1000 / pool->capacity);
+
+    // With the root expanded up front there is a move to play however early the search stops
+    Position rootCopy = position;
+    Node &rootNode = pool->nodes[root];
+    if (rootNode.state.load() == Unexpanded)
+    {
+        expand(rootNode, rootCopy, sideToMove, 0);
+    }
+
+    if (rootNode.state.load() == Expanded)
+    {
+        int threadCount = limits.threads > 0 ? limits.threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::thread> helpers;
+        for (int i = 1; i < threadCount; i++)
+        {
+            helpers.emplace_back(&Mcts::worker, this, position, sideToMove, i);
+        }
+        worker(position, sideToMove, 0);
+        for (std::thread &helper : helpers)
+        {
+            helper.join();
+        }
+    }
+
+    SearchResult finished = collectResult(playouts.load());
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        result = finished;
+    }
+    searching = false;
+    return finished;
+}
+
+SearchResult Mcts::run(const Position &position, Color sideToMove, const MctsLimits &limits)
+{
+    stopRequested = false;
+    return search(position, sideToMove, limits);
+}
+
+void Mcts::start(const Position &position, Color sideToMove, const MctsLimits &limits, Callback onDone)
+{
+    stop();
+    stopRequested = false;
+    searching = true;
+    thread = std::thread([this, position, sideToMove, limits, onDone]()
+                         {
+                             SearchResult finished = search(position, sideToMove, limits);
+                             if (onDone)
+                             {
+                                 onDone(finished);
+                             } });
+}
+
+void Mcts::stop()
+{
+    stopRequested = true;
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    searching = false;
+}
+
+void Mcts::clear()
+{
+    stop();
+    root = 0;
+    for (NodePool &nodePool : pools)
+    {
+        nodePool.used = 1;
+    }
+}
+
+SearchStats Mcts::liveStats() const
+{
+    SearchStats stats;
+    stats.searching = searching.load(std::memory_order_relaxed);
+    stats.depth = maxDepth.load(std::memory_order_relaxed);
+    stats.nodes = playouts.load(std::memory_order_relaxed);
+    stats.hashfull = liveHashfull.load(std::memory_order_relaxed);
+    return stats;
+}
+
+SearchResult Mcts::lastResult()
+{
+    std::lock_guard<std::mutex> lock(resultMutex);
+    return result;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Position.hpp"
+#include "Search.hpp"
+
+struct MctsLimits
+{
+    int moveTimeMs = 1000;    // 0 searches until maxPlayouts or stop()
+    uint64_t maxPlayouts = 0; // 0 for no limit
+    int threads = 0;          // 0 uses every hardware thread
+    // Random playouts at the leaves instead of the static evaluation after a short capture search
+    bool rollouts = false;
+    // Set from another thread to end the search early, like SearchLimits::stopSignal
+    const std::atomic<bool> *stopSignal = nullptr;
+};
+
+// Monte Carlo tree search with UCT selection, an alternative player to the alpha-beta Search.
+//
+// Every playout walks down the tree picking the child with the best upper confidence bound,
+// expands the leaf it reaches once the leaf has been visited before, evaluates one position
+// there and adds the result to every node on the way back. Threads share the one tree: a
+// thread passing through a node counts as a lost visit there (virtual loss) until its result
+// is in, which steers the other threads down different lines without any locking.
+//
+// Nodes come from a preallocated pool, children of a node side by side, so nothing is freed
+// during a search. When the next search starts from a position already in the tree, within
+// two plies of the last root, that subtree is copied into a second pool and the search carries
+// on from it instead of starting again.
+class Mcts
+{
+public:
+    using Callback = std::function<void(const SearchResult &)>;
+
+    // The memory is split between the two node pools
+    explicit Mcts(size_t megabytes = 128);
+    ~Mcts();
+
+    Mcts(const Mcts &) = delete;
+    Mcts &operator=(const Mcts &) = delete;
+
+    // Searches on a thread of its own and reports through onDone, which runs on that thread
+    void start(const Position &position, Color sideToMove, const MctsLimits &limits, Callback onDone);
+    // Searches on the calling thread, with limits.threads - 1 helpers
+    SearchResult run(const Position &position, Color sideToMove, const MctsLimits &limits);
+    void stop();
+    // Stops any search and forgets the tree
+    void clear();
+
+    // Nodes are playouts, depth the deepest playout and hashfull how much of the pool is used
+    SearchStats liveStats() const;
+    SearchResult lastResult();
+    // Playouts the latest search inherited from the previous tree
+    uint32_t reusedPlayouts() const { return reused; }
+
+private:
+    enum NodeState : uint8_t
+    {
+        Unexpanded,
+        Expanding, // one thread is generating the children
+        Expanded,
+        Mated,     // no moves and in check: lost for the side to move
+        Drawn      // stalemate, repetition, fifty moves or dead material
+    };
+
+    struct Node
+    {
+        std::atomic<uint32_t> visits;
+        std::atomic<uint32_t> virtualLoss;
+        // Sum of the results for the side that played move, in 1/ValueScale units
+        std::atomic<uint64_t> valueSum;
+        std::atomic<uint32_t> firstChild; // pool index, 0 until expanded
+        std::atomic<uint8_t> state;
+        uint8_t childCount;
+        Move move;
+    };
+
+    // Bump allocator over a fixed array; index 0 stands for "no node"
+    struct NodePool
+    {
+        std::unique_ptr<Node[]> nodes;
+        size_t capacity = 0;
+        std::atomic<size_t> used{1};
+
+        uint32_t allocate(size_t count);
+    };
+
+    static constexpr uint64_t ValueScale = 1 << 16;
+    static constexpr int MaxDepth = 128;
+
+    void prepareRoot(const Position &position, Color sideToMove);
+    uint32_t findInTree(const Position &position, Color sideToMove);
+    uint32_t copySubtree(uint32_t from, NodePool &to);
+    void initNode(Node &node, Move move);
+
+    SearchResult search(const Position &position, Color sideToMove, const MctsLimits &limits);
+    void worker(Position position, Color sideToMove, int index);
+    void playout(Position &position, Color sideToMove, uint64_t &rng);
+    uint32_t selectChild(const Node &node) const;
+    bool expand(Node &node, Position &position, Color sideToMove, int depth);
+    double evaluateLeaf(Position &position, Color sideToMove, uint64_t &rng);
+    bool shouldStop() const;
+    SearchResult collectResult(uint64_t playouts) const;
+
+    NodePool pools[2];
+    NodePool *pool = &pools[0];
+    uint32_t root = 0;
+    Position rootPosition;
+    Color rootSide = Color::None;
+
+    std::thread thread;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> searching{false};
+    std::atomic<uint64_t> playouts{0};
+    std::atomic<int> maxDepth{0};
+    std::atomic<int> liveHashfull{0};
+    uint32_t reused = 0;
+
+    // Set by run() for the threads of the current search
+    MctsLimits activeLimits;
+    std::chrono::steady_clock::time_point deadline;
+
+    std::mutex resultMutex;
+    SearchResult result;
+};
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "Nnue.hpp"
+#include "Position.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    struct Network
+    {
+        alignas(32) int16_t featureWeights[Nnue::FeatureCount][Nnue::HiddenSize];
+        alignas(32) int16_t featureBias[Nnue::HiddenSize];
+        alignas(32) int16_t outputWeights[2 * Nnue::HiddenSize];
+        int32_t outputBias;
+    };
+
+    std::unique_ptr<Network> network;
+
+    // Feature index of a piece as seen from one side: own pieces first, board flipped for Black
+    int featureIndex(int perspective, const Piece &piece, int x, int y)
+    {
+        int square = y * 8 + x;
+        bool own = static_cast<int>(piece.color) == (perspective == 0 ? static_cast<int>(Color::White) : static_cast<int>(Color::Black));
+        if (perspective == 1)
+        {
+            square ^= 56;
+        }
+        return (own ? 0 : 384) + static_cast<int>(piece.TroopType) * 64 + square;
+    }
+
+    void addColumn(int16_t *values, const int16_t *column)
+    {
+#if defined(__AVX2__)
+        for (int i = 0; i < Nnue::HiddenSize; i += 16)
+        {
+            __m256i acc = _mm256_load_si256(reinterpret_cast<const __m256i *>(values + i));
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i *>(column + i));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(values + i), _mm256_add_epi16(acc, w));
+        }
+#elif defined(__SSE2__)
+        for (int i = 0; i < Nnue::HiddenSize; i += 8)
+        {
+            __m128i acc = _mm_load_si128(reinterpret_cast<const __m128i *>(values + i));
+            __m128i w = _mm_load_si128(reinterpret_cast<const __m128i *>(column + i));
+            _mm_store_si128(reinterpret_cast<__m128i *>(values + i), _mm_add_epi16(acc, w));
+        }
+#else
+        for (int i = 0; i < Nnue::HiddenSize; i++)
+        {
+            values[i] = static_cast<int16_t>(values[i] + column[i]);
+        }
+#endif
+    }
+
+    void subColumn(int16_t *values, const int16_t *column)
+    {
+#if defined(__AVX2__)
+        for (int i = 0; i < Nnue::HiddenSize; i += 16)
+        {
+            __m256i acc = _mm256_load_si256(reinterpret_cast<const __m256i *>(values + i));
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i *>(column + i));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(values + i), _mm256_sub_epi16(acc, w));
+        }
+#elif defined(__SSE2__)
+        for (int i = 0; i < Nnue::HiddenSize; i += 8)
+        {
+            __m128i acc = _mm_load_si128(reinterpret_cast<const __m128i *>(values + i));
+            __m128i w = _mm_load_si128(reinterpret_cast<const __m128i *>(column + i));
+            _mm_store_si128(reinterpret_cast<__m128i *>(values + i), _mm_sub_epi16(acc, w));
+        }
+#else
+        for (int i = 0; i < Nnue::HiddenSize; i++)
+        {
+            values[i] = static_cast<int16_t>(values[i] - column[i]);
+        }
+#endif
+    }
+
+    // Sum of clamp(values[i], 0, QA) * weights[i]
+    int32_t clippedDot(const int16_t *values, const int16_t *weights)
+    {
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i ceiling = _mm256_set1_epi16(Nnue::QA);
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < Nnue::HiddenSize; i += 16)
+        {
+            __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(values + i));
+            v = _mm256_min_epi16(_mm256_max_epi16(v, zero), ceiling);
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i *>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+        return _mm_cvtsi128_si32(half);
+#elif defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ceiling = _mm_set1_epi16(Nnue::QA);
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < Nnue::HiddenSize; i += 8)
+        {
+            __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(values + i));
+            v = _mm_min_epi16(_mm_max_epi16(v, zero), ceiling);
+            __m128i w = _mm_load_si128(reinterpret_cast<const __m128i *>(weights + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, w));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+        return _mm_cvtsi128_si32(sum);
+#else
+        int32_t sum = 0;
+        for (int i = 0; i < Nnue::HiddenSize; i++)
+        {
+            int32_t v = std::min<int32_t>(std::max<int32_t>(values[i], 0), Nnue::QA);
+            sum += v * weights[i];
+        }
+        return sum;
+#endif
+    }
+}
+
+namespace Nnue
+{
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            return false;
+        }
+
+        char magic[8];
+        uint32_t hiddenSize = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char *>(&hiddenSize), sizeof(hiddenSize));
+        if (!in || std::memcmp(magic, "CHESSNN1", 8) != 0 || hiddenSize != HiddenSize)
+        {
+            std::cerr << "Unsupported network file: " << path << std::endl;
+            return false;
+        }
+
+        auto loaded = std::make_unique<Network>();
+        in.read(reinterpret_cast<char *>(loaded->featureWeights), sizeof(loaded->featureWeights));
+        in.read(reinterpret_cast<char *>(loaded->featureBias), sizeof(loaded->featureBias));
+        in.read(reinterpret_cast<char *>(loaded->outputWeights), sizeof(loaded->outputWeights));
+        in.read(reinterpret_cast<char *>(&loaded->outputBias), sizeof(loaded->outputBias));
+        if (!in)
+        {
+            std::cerr << "Network file is truncated: " << path << std::endl;
+            return false;
+        }
+
+        network = std::move(loaded);
+        return true;
+    }
+
+    bool isLoaded()
+    {
+        return network != nullptr;
+    }
+
+    void refresh(Accumulator &accumulator, const Piece (&board)[8][8])
+    {
+        if (!network)
+        {
+            return;
+        }
+        for (int perspective = 0; perspective < 2; perspective++)
+        {
+            std::memcpy(accumulator.values[perspective], network->featureBias, sizeof(network->featureBias));
+        }
+        for (int y = 0; y < 8; y++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                addPiece(accumulator, board[y][x], x, y);
+            }
+        }
+    }
+
+    void addPiece(Accumulator &accumulator, const Piece &piece, int x, int y)
+    {
+        if (!network || piece.TroopType == Troops::None)
+        {
+            return;
+        }
+        for (int perspective = 0; perspective < 2; perspective++)
+        {
+            addColumn(accumulator.values[perspective], network->featureWeights[featureIndex(perspective, piece, x, y)]);
+        }
+    }
+
+    void removePiece(Accumulator &accumulator, const Piece &piece, int x, int y)
+    {
+        if (!network || piece.TroopType == Troops::None)
+        {
+            return;
+        }
+        for (int perspective = 0; perspective < 2; perspective++)
+        {
+            subColumn(accumulator.values[perspective], network->featureWeights[featureIndex(perspective, piece, x, y)]);
+        }
+    }
+
+    int evaluate(const Accumulator &accumulator, Color sideToMove)
+    {
+        int us = sideToMove == Color::White ? 0 : 1;
+        int64_t sum = clippedDot(accumulator.values[us], network->outputWeights) +
+                      clippedDot(accumulator.values[1 - us], network->outputWeights + HiddenSize);
+        return static_cast<int>((sum + network->outputBias) * OutputScale / (QA * QB));
+    }
+
+    const char *kernelName()
+    {
+#if defined(__AVX2__)
+        return "avx2";
+#elif defined(__SSE2__)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Piece;
+enum class Color : int8_t;
+
+// Optional efficiently updatable network evaluation.
+//
+// Inputs are 768 piece-square features seen from each side (own pieces first, board flipped
+// for Black). Both perspectives share one feature transformer into a HiddenSize accumulator;
+// the side to move's accumulator and the opponent's are clipped to [0, QA] and fed to a single
+// linear output. Positions keep their accumulators up to date with addPiece/removePiece on
+// every board change, so evaluating a leaf is only the output layer.
+//
+// Weights file (little endian, int16 unless noted):
+//   char magic[8] = "CHESSNN1", uint32 hiddenSize (must equal HiddenSize)
+//   featureWeights[768][HiddenSize], featureBias[HiddenSize]
+//   outputWeights[2 * HiddenSize], int32 outputBias
+// The output in centipawns is (sum + outputBias) * OutputScale / (QA * QB).
+namespace Nnue
+{
+    constexpr int HiddenSize = 256;
+    constexpr int FeatureCount = 768;
+    constexpr int QA = 255;
+    constexpr int QB = 64;
+    constexpr int OutputScale = 400;
+
+    struct alignas(32) Accumulator
+    {
+        int16_t values[2][HiddenSize]; // [0] White's perspective, [1] Black's
+    };
+
+    bool load(const std::string &path);
+    bool isLoaded();
+
+    void refresh(Accumulator &accumulator, const Piece (&board)[8][8]);
+    void addPiece(Accumulator &accumulator, const Piece &piece, int x, int y);
+    void removePiece(Accumulator &accumulator, const Piece &piece, int x, int y);
+
+    // Centipawns from the side to move's point of view
+    int evaluate(const Accumulator &accumulator, Color sideToMove);
+
+    // Which kernels this build uses: "avx2", "sse2" or "scalar"
+    const char *kernelName();
+}
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "OpeningExplorer.hpp"
+
+OpeningExplorer::~OpeningExplorer()
+{
+    if (m_mapping)
+    {
+        munmap(const_cast<void *>(m_mapping), m_size);
+    }
+}
+
+bool OpeningExplorer::Open(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ExplorerHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    m_mapping = mapping;
+    m_size = info.st_size;
+
+    const ExplorerHeader *header = static_cast<const ExplorerHeader *>(mapping);
+    if (std::memcmp(header->magic, ExplorerMagic, sizeof(ExplorerMagic)) != 0 || header->version != ExplorerVersion ||
+        sizeof(ExplorerHeader) + header->count * sizeof(ExplorerRecord) > m_size)
+    {
+        std::cerr << "Not a valid explorer index: " << path << std::endl;
+        return false;
+    }
+
+    m_records = reinterpret_cast<const ExplorerRecord *>(static_cast<const char *>(mapping) + sizeof(ExplorerHeader));
+    m_count = header->count;
+    return true;
+}
+
+std::vector<ExplorerMove> OpeningExplorer::lookup(uint64_t positionKey) const
+{
+    std::vector<ExplorerMove> moves;
+    if (!m_records)
+    {
+        return moves;
+    }
+
+    const ExplorerRecord *end = m_records + m_count;
+    const ExplorerRecord *it = std::lower_bound(m_records, end, positionKey, [](const ExplorerRecord &record, uint64_t key)
+                                                { return record.key < key; });
+
+    for (; it != end && it->key == positionKey; ++it)
+    {
+        ExplorerMove move;
+        int from = it->move & 63;
+        int to = (it->move >> 6) & 63;
+        int promo = it->move >> 12;
+        move.move = Move(from % 8, from / 8, to % 8, to / 8, promo ? static_cast<Troops>(promo - 1) : Troops::None);
+        move.whiteWins = it->whiteWins;
+        move.draws = it->draws;
+        move.blackWins = it->blackWins;
+        moves.push_back(move);
+    }
+
+    std::sort(moves.begin(), moves.end(), [](const ExplorerMove &a, const ExplorerMove &b)
+              { return a.games() > b.games(); });
+    return moves;
+}
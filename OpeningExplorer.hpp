@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Position.hpp"
+
+// On-disk opening explorer index written by PgnIndexer (tools/pgn_index.cpp):
+//
+//   ExplorerHeader
+//   ExplorerRecord[count]   sorted by (key, move)
+//
+// key is Position::placementKey() ^ Position::sideKey(side to move), so the GUI can look up
+// the position on its board directly. Castling and en-passant rights are not part of the key.
+
+constexpr char ExplorerMagic[8] = {'C', 'H', 'E', 'S', 'S', 'I', 'D', 'X'};
+constexpr uint32_t ExplorerVersion = 1;
+
+struct ExplorerHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct ExplorerRecord
+{
+    uint64_t key;
+    uint16_t move; // encodeExplorerMove
+    uint16_t reserved;
+    uint32_t whiteWins;
+    uint32_t draws;
+    uint32_t blackWins;
+};
+
+static_assert(sizeof(ExplorerHeader) == 24, "explorer header must stay packed");
+static_assert(sizeof(ExplorerRecord) == 24, "explorer record must stay packed");
+
+// from and to are y * 8 + x board squares; promotion is Troops::None for other moves
+inline uint16_t encodeExplorerMove(int from, int to, Troops promotion)
+{
+    int promo = promotion == Troops::None ? 0 : static_cast<int>(promotion) + 1;
+    return static_cast<uint16_t>(from | (to << 6) | (promo << 12));
+}
+
+struct ExplorerMove
+{
+    Move move; // promotion piece included
+    uint32_t whiteWins = 0;
+    uint32_t draws = 0;
+    uint32_t blackWins = 0;
+
+    uint32_t games() const { return whiteWins + draws + blackWins; }
+};
+
+// Read-only, mmapped view of an index; lookups are a binary search over the records
+class OpeningExplorer
+{
+public:
+    OpeningExplorer() = default;
+    ~OpeningExplorer();
+
+    OpeningExplorer(const OpeningExplorer &) = delete;
+    OpeningExplorer &operator=(const OpeningExplorer &) = delete;
+
+    bool Open(const std::string &path);
+    bool isOpen() const { return m_records != nullptr; }
+
+    // Moves played from the position, most popular first
+    std::vector<ExplorerMove> lookup(uint64_t positionKey) const;
+
+private:
+    const void *m_mapping = nullptr;
+    size_t m_size = 0;
+    const ExplorerRecord *m_records = nullptr;
+    uint64_t m_count = 0;
+};
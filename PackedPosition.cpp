@@ -0,0 +1,158 @@
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "PackedPosition.hpp"
+
+namespace
+{
+    void addPiece(PackedPosition &packed, int &count, int square, Color color, Troops troop)
+    {
+        int code = static_cast<int>(color) * 6 + static_cast<int>(troop);
+        packed.occupancy |= 1ULL << square;
+        packed.pieces[count / 2] |= static_cast<uint8_t>(code << ((count % 2) * 4));
+        count++;
+    }
+
+    bool troopFromLetter(char letter, Troops &troop)
+    {
+        switch (std::tolower(static_cast<unsigned char>(letter)))
+        {
+        case 'b':
+            troop = Troops::Bishop;
+            return true;
+        case 'n':
+            troop = Troops::Knight;
+            return true;
+        case 'r':
+            troop = Troops::Rook;
+            return true;
+        case 'k':
+            troop = Troops::King;
+            return true;
+        case 'q':
+            troop = Troops::Queen;
+            return true;
+        case 'p':
+            troop = Troops::Pawn;
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+PackedPosition packPosition(const Position &position, Color sideToMove)
+{
+    PackedPosition packed = {};
+    int count = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        const Piece &piece = position.get_PieceAt(square % 8, square / 8);
+        if (piece.TroopType != Troops::None && count < 32)
+        {
+            addPiece(packed, count, square, piece.color, piece.TroopType);
+        }
+    }
+    packed.sideToMove = static_cast<uint8_t>(sideToMove);
+    packed.result = static_cast<uint8_t>(GameResult::Draw);
+    packed.halfmoveClock = static_cast<uint16_t>(position.getHalfmoveClock());
+    return packed;
+}
+
+bool packFen(const std::string &fen, PackedPosition &packed)
+{
+    packed = {};
+    int count = 0;
+    int square = 0;
+    size_t i = 0;
+
+    // FEN lists rank 8 first, which is row 0 of the board
+    for (; i < fen.size() && fen[i] != ' '; i++)
+    {
+        char c = fen[i];
+        Troops troop;
+        if (c == '/')
+        {
+            continue;
+        }
+        if (c >= '1' && c <= '8')
+        {
+            square += c - '0';
+        }
+        else if (troopFromLetter(c, troop) && square < 64 && count < 32)
+        {
+            addPiece(packed, count, square++, std::isupper(static_cast<unsigned char>(c)) ? Color::White : Color::Black, troop);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if (square != 64 || i + 1 >= fen.size())
+    {
+        return false;
+    }
+
+    packed.sideToMove = static_cast<uint8_t>(fen[i + 1] == 'b' ? Color::Black : Color::White);
+    packed.result = static_cast<uint8_t>(GameResult::Draw);
+    return true;
+}
+
+PositionFileHeader makePositionFileHeader()
+{
+    PositionFileHeader header = {};
+    std::memcpy(header.magic, PositionFileMagic, sizeof(PositionFileMagic));
+    header.version = PositionFileVersion;
+    return header;
+}
+
+PositionFile::~PositionFile()
+{
+    if (m_mapping)
+    {
+        munmap(const_cast<void *>(m_mapping), m_size);
+    }
+}
+
+bool PositionFile::Open(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(PositionFileHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    m_mapping = mapping;
+    m_size = info.st_size;
+
+    // The records are read once front to back per pass
+    madvise(mapping, m_size, MADV_SEQUENTIAL);
+
+    const PositionFileHeader *header = static_cast<const PositionFileHeader *>(mapping);
+    if (std::memcmp(header->magic, PositionFileMagic, sizeof(PositionFileMagic)) != 0 || header->version != PositionFileVersion)
+    {
+        std::cerr << "Not a positions file: " << path << std::endl;
+        return false;
+    }
+
+    m_records = reinterpret_cast<const PackedPosition *>(static_cast<const char *>(mapping) + sizeof(PositionFileHeader));
+    m_count = (m_size - sizeof(PositionFileHeader)) / sizeof(PackedPosition);
+    return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Position.hpp"
+
+// Fixed 32-byte record for bulk position data (tuning sets, self-play output). A positions file
+// is a PositionFileHeader followed by PackedPosition records until the end of the file, so
+// writers can keep appending and readers can mmap it and walk the records in place.
+
+constexpr char PositionFileMagic[8] = {'C', 'H', 'E', 'S', 'S', 'P', 'O', 'S'};
+constexpr uint32_t PositionFileVersion = 1;
+
+struct PositionFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+enum class GameResult : uint8_t
+{
+    BlackWins,
+    Draw,
+    WhiteWins
+};
+
+struct PackedPosition
+{
+    uint64_t occupancy;  // bit y * 8 + x set for every occupied square
+    uint8_t pieces[16];  // one nibble per occupied square in square order: color * 6 + troop
+    int16_t score;       // search score for White in centipawns, 0 when unknown
+    uint8_t sideToMove;  // Color
+    uint8_t result;      // GameResult
+    uint16_t halfmoveClock;
+    uint16_t ply;
+};
+
+static_assert(sizeof(PositionFileHeader) == 16, "positions header must stay packed");
+static_assert(sizeof(PackedPosition) == 32, "packed position must stay 32 bytes");
+
+PackedPosition packPosition(const Position &position, Color sideToMove);
+
+// Board part of a FEN plus the side to move; castling and en-passant fields are ignored
+bool packFen(const std::string &fen, PackedPosition &packed);
+
+// Calls f(square, color, troop) for every piece, in square order
+template <typename F>
+void forEachPackedPiece(const PackedPosition &packed, F &&f)
+{
+    uint64_t occupied = packed.occupancy;
+    for (int i = 0; occupied; i++, occupied &= occupied - 1)
+    {
+        int square = __builtin_ctzll(occupied);
+        int code = (packed.pieces[i / 2] >> ((i % 2) * 4)) & 15;
+        f(square, static_cast<Color>(code / 6), static_cast<Troops>(code % 6));
+    }
+}
+
+PositionFileHeader makePositionFileHeader();
+
+// Read-only, mmapped view of a positions file
+class PositionFile
+{
+public:
+    PositionFile() = default;
+    ~PositionFile();
+
+    PositionFile(const PositionFile &) = delete;
+    PositionFile &operator=(const PositionFile &) = delete;
+
+    bool Open(const std::string &path);
+    const PackedPosition *data() const { return m_records; }
+    size_t size() const { return m_count; }
+
+private:
+    const void *m_mapping = nullptr;
+    size_t m_size = 0;
+    const PackedPosition *m_records = nullptr;
+    size_t m_count = 0;
+};
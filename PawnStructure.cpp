@@ -0,0 +1,128 @@
+#include "PawnStructure.hpp"
+
+namespace
+{
+    constexpr int PawnTableSize = 4096; // 32-byte entries
+
+    constexpr uint64_t FileA = 0x0101010101010101ull;
+
+    static_assert(sizeof(PawnEntry) == 32, "pawn table entries should stay two to a cache line");
+
+    uint64_t adjacentFiles(int x)
+    {
+        return (x > 0 ? FileA << (x - 1) : 0) | (x < 7 ? FileA << (x + 1) : 0);
+    }
+
+    // Rows a pawn of this colour on row y still has to cross; White moves towards row 0
+    uint64_t rowsAhead(Color color, int y)
+    {
+        if (color == Color::White)
+        {
+            return (1ull << (y * 8)) - 1;
+        }
+        return y == 7 ? 0 : ~((1ull << ((y + 1) * 8)) - 1);
+    }
+
+    bool hasPawn(uint64_t pawns, int x, int y)
+    {
+        return x >= 0 && x < 8 && y >= 0 && y < 8 && (pawns >> (y * 8 + x)) & 1;
+    }
+}
+
+void analysePawns(const uint64_t pawns[2], int counts[2][EvalParams::PawnTermCount], uint64_t passed[2])
+{
+    for (int us = 0; us < 2; us++)
+    {
+        Color color = static_cast<Color>(us);
+        int forward = color == Color::White ? -1 : 1;
+        uint64_t own = pawns[us];
+        uint64_t their = pawns[us ^ 1];
+
+        for (int term = 0; term < EvalParams::PawnTermCount; term++)
+        {
+            counts[us][term] = 0;
+        }
+        passed[us] = 0;
+
+        for (int x = 0; x < 8; x++)
+        {
+            int onFile = __builtin_popcountll(own & (FileA << x));
+            if (onFile > 1)
+            {
+                counts[us][EvalParams::DoubledPawn] += onFile - 1;
+            }
+        }
+
+        for (uint64_t remaining = own; remaining; remaining &= remaining - 1)
+        {
+            int square = __builtin_ctzll(remaining);
+            int x = square % 8;
+            int y = square / 8;
+            uint64_t ahead = rowsAhead(color, y);
+            uint64_t file = FileA << x;
+            uint64_t neighbours = adjacentFiles(x);
+
+            if ((their & (file | neighbours) & ahead) == 0 && (own & file & ahead) == 0)
+            {
+                passed[us] |= 1ull << square;
+                int rank = color == Color::White ? 7 - y : y; // 0 is the colour's own first rank
+                counts[us][EvalParams::PassedPawn + rank]++;
+            }
+
+            if ((own & neighbours) == 0)
+            {
+                counts[us][EvalParams::IsolatedPawn]++;
+            }
+            else if ((own & neighbours & ~ahead) == 0)
+            {
+                // Nothing can come up to defend it; backward once an enemy pawn guards the stop square
+                int stopY = y + forward;
+                if (hasPawn(their, x - 1, stopY + forward) || hasPawn(their, x + 1, stopY + forward))
+                {
+                    counts[us][EvalParams::BackwardPawn]++;
+                }
+            }
+        }
+    }
+}
+
+const PawnEntry &probePawns(uint64_t pawnKey, const uint64_t pawns[2])
+{
+    // Per thread like the game-status cache, so search threads never share entries. A zeroed
+    // entry is already right for key 0, the position without pawns.
+    static thread_local PawnEntry table[PawnTableSize];
+
+    PawnEntry &entry = table[pawnKey & (PawnTableSize - 1)];
+    if (entry.key == pawnKey)
+    {
+        return entry;
+    }
+
+    const EvalParams &params = evalParams();
+    int counts[2][EvalParams::PawnTermCount];
+    analysePawns(pawns, counts, entry.passed);
+
+    int score = 0;
+    for (int term = 0; term < EvalParams::PawnTermCount; term++)
+    {
+        int white = counts[static_cast<int>(Color::White)][term];
+        int black = counts[static_cast<int>(Color::Black)][term];
+        score += params.pawnTerms[term] * (white - black);
+    }
+
+    entry.key = pawnKey;
+    entry.score = static_cast<int16_t>(score);
+    for (int us = 0; us < 2; us++)
+    {
+        uint8_t files = 0;
+        for (int x = 0; x < 8; x++)
+        {
+            if (pawns[us] & (FileA << x))
+            {
+                files |= 1 << x;
+            }
+        }
+        entry.pawnFiles[us] = files;
+    }
+    return entry;
+}
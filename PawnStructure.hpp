@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include "EvalParams.hpp"
+
+// Pawn-structure evaluation. Pawns move rarely compared with everything else in a search, so
+// what depends on the pawns alone is worked out once per pawn configuration and cached in a
+// small table keyed by Position::pawnKey(). Bitboards use bit y * 8 + x, rank 8 first, like
+// the board; pawns[] is indexed by static_cast<int>(Color).
+
+// Everything the evaluation needs to know about one pawn configuration
+struct PawnEntry
+{
+    uint64_t key = 0;
+    int16_t score = 0;         // doubled, isolated, backward and passed pawn terms, White minus Black
+    uint8_t pawnFiles[2] = {}; // bit x set when file x holds a pawn of that colour
+    uint64_t passed[2] = {};   // each colour's passed pawns
+
+    uint8_t openFiles() const { return static_cast<uint8_t>(~(pawnFiles[0] | pawnFiles[1])); }
+    // Files with only the opponent's pawns
+    uint8_t halfOpenFiles(Color color) const
+    {
+        int us = static_cast<int>(color);
+        return static_cast<uint8_t>(~pawnFiles[us] & pawnFiles[us ^ 1]);
+    }
+};
+
+// Counts the pawn-only terms (doubled, isolated, backward and passed by rank) each colour earns
+// and finds the passed pawns; counts is indexed by colour and EvalParams::PawnTerm
+void analysePawns(const uint64_t pawns[2], int counts[2][EvalParams::PawnTermCount], uint64_t passed[2]);
+
+// The cached entry for these pawns, filled in with the current evaluation parameters on a miss.
+// The table is per thread, 128 KB so it stays in L2 next to the search.
+const PawnEntry &probePawns(uint64_t pawnKey, const uint64_t pawns[2]);
+
+// Calls f(term) for every file term a rook or king of the given colour on file x earns from
+// the pawn structure; the evaluation and the tuner share it so they agree on the features
+template <typename F>
+void forEachFileTerm(const PawnEntry &pawns, Troops troop, Color color, int x, F &&f)
+{
+    uint8_t open = pawns.openFiles();
+    uint8_t halfOpen = pawns.halfOpenFiles(color);
+    if (troop == Troops::Rook)
+    {
+        if (open & (1 << x))
+        {
+            f(EvalParams::RookOpenFile);
+        }
+        else if (halfOpen & (1 << x))
+        {
+            f(EvalParams::RookHalfOpenFile);
+        }
+    }
+    else if (troop == Troops::King)
+    {
+        for (int file = x > 0 ? x - 1 : 0; file <= x + 1 && file < 8; file++)
+        {
+            if (open & (1 << file))
+            {
+                f(EvalParams::KingOpenFile);
+            }
+            else if (halfOpen & (1 << file))
+            {
+                f(EvalParams::KingHalfOpenFile);
+            }
+        }
+    }
+}
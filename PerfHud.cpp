@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include "PerfHud.hpp"
+
+namespace
+{
+    constexpr int PanelPadding = 6;
+    constexpr int HistogramHeight = 48;
+    constexpr int MemoryReadMs = 1000;
+    constexpr double BucketLimitsMs[] = {1, 2, 4, 8, 16, 33};
+
+    double millisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    int bucketOf(double frameMs)
+    {
+        int bucket = 0;
+        for (double limit : BucketLimitsMs)
+        {
+            if (frameMs < limit)
+            {
+                break;
+            }
+            bucket++;
+        }
+        return bucket;
+    }
+
+    // Resident set size from /proc; 0 where that isn't available
+    uint64_t readResidentBytes()
+    {
+        std::ifstream statm("/proc/self/statm");
+        uint64_t totalPages = 0;
+        uint64_t residentPages = 0;
+        if (!(statm >> totalPages >> residentPages))
+        {
+            return 0;
+        }
+        return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    std::string formatRate(uint64_t perSecond)
+    {
+        char text[32];
+        if (perSecond >= 1000000)
+        {
+            std::snprintf(text, sizeof(text), "%.2fM", perSecond / 1e6);
+        }
+        else
+        {
+            std::snprintf(text, sizeof(text), "%.0fk", perSecond / 1e3);
+        }
+        return text;
+    }
+}
+
+PerfHud::PerfHud(SDL_Renderer *renderer, TTF_Font *font, int x, int y) : m_renderer(renderer), m_text(renderer, font, x, y)
+{
+}
+
+void PerfHud::addFrame(double frameMs, double presentMs)
+{
+    int slot = m_frameCount % HistoryFrames;
+    m_frameMs[slot] = frameMs;
+    m_presentMs[slot] = presentMs;
+    m_frameCount++;
+}
+
+bool PerfHud::isStale() const
+{
+    return millisecondsBetween(m_lastRefresh, Clock::now()) >= RefreshMs;
+}
+
+void PerfHud::render(const SearchStats &engine, const SearchStats &analysis)
+{
+    Clock::time_point start = Clock::now();
+
+    if (millisecondsBetween(m_lastRefresh, start) >= RefreshMs)
+    {
+        refreshText(engine, analysis, start);
+    }
+
+    m_text.render();
+    SDL_Rect textArea = m_text.bounds();
+    renderHistogram({textArea.x, textArea.y + textArea.h, textArea.w, HistogramHeight});
+
+    m_renderMsPeak = std::max(m_renderMsPeak, millisecondsBetween(start, Clock::now()));
+}
+
+void PerfHud::refreshText(const SearchStats &engine, const SearchStats &analysis, Clock::time_point now)
+{
+    m_lastRefresh = now;
+    m_renderMsShown = m_renderMsPeak;
+    m_renderMsPeak = 0;
+
+    if (millisecondsBetween(m_lastMemoryRead, now) >= MemoryReadMs)
+    {
+        m_lastMemoryRead = now;
+        m_residentBytes = readResidentBytes();
+    }
+
+    int frames = std::min(m_frameCount, HistoryFrames);
+    double frameTotal = 0, frameWorst = 0, presentTotal = 0, presentWorst = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        frameTotal += m_frameMs[i];
+        frameWorst = std::max(frameWorst, m_frameMs[i]);
+        presentTotal += m_presentMs[i];
+        presentWorst = std::max(presentWorst, m_presentMs[i]);
+    }
+    int divisor = std::max(frames, 1);
+
+    std::vector<std::string> lines;
+    char text[96];
+    std::snprintf(text, sizeof(text), "frame %.2f ms avg  %.2f max", frameTotal / divisor, frameWorst);
+    lines.push_back(text);
+    std::snprintf(text, sizeof(text), "present %.2f ms avg  %.2f max", presentTotal / divisor, presentWorst);
+    lines.push_back(text);
+    lines.push_back(describeEngine("engine", engine, m_engineRate, now));
+    lines.push_back(describeEngine("analysis", analysis, m_analysisRate, now));
+    if (m_residentBytes > 0)
+    {
+        std::snprintf(text, sizeof(text), "memory %.1f MB", m_residentBytes / (1024.0 * 1024.0));
+    }
+    else
+    {
+        std::snprintf(text, sizeof(text), "memory n/a");
+    }
+    lines.push_back(text);
+    std::snprintf(text, sizeof(text), "hud %.3f ms", m_renderMsShown);
+    lines.push_back(text);
+    std::snprintf(text, sizeof(text), "last %d frames: <1 <2 <4 <8 <16 <33 ms, slower", frames);
+    lines.push_back(text);
+
+    m_text.setLines(lines);
+}
+
+std::string PerfHud::describeEngine(const char *name, const SearchStats &stats, NodeRate &rate, Clock::time_point now) const
+{
+    // A new search starts counting from zero again
+    uint64_t previousNodes = stats.nodes >= rate.nodes ? rate.nodes : 0;
+    double seconds = millisecondsBetween(rate.time, now) / 1000.0;
+    uint64_t perSecond = seconds > 0 ? static_cast<uint64_t>((stats.nodes - previousNodes) / seconds) : 0;
+    rate.nodes = stats.nodes;
+    rate.time = now;
+
+    char text[96];
+    if (!stats.searching)
+    {
+        std::snprintf(text, sizeof(text), "%s idle  hash %.1f%%", name, stats.hashfull / 10.0);
+    }
+    else
+    {
+        std::snprintf(text, sizeof(text), "%s %s  depth %d  %s nps  hash %.1f%%", name, stats.pondering ? "pondering" : "thinking",
+                      stats.depth, formatRate(perSecond).c_str(), stats.hashfull / 10.0);
+    }
+    return text;
+}
+
+void PerfHud::renderHistogram(const SDL_Rect &area)
+{
+    if (area.w == 0)
+    {
+        return;
+    }
+
+    int counts[BucketCount] = {};
+    int frames = std::min(m_frameCount, HistoryFrames);
+    for (int i = 0; i < frames; i++)
+    {
+        counts[bucketOf(m_frameMs[i])]++;
+    }
+    int tallest = std::max(1, *std::max_element(counts, counts + BucketCount));
+
+    SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(m_renderer, 0x00, 0x00, 0x00, 0xb0);
+    SDL_RenderFillRect(m_renderer, &area);
+    SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_NONE);
+
+    // Green fits a 60 Hz frame, yellow a 30 Hz one, red misses both
+    int barWidth = (area.w - 2 * PanelPadding) / BucketCount;
+    int barSpace = HistogramHeight - 2 * PanelPadding;
+    for (int bucket = 0; bucket < BucketCount; bucket++)
+    {
+        if (bucket < 5)
+        {
+            SDL_SetRenderDrawColor(m_renderer, 0x40, 0xd0, 0x40, 0xff);
+        }
+        else if (bucket == 5)
+        {
+            SDL_SetRenderDrawColor(m_renderer, 0xe0, 0xc0, 0x30, 0xff);
+        }
+        else
+        {
+            SDL_SetRenderDrawColor(m_renderer, 0xe0, 0x40, 0x30, 0xff);
+        }
+        int height = std::max(counts[bucket] > 0 ? 1 : 0, counts[bucket] * barSpace / tallest);
+        SDL_Rect bar = {area.x + PanelPadding + bucket * barWidth, area.y + area.h - PanelPadding - height, barWidth - 2, height};
+        SDL_RenderFillRect(m_renderer, &bar);
+    }
+}
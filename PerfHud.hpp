@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "AnalysisOverlay.hpp"
+#include "Search.hpp"
+
+// Performance panel for spotting trouble on a deployed machine without a profiler: frame time
+// with a histogram of the recent frames, present latency, what each engine is doing and how
+// fast, and the process's resident memory. The main loop reports every frame it draws through
+// addFrame() and the engines are read through Search::liveStats().
+//
+// The text is only re-rasterised every RefreshMs and the histogram is a few filled rects, so
+// the panel costs a small fraction of a millisecond; it times its own render() and shows that
+// too.
+class PerfHud
+{
+public:
+    PerfHud(SDL_Renderer *renderer, TTF_Font *font, int x, int y);
+
+    PerfHud(const PerfHud &) = delete;
+    PerfHud &operator=(const PerfHud &) = delete;
+
+    // frameMs runs from waking up for events to the end of the present
+    void addFrame(double frameMs, double presentMs);
+    // True once the numbers on screen are older than RefreshMs
+    bool isStale() const;
+    void render(const SearchStats &engine, const SearchStats &analysis);
+
+    static constexpr int RefreshMs = 250;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int HistoryFrames = 120;
+    static constexpr int BucketCount = 7; // under 1, 2, 4, 8, 16 and 33 ms, then slower
+
+    // Node count at the last refresh, to turn the running total into a rate
+    struct NodeRate
+    {
+        uint64_t nodes = 0;
+        Clock::time_point time;
+    };
+
+    void refreshText(const SearchStats &engine, const SearchStats &analysis, Clock::time_point now);
+    std::string describeEngine(const char *name, const SearchStats &stats, NodeRate &rate, Clock::time_point now) const;
+    void renderHistogram(const SDL_Rect &area);
+
+    SDL_Renderer *m_renderer;
+    AnalysisOverlay m_text;
+
+    double m_frameMs[HistoryFrames] = {};
+    double m_presentMs[HistoryFrames] = {};
+    int m_frameCount = 0; // frames added so far; the ring holds the last HistoryFrames of them
+
+    Clock::time_point m_lastRefresh;
+    Clock::time_point m_lastMemoryRead;
+    uint64_t m_residentBytes = 0;
+    NodeRate m_engineRate;
+    NodeRate m_analysisRate;
+
+    double m_renderMsPeak = 0;  // slowest render() since the last refresh
+    double m_renderMsShown = 0; // the peak of the previous refresh period, as displayed
+};
@@ -0,0 +1,549 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "Pgn.hpp"
+
+namespace
+{
+    enum class GameResult
+    {
+        WhiteWins,
+        Draw,
+        BlackWins,
+        Unknown
+    };
+
+    // Compact board for replaying SAN. Squares are y * 8 + x like Position, so keys match
+    // Position::placementKey() ^ Position::sideKey(side). Castling and en passant are recognised from
+    // the move itself, which is all replaying already-legal games needs.
+    class ReplayBoard
+    {
+    public:
+        void reset()
+        {
+            static const Troops backRank[8] = {Troops::Rook, Troops::Knight, Troops::Bishop, Troops::Queen,
+                                               Troops::King, Troops::Bishop, Troops::Knight, Troops::Rook};
+            placementKey = 0;
+            for (int sq = 0; sq < 64; sq++)
+            {
+                squares[sq] = Piece();
+            }
+            for (int x = 0; x < 8; x++)
+            {
+                put(x, Piece(backRank[x], Color::Black));
+                put(8 + x, Piece(Troops::Pawn, Color::Black));
+                put(48 + x, Piece(Troops::Pawn, Color::White));
+                put(56 + x, Piece(backRank[x], Color::White));
+            }
+            sideToMove = Color::White;
+        }
+
+        uint64_t key() const { return placementKey ^ Position::sideKey(sideToMove); }
+
+        // Plays one SAN move; returns the encoded move, or 0 if it can't be played
+        uint16_t playSan(const char *san, size_t length);
+
+    private:
+        void put(int sq, Piece piece)
+        {
+            placementKey ^= Position::pieceKey(squares[sq], sq % 8, sq / 8) ^ Position::pieceKey(piece, sq % 8, sq / 8);
+            squares[sq] = piece;
+        }
+
+        bool reaches(int from, int to) const;
+        bool attacked(int sq, Color by) const;
+        bool leavesKingSafe(int from, int to);
+        void play(int from, int to, Troops promotion);
+
+        Piece squares[64];
+        uint64_t placementKey = 0;
+        Color sideToMove = Color::White;
+    };
+
+    int sign(int v)
+    {
+        return (v > 0) - (v < 0);
+    }
+
+    // Whether the piece on from attacks or moves to `to` by geometry and a clear path (pawn
+    // captures only; pushes are handled separately)
+    bool ReplayBoard::reaches(int from, int to) const
+    {
+        const Piece &piece = squares[from];
+        int dx = to % 8 - from % 8;
+        int dy = to / 8 - from / 8;
+        int adx = std::abs(dx), ady = std::abs(dy);
+
+        switch (piece.TroopType)
+        {
+        case Troops::Pawn:
+            return adx == 1 && dy == (piece.color == Color::White ? -1 : 1);
+        case Troops::Knight:
+            return (adx == 1 && ady == 2) || (adx == 2 && ady == 1);
+        case Troops::King:
+            return std::max(adx, ady) == 1;
+        case Troops::Bishop:
+            if (adx != ady || adx == 0)
+                return false;
+            break;
+        case Troops::Rook:
+            if ((dx != 0 && dy != 0) || (dx == 0 && dy == 0))
+                return false;
+            break;
+        case Troops::Queen:
+            if ((adx != ady && dx != 0 && dy != 0) || (dx == 0 && dy == 0))
+                return false;
+            break;
+        default:
+            return false;
+        }
+
+        int step = sign(dy) * 8 + sign(dx);
+        for (int sq = from + step; sq != to; sq += step)
+        {
+            if (squares[sq].TroopType != Troops::None)
+                return false;
+        }
+        return true;
+    }
+
+    bool ReplayBoard::attacked(int sq, Color by) const
+    {
+        for (int from = 0; from < 64; from++)
+        {
+            if (squares[from].color == by && reaches(from, sq))
+                return true;
+        }
+        return false;
+    }
+
+    bool ReplayBoard::leavesKingSafe(int from, int to)
+    {
+        Piece moved = squares[from];
+        Piece captured = squares[to];
+        squares[to] = moved;
+        squares[from] = Piece();
+
+        int king = 0;
+        while (king < 64 && !(squares[king].isKing() && squares[king].color == moved.color))
+            king++;
+        bool safe = king == 64 || !attacked(king, Position::getOppositeColor(moved.color));
+
+        squares[from] = moved;
+        squares[to] = captured;
+        return safe;
+    }
+
+    void ReplayBoard::play(int from, int to, Troops promotion)
+    {
+        Piece moved = squares[from];
+
+        // En passant: a pawn moving diagonally onto an empty square takes the pawn beside it
+        if (moved.TroopType == Troops::Pawn && from % 8 != to % 8 && squares[to].TroopType == Troops::None)
+        {
+            put(from / 8 * 8 + to % 8, Piece());
+        }
+        // Castling: the king moves two files and the rook jumps over it
+        if (moved.isKing() && std::abs(to % 8 - from % 8) == 2)
+        {
+            int rank = from / 8 * 8;
+            bool kingSide = to % 8 == 6;
+            put(rank + (kingSide ? 5 : 3), squares[rank + (kingSide ? 7 : 0)]);
+            put(rank + (kingSide ? 7 : 0), Piece());
+        }
+
+        put(to, promotion == Troops::None ? moved : Piece(promotion, moved.color));
+        put(from, Piece());
+        sideToMove = Position::getOppositeColor(sideToMove);
+    }
+
+    uint16_t ReplayBoard::playSan(const char *san, size_t length)
+    {
+        // Drop check, mate and annotation suffixes
+        while (length > 0 && std::strchr("+#!?", san[length - 1]))
+            length--;
+        if (length < 2)
+            return 0;
+
+        int backRank = sideToMove == Color::White ? 56 : 0;
+
+        if (san[0] == 'O' || san[0] == '0')
+        {
+            bool queenSide = length >= 5;
+            int from = backRank + 4;
+            int to = backRank + (queenSide ? 2 : 6);
+            if (!squares[from].isKing())
+                return 0;
+            play(from, to, Troops::None);
+            return encodeExplorerMove(from, to, Troops::None);
+        }
+
+        Troops troop = Troops::Pawn;
+        size_t i = 0;
+        switch (san[0])
+        {
+        case 'N': troop = Troops::Knight; i = 1; break;
+        case 'B': troop = Troops::Bishop; i = 1; break;
+        case 'R': troop = Troops::Rook; i = 1; break;
+        case 'Q': troop = Troops::Queen; i = 1; break;
+        case 'K': troop = Troops::King; i = 1; break;
+        default: break;
+        }
+
+        Troops promotion = Troops::None;
+        if (length >= 2 && san[length - 2] == '=')
+        {
+            switch (san[length - 1])
+            {
+            case 'N': promotion = Troops::Knight; break;
+            case 'B': promotion = Troops::Bishop; break;
+            case 'R': promotion = Troops::Rook; break;
+            case 'Q': promotion = Troops::Queen; break;
+            default: return 0;
+            }
+            length -= 2;
+        }
+
+        // Destination is the last two characters; whatever sits between piece letter and
+        // destination is disambiguation and/or the capture mark
+        if (length < i + 2)
+            return 0;
+        int toX = san[length - 2] - 'a';
+        int toY = '8' - san[length - 1];
+        if (toX < 0 || toX > 7 || toY < 0 || toY > 7)
+            return 0;
+        int to = toY * 8 + toX;
+
+        int fromX = -1, fromY = -1;
+        bool capture = false;
+        for (size_t j = i; j < length - 2; j++)
+        {
+            char c = san[j];
+            if (c >= 'a' && c <= 'h')
+                fromX = c - 'a';
+            else if (c >= '1' && c <= '8')
+                fromY = '8' - c;
+            else if (c == 'x')
+                capture = true;
+        }
+
+        int from = -1;
+        if (troop == Troops::Pawn && !capture)
+        {
+            int dir = sideToMove == Color::White ? 8 : -8; // back towards the pawn's origin
+            int one = to + dir;
+            if (one >= 0 && one < 64 && squares[one].TroopType == Troops::Pawn && squares[one].color == sideToMove)
+                from = one;
+            else if (one + dir >= 0 && one + dir < 64 && squares[one].TroopType == Troops::None &&
+                     squares[one + dir].TroopType == Troops::Pawn && squares[one + dir].color == sideToMove)
+                from = one + dir;
+        }
+        else
+        {
+            for (int sq = 0; sq < 64; sq++)
+            {
+                const Piece &piece = squares[sq];
+                if (piece.TroopType != troop || piece.color != sideToMove)
+                    continue;
+                if ((fromX >= 0 && sq % 8 != fromX) || (fromY >= 0 && sq / 8 != fromY))
+                    continue;
+                if (!reaches(sq, to) || !leavesKingSafe(sq, to))
+                    continue;
+                from = sq;
+                break;
+            }
+        }
+
+        if (from < 0)
+            return 0;
+        play(from, to, promotion);
+        return encodeExplorerMove(from, to, promotion);
+    }
+
+    // Parses one chunk of PGN text, adding every game's first maxPlies (position, move)
+    // pairs to the tally under the game's result
+    void parseChunk(const char *text, const char *end, int maxPlies, PgnIndexer::Tally &tally, PgnStats &stats)
+    {
+        ReplayBoard board;
+        std::vector<PgnIndexer::SampleKey> samples;
+        samples.reserve(maxPlies);
+
+        GameResult tagResult = GameResult::Unknown;
+        bool inGame = false;   // movetext seen since the last game was committed
+        bool skipGame = false; // custom start position or a move we couldn't replay
+        int ply = 0;
+
+        auto beginGame = [&]()
+        {
+            board.reset();
+            samples.clear();
+            tagResult = GameResult::Unknown;
+            skipGame = false;
+            ply = 0;
+        };
+
+        auto commitGame = [&](GameResult result)
+        {
+            if (result == GameResult::Unknown)
+                result = tagResult;
+            if (skipGame || result == GameResult::Unknown)
+            {
+                stats.skipped++;
+            }
+            else
+            {
+                for (const auto &sample : samples)
+                {
+                    PgnIndexer::Results &counts = tally[sample];
+                    if (result == GameResult::WhiteWins)
+                        counts.whiteWins++;
+                    else if (result == GameResult::BlackWins)
+                        counts.blackWins++;
+                    else
+                        counts.draws++;
+                }
+                stats.games++;
+                stats.positions += samples.size();
+            }
+            inGame = false;
+            beginGame();
+        };
+
+        auto parseResult = [](const char *s, size_t n)
+        {
+            if (n == 3 && std::memcmp(s, "1-0", 3) == 0)
+                return GameResult::WhiteWins;
+            if (n == 3 && std::memcmp(s, "0-1", 3) == 0)
+                return GameResult::BlackWins;
+            if (n == 7 && std::memcmp(s, "1/2-1/2", 7) == 0)
+                return GameResult::Draw;
+            return GameResult::Unknown;
+        };
+
+        beginGame();
+        const char *p = text;
+        while (p < end)
+        {
+            char c = *p;
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+            {
+                p++;
+            }
+            else if (c == '[')
+            {
+                // A tag after movetext means the previous game had no terminator
+                if (inGame)
+                    commitGame(GameResult::Unknown);
+
+                const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+                if (!lineEnd)
+                    lineEnd = end;
+
+                const char *name = p + 1;
+                const char *quote = static_cast<const char *>(std::memchr(name, '"', lineEnd - name));
+                if (quote)
+                {
+                    size_t nameLength = quote - name;
+                    while (nameLength > 0 && name[nameLength - 1] == ' ')
+                        nameLength--;
+                    const char *value = quote + 1;
+                    const char *valueEnd = static_cast<const char *>(std::memchr(value, '"', lineEnd - value));
+                    if (valueEnd)
+                    {
+                        if (nameLength == 6 && std::memcmp(name, "Result", 6) == 0)
+                            tagResult = parseResult(value, valueEnd - value);
+                        else if (nameLength == 3 && std::memcmp(name, "FEN", 3) == 0)
+                            skipGame = true;
+                    }
+                }
+                p = lineEnd;
+            }
+            else if (c == '{')
+            {
+                const char *close = static_cast<const char *>(std::memchr(p, '}', end - p));
+                p = close ? close + 1 : end;
+            }
+            else if (c == ';' || c == '%')
+            {
+                const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+                p = lineEnd ? lineEnd : end;
+            }
+            else if (c == '(')
+            {
+                // Variations can nest and contain comments with parentheses
+                int depth = 0;
+                for (; p < end; p++)
+                {
+                    if (*p == '{')
+                    {
+                        const char *close = static_cast<const char *>(std::memchr(p, '}', end - p));
+                        p = close ? close : end - 1;
+                    }
+                    else if (*p == '(')
+                        depth++;
+                    else if (*p == ')' && --depth == 0)
+                    {
+                        p++;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                const char *tokenEnd = p;
+                while (tokenEnd < end && !std::strchr(" \n\r\t{}();[", *tokenEnd))
+                    tokenEnd++;
+                size_t length = tokenEnd - p;
+                inGame = true;
+
+                GameResult result = parseResult(p, length);
+                bool castlingWithZeros = c == '0' && length > 1 && p[1] == '-';
+
+                if (c == '*' || result != GameResult::Unknown)
+                {
+                    commitGame(result);
+                }
+                else if (c == '$' || (c >= '0' && c <= '9' && !castlingWithZeros))
+                {
+                    // NAG or move number; a number can run straight into the move ("1.e4")
+                    const char *dot = p;
+                    while (dot < tokenEnd && (std::isdigit(static_cast<unsigned char>(*dot)) || *dot == '.'))
+                        dot++;
+                    if (c != '$' && dot < tokenEnd && dot > p && dot[-1] == '.')
+                    {
+                        tokenEnd = dot; // reparse the move part next iteration
+                    }
+                }
+                else if (!skipGame)
+                {
+                    uint64_t key = board.key();
+                    uint16_t move = board.playSan(p, length);
+                    if (!move)
+                        skipGame = true;
+                    else if (ply++ < maxPlies)
+                        samples.push_back({key, move});
+                }
+                p = tokenEnd;
+            }
+        }
+
+        if (inGame)
+            commitGame(GameResult::Unknown);
+    }
+}
+
+bool PgnIndexer::addFile(const std::string &path, int threadCount)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    if (info.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Failed to map " << path << std::endl;
+        return false;
+    }
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    const char *text = static_cast<const char *>(mapping);
+    const char *end = text + info.st_size;
+
+    // Split at "\n[Event " boundaries closest to equal-sized pieces
+    threadCount = std::max(1, threadCount);
+    std::vector<const char *> bounds = {text};
+    for (int i = 1; i < threadCount; i++)
+    {
+        const char *target = std::max(bounds.back(), text + info.st_size * i / threadCount);
+        const char *found = static_cast<const char *>(memmem(target, end - target, "\n[Event ", 8));
+        if (!found)
+            break;
+        bounds.push_back(found + 1);
+    }
+    bounds.push_back(end);
+
+    size_t chunkCount = bounds.size() - 1;
+    std::vector<Tally> tallies(chunkCount);
+    std::vector<PgnStats> chunkStats(chunkCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        workers.emplace_back(parseChunk, bounds[i], bounds[i + 1], m_maxPlies, std::ref(tallies[i]), std::ref(chunkStats[i]));
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    munmap(mapping, info.st_size);
+
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        for (const auto &entry : tallies[i])
+        {
+            Results &counts = m_tally[entry.first];
+            counts.whiteWins += entry.second.whiteWins;
+            counts.draws += entry.second.draws;
+            counts.blackWins += entry.second.blackWins;
+        }
+        m_stats.games += chunkStats[i].games;
+        m_stats.skipped += chunkStats[i].skipped;
+        m_stats.positions += chunkStats[i].positions;
+    }
+    return true;
+}
+
+bool PgnIndexer::write(const std::string &indexPath) const
+{
+    std::vector<ExplorerRecord> records;
+    records.reserve(m_tally.size());
+    for (const auto &entry : m_tally)
+    {
+        records.push_back({entry.first.position, entry.first.move, 0, entry.second.whiteWins, entry.second.draws, entry.second.blackWins});
+    }
+    std::sort(records.begin(), records.end(), [](const ExplorerRecord &a, const ExplorerRecord &b)
+              { return a.key != b.key ? a.key < b.key : a.move < b.move; });
+
+    ExplorerHeader header;
+    std::memcpy(header.magic, ExplorerMagic, sizeof(header.magic));
+    header.version = ExplorerVersion;
+    header.reserved = 0;
+    header.count = records.size();
+
+    // Write next to the destination and rename, so a running GUI never maps a half-written index
+    std::string temporary = indexPath + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(ExplorerRecord));
+    out.close();
+    if (!out)
+    {
+        std::cerr << "Failed to write " << temporary << std::endl;
+        return false;
+    }
+    return std::rename(temporary.c_str(), indexPath.c_str()) == 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "OpeningExplorer.hpp"
+
+struct PgnStats
+{
+    uint64_t games = 0;
+    uint64_t skipped = 0;    // games with a custom start position or moves that didn't replay
+    uint64_t positions = 0;  // (position, move) samples added to the index
+};
+
+// Streams PGN files into opening explorer counts. Each file is mmapped and split into
+// chunks on game boundaries that are parsed in parallel; every chunk replays its games'
+// SAN moves on a compact board and tallies (position, move, result), and the per-chunk
+// tallies are merged at the end.
+class PgnIndexer
+{
+public:
+    explicit PgnIndexer(int maxPlies = 40) : m_maxPlies(maxPlies) {}
+
+    bool addFile(const std::string &path, int threadCount);
+    bool write(const std::string &indexPath) const;
+
+    const PgnStats &stats() const { return m_stats; }
+
+    // Key/value of the in-memory tally; public so the parser in Pgn.cpp can share the types
+    struct SampleKey
+    {
+        uint64_t position;
+        uint16_t move;
+        bool operator==(const SampleKey &other) const { return position == other.position && move == other.move; }
+    };
+    struct SampleKeyHash
+    {
+        size_t operator()(const SampleKey &key) const { return key.position ^ (key.move * 0x9E3779B97F4A7C15ull); }
+    };
+    struct Results
+    {
+        uint32_t whiteWins = 0;
+        uint32_t draws = 0;
+        uint32_t blackWins = 0;
+    };
+    using Tally = std::unordered_map<SampleKey, Results, SampleKeyHash>;
+
+private:
+    int m_maxPlies;
+    PgnStats m_stats;
+    Tally m_tally;
+};
@@ -0,0 +1,1136 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include "AttackMaps.hpp"
+#include "EvalParams.hpp"
+#include "PawnStructure.hpp"
+#include "Position.hpp"
+#include "Trace.hpp"
+
+namespace
+{
+    // Zobrist keys, generated at compile time from a fixed seed so hashes are reproducible
+    struct ZobristKeys
+    {
+        uint64_t pieces[2][6][64] = {};
+        uint64_t blackToMove = 0;
+        uint64_t castling[16] = {};
+        uint64_t enPassantFile[8] = {};
+
+        constexpr ZobristKeys()
+        {
+            uint64_t state = 0x9E3779B97F4A7C15ull;
+            auto next = [&state]()
+            {
+                uint64_t z = splitmix(state);
+                state += 0x9E3779B97F4A7C15ull;
+                return z;
+            };
+            for (auto &color : pieces)
+                for (auto &troop : color)
+                    for (auto &square : troop)
+                        square = next();
+            blackToMove = next();
+            // Drawn after the piece keys so those (and existing explorer indexes) stay the same
+            for (int rights = 1; rights < 16; rights++)
+                castling[rights] = next();
+            for (auto &file : enPassantFile)
+                file = next();
+        }
+    };
+
+    constexpr ZobristKeys zobrist;
+
+    // Leaper attack sets as square bitboards (bit y * 8 + x), built at compile time
+    struct AttackTables
+    {
+        uint64_t knight[64] = {};
+        uint64_t king[64] = {};
+        uint64_t pawn[2][64] = {}; // squares a pawn of that colour attacks, indexed by Color
+
+        constexpr AttackTables()
+        {
+            constexpr int knightSteps[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+            constexpr int kingSteps[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+            for (int square = 0; square < 64; square++)
+            {
+                int x = square % 8;
+                int y = square / 8;
+                for (int i = 0; i < 8; i++)
+                {
+                    knight[square] |= bit(x + knightSteps[i][0], y + knightSteps[i][1]);
+                    king[square] |= bit(x + kingSteps[i][0], y + kingSteps[i][1]);
+                }
+                // Black pawns move down the board (towards row 7), White pawns up
+                pawn[static_cast<int>(Color::Black)][square] = bit(x - 1, y + 1) | bit(x + 1, y + 1);
+                pawn[static_cast<int>(Color::White)][square] = bit(x - 1, y - 1) | bit(x + 1, y - 1);
+            }
+        }
+
+        static constexpr uint64_t bit(int x, int y)
+        {
+            return (x >= 0 && x < 8 && y >= 0 && y < 8) ? 1ULL << (y * 8 + x) : 0;
+        }
+    };
+
+    constexpr AttackTables attacks;
+
+    // Rights still allowed after a move touches the square: moving the king or a rook, or
+    // capturing a rook on its home square, clears the matching rights
+    struct CastlingMasks
+    {
+        uint8_t squares[64] = {};
+
+        constexpr CastlingMasks()
+        {
+            for (auto &mask : squares)
+                mask = AllCastlingRights;
+            squares[0] &= ~BlackQueenside;
+            squares[4] &= ~(BlackKingside | BlackQueenside);
+            squares[7] &= ~BlackKingside;
+            squares[56] &= ~WhiteQueenside;
+            squares[60] &= ~(WhiteKingside | WhiteQueenside);
+            squares[63] &= ~WhiteKingside;
+        }
+    };
+
+    constexpr CastlingMasks castlingMasks;
+
+    constexpr Troops PromotionPieces[4] = {Troops::Queen, Troops::Rook, Troops::Bishop, Troops::Knight};
+
+    uint64_t enPassantKey(int square)
+    {
+        return square < 0 ? 0 : zobrist.enPassantFile[square % 8];
+    }
+
+    // Straight lines first, then diagonals
+    constexpr int QueenDirections[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+    constexpr int colorIndex(Color color)
+    {
+        return static_cast<int>(color);
+    }
+
+    inline int popSquare(uint64_t &squares)
+    {
+        int square = __builtin_ctzll(squares);
+        squares &= squares - 1;
+        return square;
+    }
+}
+
+std::string moveToString(const Move &move)
+{
+    if (move.isNull())
+    {
+        return "0000";
+    }
+    std::string text;
+    text += static_cast<char>('a' + move.srcX);
+    text += static_cast<char>('8' - move.srcY);
+    text += static_cast<char>('a' + move.destX);
+    text += static_cast<char>('8' - move.destY);
+    if (move.promotion != Troops::None)
+    {
+        text += static_cast<char>(std::tolower(Position::get_PieceAtdata(Piece(move.promotion, Color::Black))));
+    }
+    return text;
+}
+
+Position::Position()
+{
+    SetupBoard();
+}
+
+uint64_t Position::sideKey(Color sideToMove)
+{
+    return sideToMove == Color::Black ? zobrist.blackToMove : 0;
+}
+
+uint64_t Position::placementKey() const
+{
+    return state.key ^ zobrist.castling[state.castlingRights] ^ enPassantKey(state.enPassantSquare);
+}
+
+uint64_t Position::pieceKey(const Piece &piece, int x, int y)
+{
+    if (piece.TroopType == Troops::None)
+    {
+        return 0;
+    }
+    return zobrist.pieces[static_cast<int>(piece.color)][static_cast<int>(piece.TroopType)][y * 8 + x];
+}
+
+void Position::setPiece(int x, int y, Piece piece)
+{
+    state.key ^= pieceKey(board[y][x], x, y) ^ pieceKey(piece, x, y);
+    if (board[y][x].TroopType == Troops::Pawn)
+    {
+        state.pawnKey ^= pieceKey(board[y][x], x, y);
+    }
+    if (piece.TroopType == Troops::Pawn)
+    {
+        state.pawnKey ^= pieceKey(piece, x, y);
+    }
+    Nnue::removePiece(accumulator, board[y][x], x, y);
+    Nnue::addPiece(accumulator, piece, x, y);
+    board[y][x] = piece;
+}
+
+GameStatus Position::gameStatus(Color sideToMove)
+{
+    TRACE_ZONE("gameStatus");
+    struct CachedStatus
+    {
+        uint64_t key;
+        GameStatus status;
+    };
+    // Per thread, so the GUI and the search threads never share entries
+    static thread_local CachedStatus statusCache[1024] = {};
+
+    uint64_t fullKey = state.key ^ sideKey(sideToMove);
+    CachedStatus &cached = statusCache[fullKey & 1023];
+
+    if (cached.key != fullKey)
+    {
+        GameStatus status = GameStatus::Ongoing;
+        if (!hasLegalMove(sideToMove))
+        {
+            std::pair<int, int> king = findKingPosition(sideToMove);
+            status = IsKingCheck(king.first, king.second, sideToMove) ? GameStatus::Checkmate : GameStatus::Stalemate;
+        }
+        else if (isInsufficientMaterial())
+        {
+            status = GameStatus::InsufficientMaterial;
+        }
+        cached = {fullKey, status};
+    }
+
+    if (cached.status != GameStatus::Ongoing)
+    {
+        return cached.status;
+    }
+    if (repetitions() >= 2)
+    {
+        return GameStatus::ThreefoldRepetition;
+    }
+    if (state.halfmoveClock >= 100)
+    {
+        return GameStatus::FiftyMoveRule;
+    }
+    return GameStatus::Ongoing;
+}
+
+bool Position::hasLegalMove(Color color)
+{
+    return color == Color::White ? hasLegalMove<Color::White>() : hasLegalMove<Color::Black>();
+}
+
+template <Color Us>
+bool Position::hasLegalMove()
+{
+    std::pair<int, int> kingPosition = findKingPosition(Us);
+    for (const Move &move : generateAllMoves<Us>())
+    {
+        if (isLegal<Us>(move, kingPosition))
+        {
+            return true; // A move is possible
+        }
+    }
+    return false;
+}
+
+int Position::repetitions() const
+{
+    // Only positions since the last capture or pawn move can repeat this one
+    int count = 0;
+    int last = undoCount;
+    int oldest = std::max(0, last - state.halfmoveClock);
+
+    for (int i = last - 2; i >= oldest; i -= 2)
+    {
+        if (undoStack[i].state.key == state.key)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool Position::isInsufficientMaterial() const
+{
+    int minorPieces = 0;
+    int bishopSquareColors = 0; // bit 0: a bishop on a light square, bit 1: on a dark square
+    bool onlyBishops = true;
+
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            switch (board[y][x].TroopType)
+            {
+            case Troops::Pawn:
+            case Troops::Rook:
+            case Troops::Queen:
+                return false;
+            case Troops::Knight:
+                minorPieces++;
+                onlyBishops = false;
+                break;
+            case Troops::Bishop:
+                minorPieces++;
+                bishopSquareColors |= 1 << ((x + y) % 2);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // Lone kings, a single minor piece, or bishops that all live on one square colour
+    return minorPieces <= 1 || (onlyBishops && bishopSquareColors != 3);
+}
+
+bool Position::isOpponentPiece(int x, int y, Color currentPlayerColor) const
+{
+
+    if (!isInsideBoard(x, y) || isEmpty(x, y))
+    {
+        return false;
+    }
+
+    return board[y][x].color != currentPlayerColor;
+}
+
+bool Position::isFriendlyPiece(int x, int y, Color currentPlayerColor) const
+{
+    if (!isInsideBoard(x, y) || isEmpty(x, y))
+    {
+        return false;
+    }
+
+    return board[y][x].color == currentPlayerColor;
+}
+
+std::vector<std::pair<int, int>> Position::getLegalMoves(Piece piece, int x, int y) const
+{
+    std::vector<Move> pieceMoves;
+    if (piece.color == Color::White)
+    {
+        generatePieceMoves<Color::White>(piece.TroopType, x, y, pieceMoves);
+    }
+    else if (piece.color == Color::Black)
+    {
+        generatePieceMoves<Color::Black>(piece.TroopType, x, y, pieceMoves);
+    }
+
+    std::vector<std::pair<int, int>> moves;
+    for (const Move &move : pieceMoves)
+    {
+        // One square per promotion; the piece is chosen when the move is played
+        if (move.promotion == Troops::None || move.promotion == Troops::Queen)
+        {
+            moves.push_back({move.destX, move.destY});
+        }
+    }
+    return moves;
+}
+
+template <Color Us, Troops Type>
+void Position::generatePieceMoves(int x, int y, std::vector<Move> &moves) const
+{
+    constexpr Color Them = getOppositeColor(Us);
+
+    if constexpr (Type == Troops::Pawn)
+    {
+        constexpr int direction = (Us == Color::Black) ? 1 : -1;
+        constexpr int startRow = (Us == Color::Black) ? 1 : 6;
+        constexpr int promotionRow = (Us == Color::Black) ? 7 : 0;
+        constexpr int enPassantRow = (Us == Color::Black) ? 5 : 2; // where their double pushes leave a square
+
+        auto addPawnMove = [&](int toX, int toY)
+        {
+            if (toY == promotionRow)
+            {
+                for (Troops promotion : PromotionPieces)
+                {
+                    moves.push_back(Move(x, y, toX, toY, promotion));
+                }
+            }
+            else
+            {
+                moves.push_back(Move(x, y, toX, toY));
+            }
+        };
+
+        int forward = y + direction;
+        if (forward < 0 || forward > 7)
+        {
+            return;
+        }
+        if (isEmpty(x, forward))
+        {
+            addPawnMove(x, forward);
+            if (y == startRow && isEmpty(x, forward + direction))
+            {
+                moves.push_back(Move(x, y, x, forward + direction));
+            }
+        }
+
+        // Diagonal attack, including en passant onto the square their pawn just skipped
+        for (uint64_t targets = attacks.pawn[colorIndex(Us)][y * 8 + x]; targets;)
+        {
+            int square = popSquare(targets);
+            if (board[square / 8][square % 8].color == Them ||
+                (square == state.enPassantSquare && square / 8 == enPassantRow))
+            {
+                addPawnMove(square % 8, square / 8);
+            }
+        }
+    }
+    else if constexpr (Type == Troops::Knight || Type == Troops::King)
+    {
+        const uint64_t *table = Type == Troops::Knight ? attacks.knight : attacks.king;
+        for (uint64_t targets = table[y * 8 + x]; targets;)
+        {
+            int square = popSquare(targets);
+            if (board[square / 8][square % 8].color != Us)
+            {
+                moves.push_back(Move(x, y, square % 8, square / 8));
+            }
+        }
+
+        if constexpr (Type == Troops::King)
+        {
+            // Castling: the rights say king and rook haven't moved; the king may not start on,
+            // pass over or (checked with the other moves) land on an attacked square
+            constexpr int homeRow = (Us == Color::White) ? 7 : 0;
+            constexpr uint8_t kingside = (Us == Color::White) ? WhiteKingside : BlackKingside;
+            constexpr uint8_t queenside = (Us == Color::White) ? WhiteQueenside : BlackQueenside;
+            auto hasRook = [&](int rookX)
+            {
+                return board[homeRow][rookX].color == Us && board[homeRow][rookX].TroopType == Troops::Rook;
+            };
+
+            if (x == 4 && y == homeRow && (state.castlingRights & (kingside | queenside)) && !isSquareAttacked<Them>(4, homeRow))
+            {
+                if ((state.castlingRights & kingside) && hasRook(7) && isEmpty(5, homeRow) && isEmpty(6, homeRow) &&
+                    !isSquareAttacked<Them>(5, homeRow))
+                {
+                    moves.push_back(Move(4, homeRow, 6, homeRow));
+                }
+                if ((state.castlingRights & queenside) && hasRook(0) && isEmpty(3, homeRow) && isEmpty(2, homeRow) &&
+                    isEmpty(1, homeRow) && !isSquareAttacked<Them>(3, homeRow))
+                {
+                    moves.push_back(Move(4, homeRow, 2, homeRow));
+                }
+            }
+        }
+    }
+    else
+    {
+        // Sliders: walk each ray until the edge, a capture or our own piece. Rooks use the
+        // first four lines, bishops the last four, queens all of them.
+        constexpr int first = Type == Troops::Bishop ? 4 : 0;
+        constexpr int last = Type == Troops::Rook ? 4 : 8;
+        for (int i = first; i < last; i++)
+        {
+            const int *direction = QueenDirections[i];
+            int newX = x + direction[0];
+            int newY = y + direction[1];
+            for (; isInsideBoard(newX, newY); newX += direction[0], newY += direction[1])
+            {
+                Color occupant = board[newY][newX].color;
+                if (occupant == Us)
+                {
+                    break;
+                }
+                moves.push_back(Move(x, y, newX, newY));
+                if (occupant == Them)
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+template <Color Us>
+void Position::generatePieceMoves(Troops type, int x, int y, std::vector<Move> &moves) const
+{
+    switch (type)
+    {
+    case Troops::Pawn:
+        generatePieceMoves<Us, Troops::Pawn>(x, y, moves);
+        break;
+    case Troops::Knight:
+        generatePieceMoves<Us, Troops::Knight>(x, y, moves);
+        break;
+    case Troops::Bishop:
+        generatePieceMoves<Us, Troops::Bishop>(x, y, moves);
+        break;
+    case Troops::Rook:
+        generatePieceMoves<Us, Troops::Rook>(x, y, moves);
+        break;
+    case Troops::Queen:
+        generatePieceMoves<Us, Troops::Queen>(x, y, moves);
+        break;
+    case Troops::King:
+        generatePieceMoves<Us, Troops::King>(x, y, moves);
+        break;
+    default:
+        break;
+    }
+}
+
+void Position::SetupBoard()
+{
+    for (auto &row : board)
+    {
+        for (auto &square : row)
+        {
+            square = Piece();
+        }
+    }
+
+    // for upper set  of pieces // black side
+    board[0][0] = Piece(Troops::Rook, Color::Black);
+    board[0][1] = Piece(Troops::Knight, Color::Black);
+    board[0][2] = Piece(Troops::Bishop, Color::Black);
+    board[0][3] = Piece(Troops::Queen, Color::Black);
+    board[0][4] = Piece(Troops::King, Color::Black);
+    board[0][5] = Piece(Troops::Bishop, Color::Black);
+    board[0][6] = Piece(Troops::Knight, Color::Black);
+    board[0][7] = Piece(Troops::Rook, Color::Black);
+
+    for (int j = 0; j < 8; j++)
+    {
+        board[1][j] = Piece(Troops::Pawn, Color::Black);
+    }
+
+    // for lower set  of pieces  // white side
+    board[7][0] = Piece(Troops::Rook, Color::White);
+    board[7][1] = Piece(Troops::Knight, Color::White);
+    board[7][2] = Piece(Troops::Bishop, Color::White);
+    board[7][3] = Piece(Troops::Queen, Color::White);
+    board[7][4] = Piece(Troops::King, Color::White);
+    board[7][5] = Piece(Troops::Bishop, Color::White);
+    board[7][6] = Piece(Troops::Knight, Color::White);
+    board[7][7] = Piece(Troops::Rook, Color::White);
+
+    for (int j = 0; j < 8; j++)
+    {
+        board[6][j] = Piece(Troops::Pawn, Color::White);
+    }
+
+    state = PositionState();
+    state.castlingRights = AllCastlingRights;
+    state.key = zobrist.castling[AllCastlingRights];
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            state.key ^= pieceKey(board[y][x], x, y);
+            if (board[y][x].TroopType == Troops::Pawn)
+            {
+                state.pawnKey ^= pieceKey(board[y][x], x, y);
+            }
+        }
+    }
+    refreshAccumulator();
+    undoCount = 0;
+}
+
+bool Position::setFromFen(const std::string &fen, Color &sideToMove)
+{
+    Piece parsed[8][8];
+    std::string placement, side, castling = "-", enPassant = "-";
+    int halfmoves = 0;
+    {
+        size_t pos = 0;
+        auto nextField = [&](std::string &field)
+        {
+            while (pos < fen.size() && fen[pos] == ' ')
+                pos++;
+            size_t end = fen.find(' ', pos);
+            if (pos >= fen.size())
+                return false;
+            field = fen.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+            pos = end == std::string::npos ? fen.size() : end;
+            return true;
+        };
+        std::string clock;
+        if (!nextField(placement) || !nextField(side))
+        {
+            return false;
+        }
+        nextField(castling);
+        nextField(enPassant);
+        if (nextField(clock))
+        {
+            halfmoves = std::atoi(clock.c_str());
+        }
+    }
+
+    // Rank 8 comes first, which is row 0 of the board
+    int square = 0;
+    for (char c : placement)
+    {
+        if (c == '/')
+        {
+            continue;
+        }
+        if (c >= '1' && c <= '8')
+        {
+            square += c - '0';
+            continue;
+        }
+        Troops troop;
+        switch (std::tolower(static_cast<unsigned char>(c)))
+        {
+        case 'p':
+            troop = Troops::Pawn;
+            break;
+        case 'n':
+            troop = Troops::Knight;
+            break;
+        case 'b':
+            troop = Troops::Bishop;
+            break;
+        case 'r':
+            troop = Troops::Rook;
+            break;
+        case 'q':
+            troop = Troops::Queen;
+            break;
+        case 'k':
+            troop = Troops::King;
+            break;
+        default:
+            return false;
+        }
+        if (square >= 64)
+        {
+            return false;
+        }
+        parsed[square / 8][square % 8] = Piece(troop, std::isupper(static_cast<unsigned char>(c)) ? Color::White : Color::Black);
+        square++;
+    }
+    if (square != 64 || (side != "w" && side != "b"))
+    {
+        return false;
+    }
+
+    sideToMove = side == "w" ? Color::White : Color::Black;
+
+    PositionState rights;
+    for (char c : castling)
+    {
+        rights.castlingRights |= c == 'K' ? WhiteKingside : c == 'Q' ? WhiteQueenside
+                                                       : c == 'k'   ? BlackKingside
+                                                       : c == 'q'   ? BlackQueenside
+                                                                    : 0;
+    }
+    if (enPassant.size() == 2 && enPassant[0] >= 'a' && enPassant[0] <= 'h' && enPassant[1] >= '1' && enPassant[1] <= '8')
+    {
+        rights.enPassantSquare = static_cast<int8_t>(('8' - enPassant[1]) * 8 + (enPassant[0] - 'a'));
+    }
+    rights.halfmoveClock = static_cast<int16_t>(halfmoves);
+    setPosition(parsed, rights);
+    return true;
+}
+
+void Position::setPosition(const Piece pieces[8][8], const PositionState &rights)
+{
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            board[y][x] = pieces[y][x];
+        }
+    }
+
+    state = PositionState();
+    state.castlingRights = rights.castlingRights;
+    if (rights.enPassantSquare >= 0 && canCaptureEnPassant(rights.enPassantSquare))
+    {
+        state.enPassantSquare = rights.enPassantSquare;
+    }
+    state.halfmoveClock = rights.halfmoveClock;
+
+    state.key = zobrist.castling[state.castlingRights] ^ enPassantKey(state.enPassantSquare);
+    state.pawnKey = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            state.key ^= pieceKey(board[y][x], x, y);
+            if (board[y][x].TroopType == Troops::Pawn)
+            {
+                state.pawnKey ^= pieceKey(board[y][x], x, y);
+            }
+        }
+    }
+    refreshAccumulator();
+    undoCount = 0;
+}
+
+char Position::get_PieceAtdata(const Piece &pieces)
+{
+    if (pieces.color == Color::Black)
+    {
+        switch (pieces.TroopType)
+        {
+        case Troops::Rook:
+            return 'R';
+        case Troops::Pawn:
+            return 'P';
+        case Troops::Knight:
+            return 'N';
+        case Troops::Bishop:
+            return 'B';
+        case Troops::Queen:
+            return 'Q';
+        case Troops::King:
+            return 'K';
+        default:
+            return '.';
+        }
+    }
+
+    else if (pieces.color == Color::White)
+    {
+        switch ((pieces.TroopType))
+        {
+
+        case Troops::Rook:
+            return 'r';
+        case Troops::Pawn:
+            return 'p';
+        case Troops::Knight:
+            return 'n';
+        case Troops::Bishop:
+            return 'b';
+        case Troops::Queen:
+            return 'q';
+        case Troops::King:
+            return 'k';
+        default:
+            return '.';
+        }
+    }
+
+    return '.';
+}
+
+std::pair<int, int> Position::findKingPosition(Color kingColor) const
+{
+    for (int x = 0; x < 8; x++)
+    {
+        for (int y = 0; y < 8; y++)
+        {
+            if (board[y][x].TroopType == Troops::King && board[y][x].color == kingColor)
+            {
+                return {x, y};
+            }
+        }
+    }
+    return {-1, -1};
+}
+
+bool Position::IsKingCheck(int kx, int ky, Color kingColor) const
+{
+    if (kx < 0 || kx >= 8 || ky < 0 || ky >= 8)
+        return false;
+
+    return kingColor == Color::White ? isSquareAttacked<Color::Black>(kx, ky) : isSquareAttacked<Color::White>(kx, ky);
+}
+
+template <Color Them>
+bool Position::isSquareAttacked(int x, int y) const
+{
+    constexpr Color Us = getOppositeColor(Them);
+    int square = y * 8 + x;
+
+    auto hasAny = [this](uint64_t squares, Troops type)
+    {
+        while (squares)
+        {
+            int from = popSquare(squares);
+            const Piece &piece = board[from / 8][from % 8];
+            if (piece.color == Them && piece.TroopType == type)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // A pawn of theirs attacks us from exactly the squares one of our pawns would attack
+    if (hasAny(attacks.pawn[colorIndex(Us)][square], Troops::Pawn) ||
+        hasAny(attacks.knight[square], Troops::Knight) ||
+        hasAny(attacks.king[square], Troops::King))
+    {
+        return true;
+    }
+
+    // Look outwards along each line for the first piece and see if it slides that way
+    for (int i = 0; i < 8; i++)
+    {
+        const int *direction = QueenDirections[i];
+        Troops slider = i < 4 ? Troops::Rook : Troops::Bishop;
+        int newX = x + direction[0];
+        int newY = y + direction[1];
+        for (; isInsideBoard(newX, newY); newX += direction[0], newY += direction[1])
+        {
+            const Piece &piece = board[newY][newX];
+            if (piece.TroopType == Troops::None)
+            {
+                continue;
+            }
+            if (piece.color == Them && (piece.TroopType == slider || piece.TroopType == Troops::Queen))
+            {
+                return true;
+            }
+            break;
+        }
+    }
+    return false; // King is not in check
+}
+
+template <Color Us>
+bool Position::inCheck() const
+{
+    std::pair<int, int> king = findKingPosition(Us);
+    return king.first >= 0 && isSquareAttacked<getOppositeColor(Us)>(king.first, king.second);
+}
+
+bool Position::inCheck(Color color) const
+{
+    return color == Color::White ? inCheck<Color::White>() : inCheck<Color::Black>();
+}
+
+std::vector<Move> Position::generateAllMoves(Color aiColor) const
+{
+    return aiColor == Color::White ? generateAllMoves<Color::White>() : generateAllMoves<Color::Black>();
+}
+
+template <Color Us>
+std::vector<Move> Position::generateAllMoves() const
+{
+    std::vector<Move> allMoves;
+    allMoves.reserve(64);
+
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            const Piece &piece = board[y][x];
+            if (piece.color == Us)
+            {
+                generatePieceMoves<Us>(piece.TroopType, x, y, allMoves);
+            }
+        }
+    }
+    return allMoves;
+}
+
+int Position::evaluateBoard(Color aiColor) const
+{
+    if (Nnue::isLoaded())
+    {
+        // Keep a badly scaled network from producing scores the search would read as mate
+        return std::clamp(Nnue::evaluate(accumulator, aiColor), -20000, 20000);
+    }
+
+    // Material plus piece-square bonuses, both from the tunable tables, for White
+    const EvalParams &params = evalParams();
+    int score = 0;
+    uint64_t pawns[2] = {};
+    uint64_t pieces[2][EvalParams::PieceTypes] = {};
+    struct FilePiece
+    {
+        Troops troop;
+        Color color;
+        int x;
+    };
+    FilePiece filePieces[24]; // rooks and kings, which score the files they stand on
+    int filePieceCount = 0;
+
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            const Piece &piece = board[y][x];
+            if (piece.TroopType == Troops::None)
+            {
+                continue;
+            }
+            int troop = static_cast<int>(piece.TroopType);
+            int pieceScore = params.pieceValues[troop] + params.pieceSquare[troop][relativeSquare(piece.color, y * 8 + x)];
+            score += piece.color == Color::White ? pieceScore : -pieceScore;
+            pieces[static_cast<int>(piece.color)][troop] |= 1ull << (y * 8 + x);
+
+            if (piece.TroopType == Troops::Pawn)
+            {
+                pawns[static_cast<int>(piece.color)] |= 1ull << (y * 8 + x);
+            }
+            else if ((piece.TroopType == Troops::Rook || piece.TroopType == Troops::King) && filePieceCount < 24)
+            {
+                filePieces[filePieceCount++] = {piece.TroopType, piece.color, x};
+            }
+        }
+    }
+
+    // Pawn structure comes from the pawn table, so it is only worked out when the pawns change
+    const PawnEntry &pawnEntry = probePawns(state.pawnKey, pawns);
+    score += pawnEntry.score;
+    for (int i = 0; i < filePieceCount; i++)
+    {
+        const FilePiece &piece = filePieces[i];
+        int sign = piece.color == Color::White ? 1 : -1;
+        forEachFileTerm(pawnEntry, piece.troop, piece.color, piece.x, [&](int term)
+                        { score += sign * params.pawnTerms[term]; });
+    }
+
+    // Mobility, king safety and hanging pieces, all from one set of attack maps
+    AttackMaps attacks;
+    computeAttackMaps(pieces, attacks);
+    int attackCounts[2][EvalParams::AttackTermCount];
+    countAttackTerms(pieces, attacks, attackCounts);
+    for (int term = 0; term < EvalParams::AttackTermCount; term++)
+    {
+        score += params.attackTerms[term] * (attackCounts[static_cast<int>(Color::White)][term] - attackCounts[static_cast<int>(Color::Black)][term]);
+    }
+    return aiColor == Color::White ? score : -score;
+}
+
+int Position::getPieceValue(Piece piece)
+{
+    if (piece.TroopType == Troops::None)
+    {
+        return 0;
+    }
+    return evalParams().pieceValues[static_cast<int>(piece.TroopType)];
+}
+
+void Position::unmakeMove()
+{
+    if (undoCount == 0)
+    {
+        return;
+    }
+    const UndoEntry &entry = undoStack[--undoCount];
+    const Move &move = entry.move;
+
+    setPiece(move.srcX, move.srcY, entry.mover);
+    if (entry.kind == MoveKind::EnPassant)
+    {
+        setPiece(move.destX, move.destY, Piece());
+        setPiece(move.destX, move.srcY, entry.captured);
+    }
+    else
+    {
+        setPiece(move.destX, move.destY, entry.captured);
+    }
+
+    if (entry.kind == MoveKind::Castling)
+    {
+        int rookFrom = move.destX > move.srcX ? 7 : 0;
+        int rookTo = move.destX > move.srcX ? 5 : 3;
+        setPiece(rookFrom, move.srcY, board[move.srcY][rookTo]);
+        setPiece(rookTo, move.srcY, Piece());
+    }
+
+    state = entry.state;
+}
+
+void Position::makeMove(const Move &move)
+{
+    if (undoCount == MaxHistory)
+    {
+        std::copy(undoStack + MaxHistory / 2, undoStack + MaxHistory, undoStack);
+        undoCount -= MaxHistory / 2;
+    }
+
+    UndoEntry &entry = undoStack[undoCount++];
+    Piece mover = board[move.srcY][move.srcX];
+    entry.state = state;
+    entry.move = move;
+    entry.mover = mover;
+    entry.captured = board[move.destY][move.destX];
+    entry.kind = MoveKind::Normal;
+
+    bool pawn = mover.TroopType == Troops::Pawn;
+    if (pawn && move.destX != move.srcX && entry.captured.TroopType == Troops::None)
+    {
+        // En passant: the captured pawn stands beside the mover, not on the destination
+        entry.kind = MoveKind::EnPassant;
+        entry.captured = board[move.srcY][move.destX];
+        setPiece(move.destX, move.srcY, Piece());
+    }
+    else if (mover.isKing() && std::abs(move.destX - move.srcX) == 2)
+    {
+        entry.kind = MoveKind::Castling;
+        int rookFrom = move.destX > move.srcX ? 7 : 0;
+        int rookTo = move.destX > move.srcX ? 5 : 3;
+        setPiece(rookTo, move.srcY, board[move.srcY][rookFrom]);
+        setPiece(rookFrom, move.srcY, Piece());
+    }
+
+    Piece placed = mover;
+    if (pawn && (move.destY == 0 || move.destY == 7))
+    {
+        placed = Piece(move.promotion == Troops::None ? Troops::Queen : move.promotion, mover.color);
+    }
+    setPiece(move.destX, move.destY, placed);
+    setPiece(move.srcX, move.srcY, Piece());
+
+    state.halfmoveClock = (pawn || entry.captured.TroopType != Troops::None) ? 0 : state.halfmoveClock + 1;
+
+    uint8_t rights = state.castlingRights & castlingMasks.squares[move.srcY * 8 + move.srcX] & castlingMasks.squares[move.destY * 8 + move.destX];
+    state.key ^= zobrist.castling[state.castlingRights] ^ zobrist.castling[rights];
+    state.castlingRights = rights;
+
+    state.key ^= enPassantKey(state.enPassantSquare);
+    state.enPassantSquare = -1;
+    if (pawn && std::abs(move.destY - move.srcY) == 2)
+    {
+        int square = (move.srcY + move.destY) / 2 * 8 + move.srcX;
+        if (canCaptureEnPassant(square))
+        {
+            state.enPassantSquare = static_cast<int8_t>(square);
+            state.key ^= enPassantKey(state.enPassantSquare);
+        }
+    }
+}
+
+bool Position::canCaptureEnPassant(int square) const
+{
+    // The pawn that skipped a row 5 square stands on row 4, one that skipped row 2 on row 3
+    int x = square % 8;
+    int y = square / 8 == 5 ? 4 : square / 8 == 2 ? 3 : -1;
+    if (y < 0 || board[y][x].TroopType != Troops::Pawn)
+    {
+        return false;
+    }
+    Color them = getOppositeColor(board[y][x].color);
+    for (int dx : {-1, 1})
+    {
+        if (isInsideBoard(x + dx, y) && board[y][x + dx].TroopType == Troops::Pawn && board[y][x + dx].color == them)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Move> Position::generateLegalMoves(Color currentPlayerColor)
+{
+    // The search calls the templates directly, so this zone only covers GUI-side generation
+    TRACE_ZONE("generateLegalMoves");
+    return currentPlayerColor == Color::White ? generateLegalMoves<Color::White>() : generateLegalMoves<Color::Black>();
+}
+
+template <Color Us>
+std::vector<Move> Position::generateLegalMoves()
+{
+    std::vector<Move> moves = generateAllMoves<Us>();
+    std::pair<int, int> kingPosition = findKingPosition(Us);
+
+    auto illegal = [&](const Move &move)
+    { return !isLegal<Us>(move, kingPosition); };
+    moves.erase(std::remove_if(moves.begin(), moves.end(), illegal), moves.end());
+    return moves;
+}
+
+template <Color Us>
+bool Position::isLegal(const Move &move, std::pair<int, int> kingPosition)
+{
+    // Only the board matters for the attack test, so skip the hash, history and accumulator.
+    // Castling's rook move is left out: it can't block a line to the king's new square that
+    // didn't already pass through the king's old one.
+    Piece &from = board[move.srcY][move.srcX];
+    Piece &to = board[move.destY][move.destX];
+    Piece captured = to;
+
+    // En passant also empties the captured pawn's square, which can open a line to the king
+    Piece *passedPawn = nullptr;
+    Piece passedPawnPiece;
+    if (from.TroopType == Troops::Pawn && move.destX != move.srcX && captured.TroopType == Troops::None)
+    {
+        passedPawn = &board[move.srcY][move.destX];
+        passedPawnPiece = *passedPawn;
+        *passedPawn = Piece();
+    }
+
+    to = from;
+    from = Piece();
+
+    // The mover now sits on the destination square, so that's where a moved king is
+    if (to.TroopType == Troops::King)
+    {
+        kingPosition = {move.destX, move.destY};
+    }
+    bool legal = !isSquareAttacked<getOppositeColor(Us)>(kingPosition.first, kingPosition.second);
+
+    from = to;
+    to = captured;
+    if (passedPawn)
+    {
+        *passedPawn = passedPawnPiece;
+    }
+    return legal;
+}
+
+uint64_t Position::perft(Color sideToMove, int depth)
+{
+    return sideToMove == Color::White ? perft<Color::White>(depth) : perft<Color::Black>(depth);
+}
+
+template <Color Us>
+uint64_t Position::perft(int depth)
+{
+    std::vector<Move> moves = generateLegalMoves<Us>();
+    if (depth <= 1)
+    {
+        return depth == 1 ? moves.size() : 1;
+    }
+
+    uint64_t nodes = 0;
+    for (const Move &move : moves)
+    {
+        makeMove(move);
+        nodes += perft<getOppositeColor(Us)>(depth - 1);
+        unmakeMove();
+    }
+    return nodes;
+}
+
+template std::vector<Move> Position::generateAllMoves<Color::White>() const;
+template std::vector<Move> Position::generateAllMoves<Color::Black>() const;
+template std::vector<Move> Position::generateLegalMoves<Color::White>();
+template std::vector<Move> Position::generateLegalMoves<Color::Black>();
+template bool Position::hasLegalMove<Color::White>();
+template bool Position::hasLegalMove<Color::Black>();
+template bool Position::isSquareAttacked<Color::White>(int x, int y) const;
+template bool Position::isSquareAttacked<Color::Black>(int x, int y) const;
+template bool Position::inCheck<Color::White>() const;
+template bool Position::inCheck<Color::Black>() const;
+template uint64_t Position::perft<Color::White>(int depth);
+template uint64_t Position::perft<Color::Black>(int depth);
+
+void Position::printBoard() const
+{
+    for (const auto &rows : board)
+    {
+        for (const auto &piece : rows)
+        {
+            const char pieceSymbol = get_PieceAtdata(piece);
+            std::cout << pieceSymbol << " ";
+        }
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Nnue.hpp"
+
+enum class Troops : int8_t
+{
+    Bishop,
+    Knight,
+    Rook,
+    King,
+    Queen,
+    Pawn,
+    None
+};
+
+enum class Color : int8_t
+{
+    Black,
+    White,
+    None
+};
+
+class Piece
+{
+public:
+    Color color;
+    Troops TroopType;
+
+    bool isKing() const
+    {
+        return TroopType == Troops::King; // Compare the piece type with KING
+    }
+    Piece(Troops armyType = Troops::None, Color colortype = Color::None) : color(colortype), TroopType(armyType) {}
+};
+
+enum class GameStatus
+{
+    Ongoing,
+    Checkmate,
+    Stalemate,
+    ThreefoldRepetition,
+    FiftyMoveRule,
+    InsufficientMaterial
+};
+
+// A move from one square to another, small enough to keep in transposition table entries.
+// Castling is the king moving two squares and en passant a pawn moving diagonally onto an empty
+// square, so neither needs a flag; promotion names the new piece.
+struct Move
+{
+    int8_t srcX = -1;
+    int8_t srcY = -1;
+    int8_t destX = -1;
+    int8_t destY = -1;
+    Troops promotion = Troops::None;
+
+    Move() = default;
+    Move(int sx, int sy, int dx, int dy, Troops promo = Troops::None) : srcX(sx), srcY(sy), destX(dx), destY(dy), promotion(promo) {}
+
+    bool isNull() const { return srcX < 0; }
+    bool operator==(const Move &other) const
+    {
+        return srcX == other.srcX && srcY == other.srcY && destX == other.destX && destY == other.destY && promotion == other.promotion;
+    }
+    bool operator!=(const Move &other) const { return !(*this == other); }
+};
+
+// Coordinate notation such as "e2e4" or "e7e8q"; rank 8 is row 0 of the board
+std::string moveToString(const Move &move);
+
+// from | to << 6 | promotion << 12 in the low 15 bits, squares numbered y * 8 + x; a null move
+// packs to 0, which no real move does. Files and tables keep bit 15 for a flag of their own.
+inline uint16_t packMove(const Move &move)
+{
+    if (move.isNull())
+    {
+        return 0;
+    }
+    int from = move.srcY * 8 + move.srcX;
+    int to = move.destY * 8 + move.destX;
+    return static_cast<uint16_t>(from | (to << 6) | (static_cast<int>(move.promotion) << 12));
+}
+
+// Ignores bit 15
+inline Move unpackMove(uint16_t packed)
+{
+    packed &= 0x7fff;
+    if (packed == 0)
+    {
+        return Move();
+    }
+    int from = packed & 63;
+    int to = (packed >> 6) & 63;
+    return Move(from % 8, from / 8, to % 8, to / 8, static_cast<Troops>((packed >> 12) & 7));
+}
+
+// splitmix64's output step: a well-spread 64-bit value from any seed or counter. It generates the
+// Zobrist keys and seeds the engines' own random streams.
+constexpr uint64_t splitmix(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+enum CastlingRights : uint8_t
+{
+    WhiteKingside = 1,
+    WhiteQueenside = 2,
+    BlackKingside = 4,
+    BlackQueenside = 8,
+    AllCastlingRights = 15
+};
+
+// Everything about a position besides the piece placement, saved whole on every move so
+// unmakeMove can put it back in one copy
+struct PositionState
+{
+    uint64_t key = 0;            // pieces, castling rights and en-passant square; not the side to move
+    uint64_t pawnKey = 0;        // the pawns alone, for the pawn-structure table
+    int16_t halfmoveClock = 0;
+    uint8_t castlingRights = 0;  // CastlingRights bits
+    int8_t enPassantSquare = -1; // y * 8 + x of the square a pawn just skipped over, -1 if none or no pawn can take it
+};
+
+// The rules side of the game: piece placement, move generation, evaluation and make/undo.
+// It is a plain value type so the engine can copy it onto its own thread.
+class Position
+{
+public:
+    Position();
+
+    void SetupBoard();
+    // Loads a FEN (board, side to move, castling, en passant and halfmove clock) and clears the
+    // move history; returns false and leaves the position alone if the FEN doesn't parse
+    bool setFromFen(const std::string &fen, Color &sideToMove);
+    // Replaces the pieces, castling rights, en-passant square and halfmove clock (the keys in
+    // rights are ignored and recomputed) and clears the move history
+    void setPosition(const Piece pieces[8][8], const PositionState &rights);
+    void printBoard() const;
+
+    const Piece &get_PieceAt(int x, int y) const { return board[y][x]; }
+    void setPiece(int x, int y, Piece piece);
+
+    // Zobrist key of the pieces, castling rights and en-passant square; fold in sideKey(color)
+    // for the side to move. Sides alternate, so history entries two plies apart always have the
+    // same side to move. placementKey() leaves out everything but the pieces.
+    uint64_t hash() const { return state.key; }
+    uint64_t placementKey() const;
+    uint64_t pawnKey() const { return state.pawnKey; }
+    static uint64_t sideKey(Color sideToMove);
+    static uint64_t pieceKey(const Piece &piece, int x, int y);
+
+    const PositionState &getState() const { return state; }
+
+    bool isInsideBoard(int x, int y) const { return x >= 0 && x < 8 && y >= 0 && y < 8; }
+    bool isEmpty(int x, int y) const { return board[y][x].TroopType == Troops::None; }
+    bool isOpponentPiece(int x, int y, Color currentPlayerColor) const;
+    bool isFriendlyPiece(int x, int y, Color currentPlayerColor) const;
+
+    // Runtime-colour entry points; they dispatch once to the specialised templates below
+    std::vector<std::pair<int, int>> getLegalMoves(Piece piece, int x, int y) const;
+    std::vector<Move> generateAllMoves(Color color) const;
+    std::vector<Move> generateLegalMoves(Color color);
+
+    std::pair<int, int> findKingPosition(Color kingColor) const;
+    bool IsKingCheck(int kx, int ky, Color kingColor) const;
+    bool inCheck(Color color) const;
+
+    // Move generation and attack tests compiled separately for each side (and, inside, for each
+    // piece type), so pawn directions, colour tests and piece dispatch are constants. Defined in
+    // Position.cpp for Color::White and Color::Black.
+    template <Color Us>
+    std::vector<Move> generateAllMoves() const;
+    template <Color Us>
+    std::vector<Move> generateLegalMoves();
+    template <Color Us>
+    bool hasLegalMove();
+    template <Color Them>
+    bool isSquareAttacked(int x, int y) const;
+    template <Color Us>
+    bool inCheck() const;
+
+    // Leaf count of the legal move tree, for checking and timing move generation
+    uint64_t perft(Color sideToMove, int depth);
+    template <Color Us>
+    uint64_t perft(int depth);
+
+    // Everything that ends the game, worked out in one pass. The part that depends only on the
+    // position (mate, stalemate, material) is cached by key; repetition and the fifty-move rule
+    // come from the history stack.
+    GameStatus gameStatus(Color sideToMove);
+
+    // Cheap draw test for search nodes: any repetition, the fifty-move rule or dead material
+    bool isDraw() const { return repetitions() >= 1 || state.halfmoveClock >= 100 || isInsufficientMaterial(); }
+    int repetitions() const;
+    bool isInsufficientMaterial() const;
+    int getHalfmoveClock() const { return state.halfmoveClock; }
+
+    // Centipawns for aiColor: the network when one is loaded, otherwise material
+    int evaluateBoard(Color aiColor) const;
+    static int getPieceValue(Piece piece);
+    // Rebuilds the network accumulator from scratch, e.g. after the network was loaded
+    void refreshAccumulator() { Nnue::refresh(accumulator, board); }
+    static constexpr Color getOppositeColor(Color color) { return (color == Color::White) ? Color::Black : Color::White; }
+
+    // Plays any move, castling, en passant and promotion included (a pawn reaching the last rank
+    // with no promotion piece becomes a queen), and takes back the last one. Both are O(1) and
+    // only touch the fixed undo stack, so they never allocate.
+    void makeMove(const Move &move);
+    void unmakeMove();
+    int plyCount() const { return undoCount; }
+
+    static char get_PieceAtdata(const Piece &pieces);
+
+private:
+    bool hasLegalMove(Color color);
+    template <Color Us, Troops Type>
+    void generatePieceMoves(int x, int y, std::vector<Move> &moves) const;
+    template <Color Us>
+    void generatePieceMoves(Troops type, int x, int y, std::vector<Move> &moves) const;
+    // Plays the move on the bare board only and tests whether it leaves our king attacked
+    template <Color Us>
+    bool isLegal(const Move &move, std::pair<int, int> kingPosition);
+    // Whether a pawn of the other side stands next to the pawn that just skipped square. The
+    // square is only kept, and hashed, when it can be taken, so the same position reached
+    // without a double push gets the same key and repetitions are seen.
+    bool canCaptureEnPassant(int square) const;
+
+    enum class MoveKind : uint8_t
+    {
+        Normal,
+        EnPassant,
+        Castling
+    };
+
+    // What unmakeMove needs to put back, pushed once per move
+    struct UndoEntry
+    {
+        PositionState state;
+        Move move;
+        Piece mover;
+        Piece captured;
+        MoveKind kind;
+    };
+
+    // A long game plus the deepest search line; on overflow the oldest half is dropped, which
+    // only loses positions far behind the fifty-move window
+    static constexpr int MaxHistory = 1024;
+
+    Piece board[8][8];
+    PositionState state;
+    Nnue::Accumulator accumulator; // kept in step with board by setPiece
+    UndoEntry undoStack[MaxHistory];
+    int undoCount = 0;
+};
@@ -0,0 +1,561 @@
+#include <algorithm>
+#include <cstdlib>
+#include "Search.hpp"
+#include "Trace.hpp"
+
+namespace
+{
+    constexpr int Infinity = 32000;
+
+    // Mate scores are relative to the root; the table stores them relative to the node
+    int scoreToTable(int score, int ply)
+    {
+        if (!isMateScore(score))
+            return score;
+        return score > 0 ? score + ply : score - ply;
+    }
+
+    int scoreFromTable(int score, int ply)
+    {
+        if (!isMateScore(score))
+            return score;
+        return score > 0 ? score - ply : score + ply;
+    }
+
+    // Starts a root search in the tree dump; the root record itself follows its whole tree
+    void dumpIteration(int depth, int pvIndex, uint64_t key)
+    {
+#ifndef CHESS_NO_TREE_DUMP
+        if (TreeDump::isEnabled())
+        {
+            TreeDump::Record marker = {};
+            marker.depth = static_cast<int8_t>(depth);
+            marker.moveIndex = static_cast<uint8_t>(pvIndex);
+            marker.outcome = TreeDump::Outcome::Iteration;
+            marker.keyTag = static_cast<uint16_t>(key >> 48);
+            TreeDump::record(marker);
+        }
+#else
+        (void)depth, (void)pvIndex, (void)key;
+#endif
+    }
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+{
+    size_t count = 1;
+    while (count * 2 * sizeof(Slot) <= megabytes * 1024 * 1024)
+    {
+        count *= 2;
+    }
+    slots.reset(new Slot[count]);
+    mask = count - 1;
+    clear();
+}
+
+// Bits 0-15 move (from, to, promotion, present), 16-31 score, 32-39 depth, 40-41 bound.
+// An all-zero word is an empty slot.
+uint64_t TranspositionTable::pack(const Entry &entry)
+{
+    uint64_t move = entry.move.isNull() ? 0 : packMove(entry.move) | (1 << 15);
+    return move | (static_cast<uint64_t>(static_cast<uint16_t>(entry.score)) << 16) |
+           (static_cast<uint64_t>(static_cast<uint8_t>(entry.depth)) << 32) | (static_cast<uint64_t>(entry.bound) << 40);
+}
+
+TranspositionTable::Entry TranspositionTable::unpack(uint64_t data)
+{
+    Entry entry;
+    if (data & (1 << 15))
+    {
+        entry.move = unpackMove(static_cast<uint16_t>(data));
+    }
+    entry.score = static_cast<int16_t>(data >> 16);
+    entry.depth = static_cast<int8_t>(data >> 32);
+    entry.bound = static_cast<Bound>((data >> 40) & 3);
+    return entry;
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry &entry) const
+{
+    const Slot &slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) != key)
+    {
+        return false;
+    }
+    entry = unpack(data);
+    return entry.bound != None;
+}
+
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, Bound bound)
+{
+    Slot &slot = slots[key & mask];
+    Entry existing;
+    bool sameKey = probe(key, existing);
+
+    // Keep a deeper result for the same position unless the new one is exact
+    if (sameKey && existing.depth > depth && bound != Exact)
+    {
+        return;
+    }
+    if (move.isNull() && sameKey)
+    {
+        move = existing.move;
+    }
+
+    Entry entry;
+    entry.move = move;
+    entry.score = static_cast<int16_t>(score);
+    entry.depth = static_cast<int8_t>(depth);
+    entry.bound = bound;
+    uint64_t data = pack(entry);
+    slot.keyXorData.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i <= mask; i++)
+    {
+        slots[i].keyXorData.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+int TranspositionTable::hashfull() const
+{
+    size_t sample = std::min<size_t>(1000, mask + 1);
+    size_t used = 0;
+    for (size_t i = 0; i < sample; i++)
+    {
+        used += slots[i].data.load(std::memory_order_relaxed) != 0;
+    }
+    return static_cast<int>(used * 1000 / sample);
+}
+
+Search::Search(size_t hashMegabytes) : ownTable(new TranspositionTable(hashMegabytes)), table(*ownTable)
+{
+}
+
+Search::Search(TranspositionTable &sharedTable) : table(sharedTable)
+{
+}
+
+Search::~Search()
+{
+    stop();
+}
+
+void Search::start(const Position &position, Color sideToMove, const SearchLimits &limits, Callback onDone, Callback onIteration)
+{
+    launch(position, sideToMove, limits, std::move(onDone), std::move(onIteration), false);
+}
+
+void Search::startPonder(const Position &position, Color sideToMove, Move expectedMove, const SearchLimits &limits, Callback onDone)
+{
+    ponderedMove = expectedMove;
+    launch(position, sideToMove, limits, std::move(onDone), nullptr, true);
+}
+
+SearchResult Search::run(const Position &position, Color sideToMove, const SearchLimits &limits)
+{
+    stopRequested = false;
+    pondering = false;
+    searching = true;
+    liveDepth.store(0, std::memory_order_relaxed);
+    liveNodes.store(0, std::memory_order_relaxed);
+    startTicks = std::chrono::steady_clock::now().time_since_epoch().count();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        result = SearchResult();
+    }
+
+    SearchResult finished;
+    bool reported = false;
+    iterativeDeepening(position, sideToMove, limits, [&](const SearchResult &best)
+                       { finished = best; reported = true; }, nullptr);
+    // A stopped search doesn't report, but its completed iterations still stand
+    return reported ? finished : lastResult();
+}
+
+void Search::launch(const Position &position, Color sideToMove, const SearchLimits &limits, Callback onDone, Callback onIteration, bool ponder)
+{
+    stop();
+
+    stopRequested = false;
+    pondering = ponder;
+    searching = true;
+    liveDepth.store(0, std::memory_order_relaxed);
+    liveNodes.store(0, std::memory_order_relaxed);
+    startTicks = std::chrono::steady_clock::now().time_since_epoch().count();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        result = SearchResult();
+    }
+
+    worker = std::thread(&Search::iterativeDeepening, this, position, sideToMove, limits, std::move(onDone), std::move(onIteration));
+}
+
+void Search::ponderHit()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        startTicks = std::chrono::steady_clock::now().time_since_epoch().count();
+        pondering = false;
+    }
+    ponderWake.notify_all();
+}
+
+void Search::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopRequested = true;
+    }
+    ponderWake.notify_all();
+
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+    pondering = false;
+    searching = false;
+}
+
+void Search::clear()
+{
+    stop();
+    table.clear();
+}
+
+SearchStats Search::liveStats() const
+{
+    SearchStats stats;
+    stats.searching = searching.load(std::memory_order_relaxed);
+    stats.pondering = pondering.load(std::memory_order_relaxed);
+    stats.depth = liveDepth.load(std::memory_order_relaxed);
+    stats.nodes = liveNodes.load(std::memory_order_relaxed);
+    stats.hashfull = liveHashfull.load(std::memory_order_relaxed);
+    return stats;
+}
+
+SearchResult Search::lastResult()
+{
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return result;
+}
+
+int Search::elapsedMs() const
+{
+    auto start = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(startTicks.load()));
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+bool Search::shouldStop()
+{
+    if (stopRequested)
+    {
+        return true;
+    }
+    // While pondering it's the opponent's time, and without a finished iteration there is nothing to play
+    if (pondering || completedDepth == 0)
+    {
+        return false;
+    }
+    if (activeLimits.stopSignal && activeLimits.stopSignal->load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    // A ponder hit can arrive after the search already got past the requested depth
+    if (completedDepth >= activeLimits.depth)
+    {
+        return true;
+    }
+    return activeLimits.moveTimeMs > 0 && elapsedMs() >= activeLimits.moveTimeMs;
+}
+
+void Search::iterativeDeepening(Position position, Color sideToMove, SearchLimits limits, Callback onDone, Callback onIteration)
+{
+    Trace::setThreadName("search");
+    TRACE_ZONE("search");
+    activeLimits = limits;
+    completedDepth = 0;
+    nodes = 0;
+    aborted = false;
+    position.refreshAccumulator();
+
+    SearchResult best;
+
+    for (int depth = 1; depth < MaxPly; depth++)
+    {
+        TRACE_ZONE("iteration");
+        // Each further multiPV line is the best root move left once the earlier ones are excluded
+        std::vector<PvLine> lines;
+        rootExcluded.clear();
+        for (int pvIndex = 0; pvIndex < std::max(1, limits.multiPV); pvIndex++)
+        {
+            dumpMoves[0] = Move();
+            dumpMoveIndex[0] = static_cast<uint8_t>(pvIndex);
+            dumpIteration(depth, pvIndex, position.hash() ^ Position::sideKey(sideToMove));
+            int score = sideToMove == Color::White ? minimax<Color::White>(position, depth, -Infinity, Infinity, 0)
+                                                   : minimax<Color::Black>(position, depth, -Infinity, Infinity, 0);
+            if (aborted || pvLength[0] == 0)
+            {
+                break;
+            }
+            lines.push_back({score, std::vector<Move>(pvTable[0], pvTable[0] + pvLength[0])});
+            rootExcluded.push_back(pvTable[0][0]);
+        }
+        if (TreeDump::isEnabled())
+        {
+            TreeDump::flush();
+        }
+        if (aborted)
+        {
+            break;
+        }
+
+        int score = lines.empty() ? 0 : lines[0].score;
+        completedDepth = depth;
+        best.pv = lines.empty() ? std::vector<Move>() : lines[0].pv;
+        best.lines = lines;
+        best.bestMove = best.pv.empty() ? Move() : best.pv[0];
+        best.score = score;
+        best.depth = depth;
+        best.nodes = nodes;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            result = best;
+        }
+        liveDepth.store(depth, std::memory_order_relaxed);
+        liveNodes.store(nodes, std::memory_order_relaxed);
+        liveHashfull.store(table.hashfull(), std::memory_order_relaxed);
+        if (onIteration)
+        {
+            onIteration(best);
+        }
+
+        // No legal moves, or a forced mate that more depth can't improve on
+        if (best.bestMove.isNull() || (isMateScore(score) && !pondering))
+        {
+            break;
+        }
+        if (shouldStop())
+        {
+            break;
+        }
+    }
+
+    // A ponder search must not report until we know whether the guess was right
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        ponderWake.wait(lock, [this]
+                        { return !pondering || stopRequested; });
+    }
+    liveNodes.store(nodes, std::memory_order_relaxed);
+    if (stopRequested)
+    {
+        searching = false;
+        return;
+    }
+
+    if (!best.bestMove.isNull())
+    {
+        best.ponderMove = best.pv.size() > 1 ? best.pv[1] : guessReply(position, sideToMove, best.bestMove);
+    }
+    best.nodes = nodes;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        result = best;
+    }
+    searching = false;
+
+    onDone(best);
+}
+
+Move Search::guessReply(Position position, Color sideToMove, Move bestMove) const
+{
+    // The PV got cut short by a table hit; the table may still know the reply
+    position.makeMove(bestMove);
+    Color opponent = Position::getOppositeColor(sideToMove);
+    TranspositionTable::Entry entry;
+    return table.probe(position.hash() ^ Position::sideKey(opponent), entry) ? entry.move : Move();
+}
+
+void Search::orderMoves(const Position &position, std::vector<Move> &moves, Move hashMove) const
+{
+    // Hash move first, then captures by most valuable victim / least valuable attacker, with
+    // promotions ranked by the piece they make
+    auto moveScore = [&](const Move &move)
+    {
+        if (move == hashMove)
+        {
+            return 100000;
+        }
+        int score = 0;
+        const Piece &victim = position.get_PieceAt(move.destX, move.destY);
+        if (victim.TroopType != Troops::None)
+        {
+            const Piece &attacker = position.get_PieceAt(move.srcX, move.srcY);
+            score = 100 + Position::getPieceValue(victim) * 10 - Position::getPieceValue(attacker) / 100;
+        }
+        if (move.promotion != Troops::None)
+        {
+            score += Position::getPieceValue(Piece(move.promotion));
+        }
+        return score;
+    };
+
+    std::stable_sort(moves.begin(), moves.end(), [&](const Move &a, const Move &b)
+                     { return moveScore(a) > moveScore(b); });
+}
+
+template <Color Us>
+int Search::minimax(Position &position, int depth, int alpha, int beta, int ply)
+{
+    constexpr Color Them = Position::getOppositeColor(Us);
+
+    pvLength[ply] = 0;
+
+    if ((++nodes & 1023) == 0)
+    {
+        liveNodes.store(nodes, std::memory_order_relaxed);
+        if (shouldStop())
+        {
+            aborted = true;
+        }
+    }
+    if (aborted)
+    {
+        return dumpNode<Us>(position, ply, depth, alpha, beta, 0, TreeDump::Outcome::Aborted);
+    }
+
+    // Repeating a position, the fifty-move rule and dead material all score as a draw
+    if (ply > 0 && position.isDraw())
+    {
+        return dumpNode<Us>(position, ply, depth, alpha, beta, 0, TreeDump::Outcome::Draw);
+    }
+
+    if (depth == 0 || ply >= MaxPly - 1)
+    {
+        return dumpNode<Us>(position, ply, depth, alpha, beta, position.evaluateBoard(Us), TreeDump::Outcome::Leaf);
+    }
+
+    uint64_t key = position.hash() ^ Position::sideKey(Us);
+    Move hashMove;
+    TranspositionTable::Entry entry;
+    if (table.probe(key, entry))
+    {
+        hashMove = entry.move;
+
+        // The root always searches so it has a PV to report
+        if (ply > 0 && entry.depth >= depth)
+        {
+            int score = scoreFromTable(entry.score, ply);
+            if (entry.bound == TranspositionTable::Exact ||
+                (entry.bound == TranspositionTable::Lower && score >= beta) ||
+                (entry.bound == TranspositionTable::Upper && score <= alpha))
+            {
+                return dumpNode<Us>(position, ply, depth, alpha, beta, score, TreeDump::Outcome::HashCut, 0, true);
+            }
+        }
+    }
+
+    std::vector<Move> moves = position.generateLegalMoves<Us>();
+    if (moves.empty())
+    {
+        if (position.inCheck<Us>())
+        {
+            return dumpNode<Us>(position, ply, depth, alpha, beta, -MateScore + ply, TreeDump::Outcome::Mate, 0, !hashMove.isNull());
+        }
+        return dumpNode<Us>(position, ply, depth, alpha, beta, 0, TreeDump::Outcome::Stalemate, 0, !hashMove.isNull());
+    }
+    orderMoves(position, moves, hashMove);
+
+    int originalAlpha = alpha;
+    int bestScore = -Infinity;
+    Move bestMove;
+
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        const Move &move = moves[i];
+        if (ply == 0 && std::find(rootExcluded.begin(), rootExcluded.end(), move) != rootExcluded.end())
+        {
+            continue;
+        }
+
+        dumpMoves[ply + 1] = move;
+        dumpMoveIndex[ply + 1] = static_cast<uint8_t>(i);
+        position.makeMove(move);
+        int score = -minimax<Them>(position, depth - 1, -beta, -alpha, ply + 1);
+        position.unmakeMove();
+
+        if (aborted)
+        {
+            return dumpNode<Us>(position, ply, depth, originalAlpha, beta, 0, TreeDump::Outcome::Aborted, static_cast<int>(moves.size()), !hashMove.isNull());
+        }
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = move;
+
+            if (score > alpha)
+            {
+                alpha = score;
+
+                pvTable[ply][0] = move;
+                for (int i = 0; i < pvLength[ply + 1]; i++)
+                {
+                    pvTable[ply][i + 1] = pvTable[ply + 1][i];
+                }
+                pvLength[ply] = pvLength[ply + 1] + 1;
+
+                if (alpha >= beta)
+                {
+                    break; // Alpha-beta pruning
+                }
+            }
+        }
+    }
+
+    // With root moves excluded the score isn't the position's value, so don't store it
+    if (ply > 0 || rootExcluded.empty())
+    {
+        TranspositionTable::Bound bound = bestScore >= beta        ? TranspositionTable::Lower
+                                          : bestScore > originalAlpha ? TranspositionTable::Exact
+                                                                      : TranspositionTable::Upper;
+        table.store(key, bestMove, scoreToTable(bestScore, ply), depth, bound);
+    }
+    TreeDump::Outcome outcome = bestScore >= beta          ? TreeDump::Outcome::FailHigh
+                                : bestScore > originalAlpha ? TreeDump::Outcome::Exact
+                                                            : TreeDump::Outcome::FailLow;
+    return dumpNode<Us>(position, ply, depth, originalAlpha, beta, bestScore, outcome, static_cast<int>(moves.size()), !hashMove.isNull());
+}
+
+template <Color Us>
+int Search::dumpNode(const Position &position, int ply, int depth, int alpha, int beta, int score, TreeDump::Outcome outcome, int moveCount,
+                     bool hadHashMove)
+{
+#ifndef CHESS_NO_TREE_DUMP
+    if (TreeDump::isEnabled())
+    {
+        TreeDump::Record node;
+        node.move = packMove(dumpMoves[ply]);
+        node.alpha = static_cast<int16_t>(alpha);
+        node.beta = static_cast<int16_t>(beta);
+        node.score = static_cast<int16_t>(score);
+        node.depth = static_cast<int8_t>(depth);
+        node.ply = static_cast<uint8_t>(ply);
+        node.moveIndex = dumpMoveIndex[ply];
+        node.moveCount = static_cast<uint8_t>(std::min(moveCount, 255));
+        node.outcome = outcome;
+        node.flags = hadHashMove ? TreeDump::HadHashMove : 0;
+        node.keyTag = static_cast<uint16_t>((position.hash() ^ Position::sideKey(Us)) >> 48);
+        TreeDump::record(node);
+    }
+#else
+    (void)position, (void)ply, (void)depth, (void)alpha, (void)beta, (void)outcome, (void)moveCount, (void)hadHashMove;
+#endif
+    return score;
+}
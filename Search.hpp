@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Position.hpp"
+#include "TreeDump.hpp"
+
+// Scores are in centipawns from the side to move's point of view; mates are MateScore minus the
+// distance to mate in plies
+constexpr int MateScore = 31000;
+
+inline bool isMateScore(int score)
+{
+    return score >= MateScore - 1000 || score <= -(MateScore - 1000);
+}
+
+struct SearchLimits
+{
+    int depth = 4;       // plies; the old makeAIMove(aiColor, 3) looked one root ply plus three more
+    int moveTimeMs = 0;  // 0 searches until depth is reached
+    int multiPV = 1;     // number of best root moves to report, each with its own line
+    // Set from another thread to end the search early; unlike stop() it still reports the
+    // iterations completed so far
+    const std::atomic<bool> *stopSignal = nullptr;
+
+    static constexpr int Infinite = 1000; // depth for analysis that runs until stopped
+};
+
+struct PvLine
+{
+    int score = 0;
+    std::vector<Move> pv;
+};
+
+struct SearchResult
+{
+    Move bestMove;
+    Move ponderMove;        // expected reply, second move of the principal variation
+    std::vector<Move> pv;
+    std::vector<PvLine> lines; // the multiPV best root moves, best first; lines[0] matches pv
+    int score = 0;
+    int depth = 0;          // last fully completed iteration
+    uint64_t nodes = 0;
+};
+
+// Progress of a search while it runs, readable from any thread, e.g. for a status display
+struct SearchStats
+{
+    bool searching = false;
+    bool pondering = false;
+    int depth = 0;      // last completed iteration
+    uint64_t nodes = 0; // published every 1024 nodes
+    int hashfull = 0;   // permille of the table in use, sampled after each iteration
+};
+
+// Fixed-size, always-replace-if-deeper hash of earlier search results. Scores are stored
+// from the point of view of the side to move in the entry's position.
+//
+// Several searches may share one table from different threads without locking: each slot holds
+// the entry packed into one word plus the key xor'd with that word, so a slot torn by two
+// concurrent stores no longer matches its key and simply reads as a miss.
+class TranspositionTable
+{
+public:
+    enum Bound : uint8_t
+    {
+        None,
+        Exact,
+        Lower,
+        Upper
+    };
+
+    struct Entry
+    {
+        Move move;
+        int16_t score = 0;
+        int8_t depth = -1;
+        Bound bound = None;
+    };
+
+    explicit TranspositionTable(size_t megabytes);
+
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    bool probe(uint64_t key, Entry &entry) const;
+    void store(uint64_t key, Move move, int score, int depth, Bound bound);
+    void clear();
+    // Permille of used entries among the first thousand, which are as full as the rest
+    int hashfull() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+
+    static uint64_t pack(const Entry &entry);
+    static Entry unpack(uint64_t data);
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+};
+
+// Iterative deepening alpha-beta engine running on its own thread.
+//
+// A normal search reports through the completion callback once it reaches its limits. A
+// ponder search runs on the position after the reply we expect from the opponent and keeps
+// deepening until ponderHit() (the opponent played that move: the search carries on under the
+// normal limits and reports) or stop() (they played something else: discarded, the table keeps
+// what was learnt). The callback runs on the search thread.
+class Search
+{
+public:
+    using Callback = std::function<void(const SearchResult &)>;
+
+    explicit Search(size_t hashMegabytes = 16);
+    // Searches through a table owned elsewhere, shared with other searches
+    explicit Search(TranspositionTable &sharedTable);
+    ~Search();
+
+    Search(const Search &) = delete;
+    Search &operator=(const Search &) = delete;
+
+    // onIteration, if set, runs on the search thread after every completed iteration
+    void start(const Position &position, Color sideToMove, const SearchLimits &limits, Callback onDone, Callback onIteration = nullptr);
+    void startPonder(const Position &position, Color sideToMove, Move expectedMove, const SearchLimits &limits, Callback onDone);
+    // Searches on the calling thread instead, for callers with threads of their own such as a
+    // worker pool. stop() from another thread ends it early with the last completed iteration.
+    SearchResult run(const Position &position, Color sideToMove, const SearchLimits &limits);
+    void ponderHit();
+    void stop();
+    // Stops any search and forgets the hash table, e.g. for a reproducible benchmark
+    void clear();
+
+    bool isPondering() const { return pondering.load(); }
+    Move pondered() const { return ponderedMove; }
+    SearchStats liveStats() const;
+
+    // Result of the latest completed iteration (of the finished search once the callback ran)
+    SearchResult lastResult();
+
+private:
+    void iterativeDeepening(Position position, Color sideToMove, SearchLimits limits, Callback onDone, Callback onIteration);
+    // One copy per side to move; the recursion alternates between the two instantiations
+    template <Color Us>
+    int minimax(Position &position, int depth, int alpha, int beta, int ply);
+    // Every return from minimax goes through this, so a tree dump sees each node once
+    template <Color Us>
+    int dumpNode(const Position &position, int ply, int depth, int alpha, int beta, int score, TreeDump::Outcome outcome, int moveCount = 0,
+                 bool hadHashMove = false);
+    void orderMoves(const Position &position, std::vector<Move> &moves, Move hashMove) const;
+    Move guessReply(Position position, Color sideToMove, Move bestMove) const;
+    void launch(const Position &position, Color sideToMove, const SearchLimits &limits, Callback onDone, Callback onIteration, bool ponder);
+    bool shouldStop();
+    int elapsedMs() const;
+
+    static constexpr int MaxPly = 64;
+
+    std::unique_ptr<TranspositionTable> ownTable; // null when the table is shared
+    TranspositionTable &table;
+    std::thread worker;
+
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> pondering{false};
+    Move ponderedMove;
+
+    // Reset by ponderHit() from the GUI thread, so the clock restarts when our time starts
+    std::atomic<std::chrono::steady_clock::rep> startTicks{0};
+
+    // Written by the search thread for liveStats()
+    std::atomic<bool> searching{false};
+    std::atomic<int> liveDepth{0};
+    std::atomic<uint64_t> liveNodes{0};
+    std::atomic<int> liveHashfull{0};
+
+    std::mutex stateMutex;
+    std::condition_variable ponderWake;
+    SearchResult result;
+
+    // Only touched by the thread running the search
+    SearchLimits activeLimits;
+    int completedDepth = 0;
+    uint64_t nodes = 0;
+    bool aborted = false;
+    std::vector<Move> rootExcluded; // root moves already reported as better multiPV lines
+    Move pvTable[MaxPly][MaxPly];
+    int pvLength[MaxPly] = {};
+    // The move into the node at each ply and its place in the parent's order, for the tree dump
+    Move dumpMoves[MaxPly];
+    uint8_t dumpMoveIndex[MaxPly] = {};
+};
@@ -10,6 +10,13 @@ void Sound::Load(std::string filepath) {
     }
 }
 
+void Sound::Load(Mix_Chunk *chunk) {
+    if (m_chunk) {
+        Mix_FreeChunk(m_chunk);
+    }
+    m_chunk = chunk;
+}
+
 Sound::~Sound() {
     if (m_chunk) {
         Mix_FreeChunk(m_chunk);
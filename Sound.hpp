@@ -1,3 +1,5 @@
+#pragma once
+
 #include <SDL2/SDL_mixer.h>
 #include<string>
 
@@ -7,12 +9,13 @@ public:
 
     Sound() = default;
     void Load(std::string filepath);
+    void Load(Mix_Chunk *chunk); // takes ownership of an already decoded chunk
     ~Sound();
 
     void play(int channel);
     void stop(int channel);
 
 private:
-    Mix_Chunk* m_chunk;
+    Mix_Chunk* m_chunk = nullptr;
 };
 
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Trace.hpp"
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        int64_t startNs;
+        int64_t endNs;
+    };
+
+    // Single writer (the owning thread), read by the exporter. The writer fills a slot and then
+    // publishes it by bumping head; the reader drops anything the writer may have lapped.
+    struct ThreadBuffer
+    {
+        static constexpr uint64_t Capacity = 1 << 15;
+
+        Event events[Capacity];
+        std::atomic<uint64_t> head{0};
+        std::atomic<bool> inUse{false};
+        std::atomic<const char *> threadName{nullptr};
+        int id = 0;
+    };
+
+    // Buffers live for the whole run and are handed to new threads once their owner exits,
+    // so short-lived search threads don't grow the list
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+    ThreadBuffer *acquireBuffer()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto &buffer : registry)
+        {
+            bool expected = false;
+            if (buffer->inUse.compare_exchange_strong(expected, true))
+            {
+                buffer->threadName = nullptr;
+                return buffer.get();
+            }
+        }
+        registry.push_back(std::make_unique<ThreadBuffer>());
+        ThreadBuffer *buffer = registry.back().get();
+        buffer->id = static_cast<int>(registry.size());
+        buffer->inUse = true;
+        return buffer;
+    }
+
+    struct ThreadHandle
+    {
+        ThreadBuffer *buffer = nullptr;
+
+        ThreadBuffer *get()
+        {
+            if (!buffer)
+            {
+                buffer = acquireBuffer();
+            }
+            return buffer;
+        }
+
+        ~ThreadHandle()
+        {
+            if (buffer)
+            {
+                buffer->inUse = false;
+            }
+        }
+    };
+
+    thread_local ThreadHandle threadHandle;
+
+    std::atomic<int64_t> exportFromNs{0};
+
+    void writeEscaped(std::FILE *out, const char *text)
+    {
+        for (; *text; text++)
+        {
+            if (*text == '"' || *text == '\\')
+            {
+                std::fputc('\\', out);
+            }
+            std::fputc(*text, out);
+        }
+    }
+}
+
+namespace Trace
+{
+    std::atomic<bool> enabled{false};
+
+    void setEnabled(bool on)
+    {
+        enabled.store(on, std::memory_order_relaxed);
+    }
+
+    void setThreadName(const char *name)
+    {
+        threadHandle.get()->threadName = name;
+    }
+
+    int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record(const char *name, int64_t startNs, int64_t endNs)
+    {
+        ThreadBuffer *buffer = threadHandle.get();
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        buffer->events[head % ThreadBuffer::Capacity] = {name, startNs, endNs};
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+
+    bool writeChromeJson(const std::string &path)
+    {
+        std::FILE *out = std::fopen(path.c_str(), "w");
+        if (!out)
+        {
+            return false;
+        }
+
+        std::vector<ThreadBuffer *> buffers;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (auto &buffer : registry)
+            {
+                buffers.push_back(buffer.get());
+            }
+        }
+
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+        bool first = true;
+        std::vector<Event> events;
+        for (ThreadBuffer *buffer : buffers)
+        {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = head > ThreadBuffer::Capacity ? head - ThreadBuffer::Capacity : 0;
+            events.clear();
+            for (uint64_t i = begin; i < head; i++)
+            {
+                events.push_back(buffer->events[i % ThreadBuffer::Capacity]);
+            }
+
+            // Slots the writer reached again while we were copying hold newer events than we
+            // think, so drop the oldest ones it may have overwritten
+            uint64_t after = buffer->head.load(std::memory_order_acquire);
+            uint64_t safeBegin = after > ThreadBuffer::Capacity ? after - ThreadBuffer::Capacity : 0;
+            if (safeBegin > begin)
+            {
+                events.erase(events.begin(), events.begin() + static_cast<size_t>(std::min<uint64_t>(events.size(), safeBegin - begin)));
+            }
+            int64_t from = exportFromNs;
+            events.erase(std::remove_if(events.begin(), events.end(), [from](const Event &event)
+                                        { return event.startNs < from; }),
+                         events.end());
+
+            if (const char *name = buffer->threadName.load())
+            {
+                std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", first ? "" : ",\n", buffer->id);
+                writeEscaped(out, name);
+                std::fputs("\"}}", out);
+                first = false;
+            }
+            for (const Event &event : events)
+            {
+                std::fprintf(out, "%s{\"name\":\"", first ? "" : ",\n");
+                writeEscaped(out, event.name);
+                std::fprintf(out, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", buffer->id,
+                             event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0);
+                first = false;
+            }
+        }
+        std::fputs("\n]}\n", out);
+        return std::fclose(out) == 0;
+    }
+
+    void clear()
+    {
+        // Only the owning threads may touch their buffers, so just move the export window
+        exportFromNs = nowNs();
+    }
+}
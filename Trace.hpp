@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped timing zones exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+//
+//   void ChessBoard::render() { TRACE_ZONE("render"); ... }
+//
+// Each thread records into its own fixed ring buffer with no locks; once full it keeps the
+// most recent events. With tracing off a zone costs one relaxed atomic load. Zone names must
+// be string literals (or otherwise outlive the export). Define CHESS_NO_TRACE to compile the
+// zones out entirely.
+namespace Trace
+{
+    extern std::atomic<bool> enabled;
+
+    void setEnabled(bool on);
+    inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Label for the calling thread's track in the viewer
+    void setThreadName(const char *name);
+
+    int64_t nowNs();
+    void record(const char *name, int64_t startNs, int64_t endNs);
+
+    // Writes every buffered event; safe to call while other threads keep recording
+    bool writeChromeJson(const std::string &path);
+    void clear();
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char *zoneName) : name(isEnabled() ? zoneName : nullptr), start(name ? nowNs() : 0) {}
+        ~Zone()
+        {
+            if (name)
+            {
+                record(name, start, nowNs());
+            }
+        }
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *name;
+        int64_t start;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef CHESS_NO_TRACE
+#define TRACE_ZONE(name)
+#else
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#endif
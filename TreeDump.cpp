@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include "TreeDump.hpp"
+
+namespace
+{
+    std::mutex fileMutex;
+    std::FILE *file = nullptr;
+    std::atomic<uint32_t> nextThread{1};
+
+    void writeChunk(uint32_t thread, const TreeDump::Record *records, uint32_t count)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        if (!file || count == 0)
+        {
+            return;
+        }
+        TreeDump::ChunkHeader header = {thread, count};
+        std::fwrite(&header, sizeof(header), 1, file);
+        std::fwrite(records, sizeof(TreeDump::Record), count, file);
+    }
+
+    // 64 KB per thread; written out whole when full and when the thread exits
+    struct ThreadBuffer
+    {
+        static constexpr uint32_t Capacity = 4096;
+
+        TreeDump::Record records[Capacity];
+        uint32_t count = 0;
+        uint32_t thread = 0;
+
+        void flush()
+        {
+            if (count == 0)
+            {
+                return;
+            }
+            if (thread == 0)
+            {
+                thread = nextThread.fetch_add(1);
+            }
+            writeChunk(thread, records, count);
+            count = 0;
+        }
+
+        ~ThreadBuffer() { flush(); }
+    };
+
+    thread_local ThreadBuffer threadBuffer;
+}
+
+namespace TreeDump
+{
+    std::atomic<bool> enabled{false};
+
+    bool start(const std::string &path)
+    {
+        stop();
+        std::lock_guard<std::mutex> lock(fileMutex);
+        file = std::fopen(path.c_str(), "wb");
+        if (!file)
+        {
+            return false;
+        }
+        FileHeader header = {};
+        std::memcpy(header.magic, FileMagic, sizeof(header.magic));
+        header.version = FileVersion;
+        header.recordSize = sizeof(Record);
+        std::fwrite(&header, sizeof(header), 1, file);
+        enabled.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    void stop()
+    {
+        enabled.store(false, std::memory_order_relaxed);
+        threadBuffer.flush();
+        std::lock_guard<std::mutex> lock(fileMutex);
+        if (file)
+        {
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    void record(const Record &record)
+    {
+        ThreadBuffer &buffer = threadBuffer;
+        buffer.records[buffer.count++] = record;
+        if (buffer.count == ThreadBuffer::Capacity)
+        {
+            buffer.flush();
+        }
+    }
+
+    void flush()
+    {
+        threadBuffer.flush();
+    }
+}
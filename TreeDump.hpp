@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "Position.hpp"
+
+// Opt-in recording of the alpha-beta tree for offline analysis with tools/tree_stats.cpp.
+//
+//   TreeDump::start("tree.bin");  ... search ...  TreeDump::stop();
+//
+// Search::minimax writes one record per node as the node returns, so every node follows its
+// children. Each thread appends to its own buffer without locks; a full buffer is written to
+// the file as one chunk under a lock, and the search flushes after every iteration. With
+// recording off a node costs one relaxed atomic load. Define CHESS_NO_TREE_DUMP to compile the
+// recording out of the search entirely.
+//
+// The file is a FileHeader followed by chunks, each a ChunkHeader and its records. Chunks from
+// one thread are in order; the thread id separates the streams of concurrent searches.
+namespace TreeDump
+{
+    constexpr char FileMagic[8] = {'C', 'H', 'E', 'S', 'S', 'T', 'R', 'E'};
+    constexpr uint32_t FileVersion = 1;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+    };
+
+    struct ChunkHeader
+    {
+        uint32_t thread; // small id, numbered from 1 in the order threads first record
+        uint32_t count;  // records that follow
+    };
+
+    // Why a node returned the score it did
+    enum class Outcome : uint8_t
+    {
+        Exact,     // score inside the window
+        FailHigh,  // a move reached beta; the rest were pruned
+        FailLow,   // no move reached alpha
+        HashCut,   // the table's bound settled it without searching
+        Leaf,      // depth ran out and the evaluation scored it
+        Draw,      // repetition, fifty-move rule or dead material
+        Mate,
+        Stalemate,
+        Aborted,   // the search was stopped; the score means nothing
+        Iteration, // not a node: marks the start of a root search, depth is the iteration
+        Count
+    };
+
+    enum Flags : uint8_t
+    {
+        HadHashMove = 1 // the table supplied a move to try first
+    };
+
+    struct Record
+    {
+        uint16_t move;     // move into the node, from | to << 6 | promotion << 12; 0 at the root
+        int16_t alpha;     // window on entry, from the side to move's point of view
+        int16_t beta;
+        int16_t score;     // what the node returned
+        int8_t depth;      // remaining depth on entry
+        uint8_t ply;
+        uint8_t moveIndex; // position of the move in the parent's ordered list; the multiPV line at the root
+        uint8_t moveCount; // legal moves at the node, 0 when it returned before generating them
+        Outcome outcome;
+        uint8_t flags;     // Flags
+        uint16_t keyTag;   // top 16 bits of the position key, to spot transpositions
+    };
+
+    static_assert(sizeof(FileHeader) == 16, "tree dump header must stay packed");
+    static_assert(sizeof(Record) == 16, "tree dump records must stay 16 bytes");
+
+    extern std::atomic<bool> enabled;
+
+    inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Creates the file and turns recording on; false if the file can't be created
+    bool start(const std::string &path);
+    // Turns recording off and closes the file after writing the calling thread's buffer. Other
+    // threads' buffers are written when they next flush; once the file is closed they are dropped.
+    void stop();
+
+    void record(const Record &record);
+    // Writes the calling thread's buffered records
+    void flush();
+}
@@ -6,8 +6,27 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
-#include <tuple>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "AnalysisOverlay.hpp"
+#include "AssetBundle.hpp"
+#include "AudioQueue.hpp"
+#include "EvalParams.hpp"
+#include "GameRecord.hpp"
+#include "LearningFile.hpp"
+#include "MateSolver.hpp"
+#include "Mcts.hpp"
+#include "Nnue.hpp"
+#include "OpeningExplorer.hpp"
+#include "PerfHud.hpp"
+#include "Position.hpp"
+#include "Search.hpp"
 #include "Sound.hpp"
+#include "Trace.hpp"
+#include "TreeDump.hpp"
 
 int SCREEN_HEIGHT = 720;
 int SCREEN_WIDTH = 720;
@@ -16,20 +35,10 @@ enum GameState
 {
     STARTINGSCREEN,
     PLAYING,
+    PROMOTING, // the human moved a pawn to the last rank and is choosing its piece
     GAMEOVER
 };
 
-enum class Troops
-{
-    Bishop,
-    Knight,
-    Rook,
-    King,
-    Queen,
-    Pawn,
-    None
-};
-
 Sound move_Sound;
 Sound attack_Sound;
 Sound checkmate_Sound;
@@ -37,80 +46,94 @@ Sound kingcheck_Sound;
 Sound gamestart_Sound;
 Sound Promotion_Sound;
 
-enum class Color
-{
-    Black,
-    White,
-    None
-};
-
-class Piece
-{
-public:
-    Color color;
-    Troops TroopType;
+// Moves and game events are heard through the queue's thread, never played inline
+AudioQueue audio;
 
-    bool hasMoved;
-    bool isKing() const
-    {
-        return TroopType == Troops::King; // Compare the piece type with KING
-    }
-    Piece(Troops armyType = Troops::None, Color colortype = Color::None) : color(colortype), TroopType(armyType), hasMoved{false} {}
-};
+// Bundle names of the piece textures, in the order ChessBoard::pieceTextures indexes them
+const std::vector<std::string> pieceTextureFiles = {
+    "textures/Black_Pawn.png", "textures/Black_Rook.png", "textures/Black_Knight.png",
+    "textures/Black_Bishop.png", "textures/Black_Queen.png", "textures/Black_King.png",
+    "textures/White_Pawn.png", "textures/White_Rook.png", "textures/White_Knight.png",
+    "textures/White_Bishop.png", "textures/White_Queen.png", "textures/White_King.png"};
 
 class ChessBoard
 {
 private:
     SDL_Renderer *renderer;
-    std::vector<std::vector<Piece>> board;
+    Position position;
     std::vector<SDL_Texture *> pieceTextures;
     std::pair<int, int> lastMovedPiece = std::make_pair(-1, -1);
     std::pair<int, int> selectedPiece = {-1, -1};
     std::vector<std::pair<int, int>> highlightMove;
+    Move lastMove;
+
+    // Every move played, for takeback, stepping through the game and replay
+    GameRecord record;
+
+    // The engine searches on its own thread and reports finished searches as aiMoveEvent.
+    // The analysis engine is separate so analysing never disturbs the AI's own search.
+    Uint32 aiMoveEvent;
+    Uint32 analysisEvent;
+    SearchLimits aiLimits;
+
+    // Every finished AI search is kept in the learning file; a position it already holds a deep
+    // enough result for is answered from there, and that move stands in for the search's
+    LearningFile learning;
+    Move learnedMove;
+
+    // Each AI search tags its aiMoveEvent with the generation it started in. Stopping the AI
+    // moves to the next one, so an event a stopped search had already queued is recognised
+    // and dropped instead of being taken for the answer of the search that replaced it.
+    int aiGeneration = 0;
+
+    // The mate solver also runs on a thread of its own and announces its answer as mateEvent
+    Uint32 mateEvent;
+    MateSolver mateSolver{32};
+    MateResult mateResult;
+    std::atomic<bool> mateStop{false};
+    std::atomic<bool> mateDone{false};
+    std::thread mateThread;
+
+    // The AI plays with the alpha-beta engine, or with the Monte Carlo tree search when chosen
+    bool useMcts = false;
+    MctsLimits mctsLimits;
+
+    Search engine; // declared last so their threads are joined before the members they report through go away
+    Search analysis{8};
+    Mcts mcts{128};
 
 public:
-    ChessBoard(SDL_Renderer *render) : renderer(render), board(8, std::vector<Piece>(8, Piece()))
+    ChessBoard(SDL_Renderer *render, const std::vector<SDL_Surface *> &pieceSurfaces) : renderer(render), aiMoveEvent(SDL_RegisterEvents(1)), analysisEvent(SDL_RegisterEvents(1)), mateEvent(SDL_RegisterEvents(1))
     {
-        SetupBoard();
-        LoadTextures(renderer);
+        LoadTextures(renderer, pieceSurfaces);
+        record.reset(position, Color::White);
     }
 
     ~ChessBoard()
     {
+        stopMateSearch();
         for (auto texture : pieceTextures)
         {
             SDL_DestroyTexture(texture);
         }
     }
 
-    void LoadTextures(SDL_Renderer *renderer)
+    void LoadTextures(SDL_Renderer *renderer, const std::vector<SDL_Surface *> &surfaces)
     {
+        // Black pieces first, then white, in the order of pieceTextureFiles
         pieceTextures.resize(12);
 
-        // Load Black pieces
-        pieceTextures[0] = IMG_LoadTexture(renderer, "textures/Black_Pawn.png");
-
-        pieceTextures[1] = IMG_LoadTexture(renderer, "textures/Black_Rook.png");
-
-        pieceTextures[2] = IMG_LoadTexture(renderer, "textures/Black_Knight.png");
-        pieceTextures[3] = IMG_LoadTexture(renderer, "textures/Black_Bishop.png");
-        pieceTextures[4] = IMG_LoadTexture(renderer, "textures/Black_Queen.png");
-        pieceTextures[5] = IMG_LoadTexture(renderer, "textures/Black_King.png");
-
-        // Load White pieces
-        pieceTextures[6] = IMG_LoadTexture(renderer, "textures/White_Pawn.png");
-        pieceTextures[7] = IMG_LoadTexture(renderer, "textures/White_Rook.png");
-        pieceTextures[8] = IMG_LoadTexture(renderer, "textures/White_Knight.png");
-        pieceTextures[9] = IMG_LoadTexture(renderer, "textures/White_Bishop.png");
-        pieceTextures[10] = IMG_LoadTexture(renderer, "textures/White_Queen.png");
-        pieceTextures[11] = IMG_LoadTexture(renderer, "textures/White_King.png");
+        for (size_t i = 0; i < pieceTextures.size(); i++)
+        {
+            pieceTextures[i] = surfaces[i] ? SDL_CreateTextureFromSurface(renderer, surfaces[i]) : nullptr;
+        }
     }
 
     void selectPiece(int x, int y)
     {
         selectedPiece = {x, y};
-        Piece &piece = get_PieceAt(x, y); // check this
-        highlightMove = getLegalMoves(piece, x, y);
+        const Piece &piece = get_PieceAt(x, y); // check this
+        highlightMove = position.getLegalMoves(piece, x, y);
     }
 
     bool isPieceSelected() const
@@ -124,344 +147,37 @@ public:
         highlightMove.clear();
     }
 
-    void printBoard()
-    {
-        for (const auto &rows : board)
-        {
-            for (const auto &piece : rows)
-            {
-                const char pieceSymbol = get_PieceAtdata(piece);
-                std::cout << pieceSymbol << " ";
-            }
-            std::cout << std::endl;
-        }
-    }
-
-    bool simulateMove(int srcX, int srcY, int destX, int destY, Color currentPlayerColor)
-    {
-        Piece pieceToMove = board[srcY][srcX];
-        Piece backupPiece = board[destY][destX];
-
-        board[destY][destX] = pieceToMove;
-        board[srcY][srcX] = Piece(Troops::None, Color::None);
-
-        std::pair<int, int> KingPosition = findKingPosition(currentPlayerColor);
-        bool inCheck = IsKingCheck(KingPosition.first, KingPosition.second, currentPlayerColor);
-
-        board[srcY][srcX] = pieceToMove;
-        board[destY][destX] = backupPiece;
-
-        return !inCheck;
-    }
-
-    bool isCheckMate(Color currentPlayerColor)
-    {
-        for (int y = 0; y < 8; y++)
-        {
-            for (int x = 0; x < 8; x++)
-            {
-                Piece &piece = board[y][x];
-
-                if (piece.color == currentPlayerColor)
-                {
-                    std::vector<std::pair<int, int>> legalMoves = getLegalMoves(piece, x, y);
-
-                    for (const auto &move : legalMoves)
-                    {
-                        if (simulateMove(x, y, move.first, move.second, currentPlayerColor))
-                        {
-                            return false; // A move is possible to save the king
-                        }
-                    }
-                }
-            }
-        }
-        return true;
-    }
-
-    bool isStaleMate(Color currentPlayerColor)
+    bool isLegalMove(int x, int y)
     {
-        for (int y = 0; y < 8; y++)
+        for (const auto &move : highlightMove)
         {
-            for (int x = 0; x < 8; x++)
+            if (move.first == x && move.second == y)
             {
-                Piece &piece = board[y][x];
-
-                if (piece.color == currentPlayerColor)
-                {
-                    std::vector<std::pair<int, int>> legalMoves = getLegalMoves(piece, x, y);
-
-                    for (const auto &move : legalMoves)
-                    {
-                        if (simulateMove(x, y, move.first, move.second, currentPlayerColor))
-                        {
-                            return false; // A move is possible
-                        }
-                    }
-                }
+                return true;
             }
         }
-
-        return true;
-    }
-
-    bool isInsideBoard(int x, int y)
-    {
-        return x >= 0 && x < 8 && y >= 0 && y < 8;
-    }
-
-    bool isEmpty(int x, int y)
-    {
-        return board[y][x].TroopType == Troops::None;
-    }
-
-    bool isOpponentPiece(int x, int y, Color currentPlayerColor)
-    {
-
-        if (!isInsideBoard(x, y) || isEmpty(x, y))
-        {
-            return false;
-        }
-
-        return board[y][x].color != currentPlayerColor;
+        return false;
     }
 
-    bool isFriendlyPiece(int x, int y, Color currentPlayerColor)
+    const Piece &get_PieceAt(int x, int y) const
     {
-        if (!isInsideBoard(x, y) || isEmpty(x, y))
-        {
-            return false;
-        }
-
-        return board[y][x].color == currentPlayerColor;
+        return position.get_PieceAt(x, y);
     }
 
-    std::vector<std::pair<int, int>> getLegalMoves(Piece piece, int x, int y)
+    void printBoard() const
     {
-        std::vector<std::pair<int, int>> moves;
-        if (piece.TroopType == Troops::Pawn)
-        {
-            int direction = (piece.color == Color::Black) ? 1 : -1;
-            int startRow = (piece.color == Color::Black) ? 1 : 6;
-
-            if (isInsideBoard(x, y + direction) && isEmpty(x, y + direction))
-            {
-                moves.push_back({x, y + direction});
-
-                if (y == startRow && isInsideBoard(x, y + 2 * direction) && isEmpty(x, y + 2 * direction))
-                {
-                    moves.push_back({x, y + 2 * direction});
-                }
-            }
-
-            // Diagonal attack
-            if (isInsideBoard(x - 1, y + direction) && isOpponentPiece(x - 1, y + direction, piece.color))
-            {
-                moves.push_back({x - 1, y + direction});
-            }
-            if (isInsideBoard(x + 1, y + direction) && isOpponentPiece(x + 1, y + direction, piece.color))
-            {
-                moves.push_back({x + 1, y + direction});
-            }
-        }
-        else if (piece.TroopType == Troops::Knight)
-        {
-            std::vector<std::pair<int, int>> knightMoves = {
-                {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
-
-            for (auto move : knightMoves)
-            {
-                int newX = x + move.first;
-                int newY = y + move.second;
-
-                if (isInsideBoard(newX, newY) && !isFriendlyPiece(newX, newY, piece.color))
-                {
-                    moves.push_back({newX, newY});
-                }
-            }
-        }
-        else if (piece.TroopType == Troops::Rook)
-        {
-
-            std::vector<std::pair<int, int>> directions = {
-                {0, 1},  // Move up (positive y)
-                {0, -1}, // Move down (negative y)
-                {1, 0},  // Move right (positive x)
-                {-1, 0}  // Move left (negative x)
-            };
-
-            for (const auto &direction : directions)
-            {
-                int dx = direction.first;
-                int dy = direction.second;
-
-                for (int j = 1; j < 8; j++)
-                {
-                    int newX = x + j * dx;
-                    int newY = y + j * dy;
-
-                    if (isInsideBoard(newX, newY))
-                    {
-                        if (isEmpty(newX, newY))
-                        {
-                            moves.push_back({newX, newY});
-                        }
-                        else if (isOpponentPiece(newX, newY, piece.color))
-                        {
-                            moves.push_back({newX, newY});
-                            break;
-                        }
-                        else
-                        {
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        break; // Out of bounds, stop
-                    }
-                }
-            }
-        }
-        else if (piece.TroopType == Troops::Bishop)
-        {
-            std::vector<std::pair<int, int>> directions = {
-                {1, 1},
-                {1, -1},
-                {-1, 1},
-                {-1, -1}};
-
-            for (const auto &direction : directions)
-            {
-                int dx = direction.first;
-                int dy = direction.second;
-
-                for (int j = 1; j < 8; j++)
-                {
-                    int newX = x + j * dx;
-                    int newY = y + j * dy;
-
-                    if (isInsideBoard(newX, newY))
-                    {
-                        if (isEmpty(newX, newY))
-                        {
-                            moves.push_back({newX, newY});
-                        }
-                        else if (isOpponentPiece(newX, newY, piece.color))
-                        {
-                            moves.push_back({newX, newY});
-                            break;
-                        }
-                        else
-                        {
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        break; // Out of boundss
-                    }
-                }
-            }
-        }
-        else if (piece.TroopType == Troops::Queen)
-        {
-            std::vector<std::pair<int, int>> directions = {
-                // combining both the bishop and the rook 's tactics
-                {0, 1},
-                {0, -1},
-                {1, 0},
-                {-1, 0},
-                {1, 1},
-                {1, -1},
-                {-1, 1},
-                {-1, -1}};
-
-            for (const auto &direction : directions)
-            {
-                int dx = direction.first;
-                int dy = direction.second;
-
-                for (int j = 1; j < 8; j++)
-                {
-                    int newX = x + j * dx;
-                    int newY = y + j * dy;
-
-                    if (isInsideBoard(newX, newY))
-                    {
-                        if (isEmpty(newX, newY))
-                        {
-                            moves.push_back({newX, newY});
-                        }
-                        else if (isOpponentPiece(newX, newY, piece.color))
-                        {
-                            moves.push_back({newX, newY});
-                            break;
-                        }
-                        else
-                        {
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        break; // Out of bounds
-                    }
-                }
-            }
-        }
-        else if (piece.TroopType == Troops::King)
-        {
-            std::vector<std::pair<int, int>> directions = {
-                {0, 1},  // Move up
-                {0, -1}, // Move down
-                {1, 0},  // Move right
-                {-1, 0}, // Move left
-                {1, 1},  // Move up-right
-                {1, -1}, // Move down-right
-                {-1, 1}, // Move up-left
-                {-1, -1} // Move down-left
-            };
-
-            for (const auto &direction : directions)
-            {
-                int dx = direction.first;
-                int dy = direction.second;
-
-                int newX = x + dx;
-                int newY = y + dy;
-
-                if (isInsideBoard(newX, newY))
-                {
-                    if (isEmpty(newX, newY))
-                    {
-                        moves.push_back({newX, newY});
-                    }
-                    else if (isOpponentPiece(newX, newY, piece.color))
-                    {
-                        moves.push_back({newX, newY});
-                    }
-                }
-            }
-        }
-        return moves;
+        position.printBoard();
     }
 
-    bool isLegalMove(int x, int y)
+    // Key of the current position as the opening explorer index stores it
+    uint64_t positionKey(Color sideToMove) const
     {
-        for (const auto &move : highlightMove)
-        {
-            if (move.first == x && move.second == y)
-            {
-                return true;
-            }
-        }
-        return false;
+        return position.placementKey() ^ Position::sideKey(sideToMove);
     }
 
-    Piece &get_PieceAt(int x, int y)
+    GameStatus gameStatus(Color currentPlayerColor)
     {
-        return board[y][x];
+        return position.gameStatus(currentPlayerColor);
     }
 
     void renderPiece(SDL_Renderer *render, const Piece &piece, int x, int y)
@@ -542,89 +258,9 @@ public:
         highlightMove.clear();
     }
 
-    void SetupBoard()
-    {
-        // for upper set  of pieces // black side
-        board[0][0] = Piece(Troops::Rook, Color::Black);
-        board[0][1] = Piece(Troops::Knight, Color::Black);
-        board[0][2] = Piece(Troops::Bishop, Color::Black);
-        board[0][3] = Piece(Troops::Queen, Color::Black);
-        board[0][4] = Piece(Troops::King, Color::Black);
-        board[0][5] = Piece(Troops::Bishop, Color::Black);
-        board[0][6] = Piece(Troops::Knight, Color::Black);
-        board[0][7] = Piece(Troops::Rook, Color::Black);
-
-        for (int j = 0; j < 8; j++)
-        {
-            board[1][j] = Piece(Troops::Pawn, Color::Black);
-        }
-
-        // for lower set  of pieces  // white side
-        board[7][0] = Piece(Troops::Rook, Color::White);
-        board[7][1] = Piece(Troops::Knight, Color::White);
-        board[7][2] = Piece(Troops::Bishop, Color::White);
-        board[7][3] = Piece(Troops::Queen, Color::White);
-        board[7][4] = Piece(Troops::King, Color::White);
-        board[7][5] = Piece(Troops::Bishop, Color::White);
-        board[7][6] = Piece(Troops::Knight, Color::White);
-        board[7][7] = Piece(Troops::Rook, Color::White);
-
-        for (int j = 0; j < 8; j++)
-        {
-            board[6][j] = Piece(Troops::Pawn, Color::White);
-        }
-    }
-
-    char get_PieceAtdata(const Piece &pieces)
-    {
-        if (pieces.color == Color::Black)
-        {
-            switch (pieces.TroopType)
-            {
-            case Troops::Rook:
-                return 'R';
-            case Troops::Pawn:
-                return 'P';
-            case Troops::Knight:
-                return 'N';
-            case Troops::Bishop:
-                return 'B';
-            case Troops::Queen:
-                return 'Q';
-            case Troops::King:
-                return 'K';
-            default:
-                return '.';
-            }
-        }
-
-        else if (pieces.color == Color::White)
-        {
-            switch ((pieces.TroopType))
-            {
-
-            case Troops::Rook:
-                return 'r';
-            case Troops::Pawn:
-                return 'p';
-            case Troops::Knight:
-                return 'n';
-            case Troops::Bishop:
-                return 'b';
-            case Troops::Queen:
-                return 'q';
-            case Troops::King:
-                return 'k';
-            default:
-                return '.';
-            }
-        }
-
-        return '.';
-    }
-
     void render(SDL_Renderer *renderer)
     {
+        TRACE_ZONE("ChessBoard::render");
         SDL_Rect boardRect;
         for (int i = 0; i < 8; i++)
         {
@@ -690,415 +326,419 @@ public:
         selectedPiece = std::make_pair(x, y);
     }
 
-    void promotePawnSDL(SDL_Renderer *renderer, int x, int y, Color color)
+    // Does moving the piece on (srcX, srcY) to (destX, destY) need a promotion piece?
+    bool isPromotionMove(int srcX, int srcY, int destX, int destY) const
     {
+        const Piece &piece = position.get_PieceAt(srcX, srcY);
+        return piece.TroopType == Troops::Pawn && (destY == 0 || destY == 7) && position.isInsideBoard(destX, destY);
+    }
 
-        SDL_Rect promotionOptions[4];
-        int optionWidth = 100;
-        int optionHeight = 100;
-
-        promotionOptions[0] = {100, 200, optionWidth, optionHeight}; // Queen
-        promotionOptions[1] = {250, 200, optionWidth, optionHeight}; // Rook
-        promotionOptions[2] = {400, 200, optionWidth, optionHeight}; // Bishop
-        promotionOptions[3] = {550, 200, optionWidth, optionHeight}; // Knight
-
-        SDL_Texture *rookTexture = nullptr;
-        SDL_Texture *knightTexture = nullptr;
-        SDL_Texture *bishopTexture = nullptr;
-        SDL_Texture *queenTexture = nullptr;
+    // Where the promotion dialog shows each piece: queen, rook, bishop, knight
+    static SDL_Rect promotionOptionRect(int index)
+    {
+        return {100 + index * 150, 200, 100, 100};
+    }
 
-        if (color == Color::White)
-        {
-            queenTexture = IMG_LoadTexture(renderer, "textures/White_Queen.png");
-            rookTexture = IMG_LoadTexture(renderer, "textures/White_Rook.png");
-            knightTexture = IMG_LoadTexture(renderer, "textures/White_Knight.png");
-            bishopTexture = IMG_LoadTexture(renderer, "textures/White_Bishop.png");
-        }
-        else if (color == Color::Black)
+    // The promotion piece under a click in the dialog, Troops::None outside the options
+    static Troops promotionChoiceAt(int x, int y)
+    {
+        const Troops choices[4] = {Troops::Queen, Troops::Rook, Troops::Bishop, Troops::Knight};
+        SDL_Point point = {x, y};
+        for (int i = 0; i < 4; i++)
         {
-            queenTexture = IMG_LoadTexture(renderer, "textures/Black_Queen.png");
-            rookTexture = IMG_LoadTexture(renderer, "textures/Black_Rook.png");
-            knightTexture = IMG_LoadTexture(renderer, "textures/Black_Knight.png");
-            bishopTexture = IMG_LoadTexture(renderer, "textures/Black_Bishop.png");
+            SDL_Rect rect = promotionOptionRect(i);
+            if (SDL_PointInRect(&point, &rect))
+            {
+                return choices[i];
+            }
         }
+        return Troops::None;
+    }
 
-        if (!queenTexture || !rookTexture || !bishopTexture || !knightTexture)
-        {
-            std::cerr << "Error loading textures!" << std::endl;
-            return;
-        }
-        if (color == Color::Black)
-        {
-            // Automatically promote to a random piece for black pawns
-            srand(static_cast<unsigned int>(time(nullptr)));              // Seed with current time
-            int randomIndex = rand() % 4;                                 // Randomly select an index between 0 and 3
-            board[y][x] = Piece(static_cast<Troops>(randomIndex), color); // Promote to random piece
-        }
-        else if (color == Color::White)
+    // Draws the promotion choices over the board; the main loop turns a click into the piece
+    void renderPromotionChoice(SDL_Renderer *renderer, Color color)
+    {
+        TRACE_ZONE("renderPromotionChoice");
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0x80);
+        SDL_Rect shade = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        SDL_RenderFillRect(renderer, &shade);
+
+        // Reuse the board's piece textures: black ones start at 0, white ones at 6
+        int textureBase = (color == Color::White) ? 6 : 0;
+        SDL_Texture *textures[4] = {pieceTextures[textureBase + 4], pieceTextures[textureBase + 1], pieceTextures[textureBase + 3], pieceTextures[textureBase + 2]};
+        for (int i = 0; i < 4; i++)
         {
-            bool promotionSelected = false;
-            while (!promotionSelected)
+            SDL_Rect rect = promotionOptionRect(i);
+            SDL_SetRenderDrawColor(renderer, 0xee, 0xee, 0xee, 0xff);
+            SDL_RenderFillRect(renderer, &rect);
+            if (textures[i])
             {
-                SDL_Event event;
-                while (SDL_PollEvent(&event))
-                {
-                    if (event.type == SDL_MOUSEBUTTONDOWN)
-                    {
-                        int mouseX, mouseY;
-                        SDL_GetMouseState(&mouseX, &mouseY);
-                        SDL_Point mousePoint = {mouseX, mouseY};
-
-                        if (SDL_PointInRect(&mousePoint, &promotionOptions[0]))
-                        {
-                            board[y][x] = Piece(Troops::Queen, color); // Promote to Queen
-                            promotionSelected = true;
-                        }
-                        else if (SDL_PointInRect(&mousePoint, &promotionOptions[1]))
-                        {
-                            board[y][x] = Piece(Troops::Rook, color); // Promote to Rook
-                            promotionSelected = true;
-                        }
-                        else if (SDL_PointInRect(&mousePoint, &promotionOptions[2]))
-                        {
-                            board[y][x] = Piece(Troops::Bishop, color); // Promote to Bishop
-                            promotionSelected = true;
-                        }
-                        else if (SDL_PointInRect(&mousePoint, &promotionOptions[3]))
-                        {
-                            board[y][x] = Piece(Troops::Knight, color); // Promote to Knight
-                            promotionSelected = true;
-                        }
-                    }
-                }
-
-                SDL_RenderClear(renderer);
-
-                SDL_RenderCopy(renderer, queenTexture, nullptr, &promotionOptions[0]);
-                SDL_RenderCopy(renderer, rookTexture, nullptr, &promotionOptions[1]);
-                SDL_RenderCopy(renderer, bishopTexture, nullptr, &promotionOptions[2]);
-                SDL_RenderCopy(renderer, knightTexture, nullptr, &promotionOptions[3]);
-
-                SDL_RenderPresent(renderer);
+                SDL_RenderCopy(renderer, textures[i], nullptr, &rect);
             }
         }
-
-        // Clean up textures
-        SDL_DestroyTexture(queenTexture);
-        SDL_DestroyTexture(rookTexture);
-        SDL_DestroyTexture(bishopTexture);
-        SDL_DestroyTexture(knightTexture);
     }
 
-    bool movePiece(int srcX, int srcY, int destX, int destY)
+    // Plays the move if it is legal. A pawn reaching the last rank becomes promotion, or a
+    // queen when none is given.
+    bool movePiece(int srcX, int srcY, int destX, int destY, Troops promotion = Troops::None)
     {
-        if (!isInsideBoard(srcX, srcY) || !isInsideBoard(destX, destY))
+        if (!position.isInsideBoard(srcX, srcY) || !position.isInsideBoard(destX, destY))
         {
             return false;
         }
 
-        Piece backUpPiece = board[destY][destX];
-        Piece pieceToMove = board[srcY][srcX];
+        Piece backUpPiece = position.get_PieceAt(destX, destY);
+        Piece pieceToMove = position.get_PieceAt(srcX, srcY);
 
-        if (pieceToMove.TroopType == Troops::Pawn)
+        Move move(srcX, srcY, destX, destY);
+        if (isPromotionMove(srcX, srcY, destX, destY))
         {
-            if ((pieceToMove.color == Color::White && destY == 0) ||
-                (pieceToMove.color == Color::Black && destY == 7))
-            {
-                board[destY][destX] = pieceToMove;
-
-                promotePawnSDL(renderer, destX, destY, pieceToMove.color);
-                // Promotion_Sound.play(1);
-
-                board[srcY][srcX] = Piece(Troops::None, Color::None);
-                return true;
-            }
+            move.promotion = promotion == Troops::None ? Troops::Queen : promotion;
         }
+        position.makeMove(move);
 
-        board[destY][destX] = pieceToMove;
-        board[srcY][srcX] = Piece(Troops::None, Color::None);
-
-        std::pair<int, int> kingPosition = findKingPosition(pieceToMove.color);
+        std::pair<int, int> kingPosition = position.findKingPosition(pieceToMove.color);
 
-        if (IsKingCheck(kingPosition.first, kingPosition.second, pieceToMove.color))
+        if (position.IsKingCheck(kingPosition.first, kingPosition.second, pieceToMove.color))
         {
 
-            board[srcY][srcX] = pieceToMove;
-            board[destY][destX] = backUpPiece;
+            position.unmakeMove();
             return false;
         }
 
-        if (backUpPiece.TroopType != Troops::None)
+        Color opponent = Position::getOppositeColor(pieceToMove.color);
+        std::pair<int, int> opponentKing = position.findKingPosition(opponent);
+        if (position.IsKingCheck(opponentKing.first, opponentKing.second, opponent))
         {
-            // attack_Sound.play(1);
+            audio.post(SoundEvent::Check);
+        }
+        else if (move.promotion != Troops::None)
+        {
+            audio.post(SoundEvent::Promote);
+        }
+        else if (backUpPiece.TroopType != Troops::None)
+        {
+            audio.post(SoundEvent::Capture);
         }
         else
         {
-            // move_Sound.play(1);
+            audio.post(SoundEvent::Move);
         }
         lastMovedPiece = std::make_pair(destX, destY);
+        lastMove = move;
+        record.push(move, position);
         return true;
     }
 
-    std::pair<int, int> findKingPosition(Color kingColor)
+    // The board can be moved to any ply of the game. Moving stops the AI and the other
+    // searches; a move played before the end replaces the rest of the game.
+    int historyPly() const
     {
-        for (int x = 0; x < 8; x++)
-        {
-            for (int y = 0; y < 8; y++)
-            {
-                if (board[y][x].TroopType == Troops::King && board[y][x].color == kingColor)
-                {
-                    return {x, y};
-                }
-            }
-        }
-        return {-1, -1};
+        return record.ply();
     }
 
-    bool IsKingCheck(int kx, int ky, Color kingColor)
+    int historyLength() const
     {
-        if (kx < 0 || kx >= 8 || ky < 0 || ky >= 8)
-            return false;
-
-        for (int i = 0; i < 8; i++)
-        {
-            for (int j = 0; j < 8; j++)
-            {
-                Piece &piece = board[j][i];
-
-                if (piece.color != kingColor && piece.TroopType != Troops::None)
-                {
-                    std::vector<std::pair<int, int>> LegalMoves = getLegalMoves(piece, i, j);
-
-                    for (const auto &move : LegalMoves)
-                    {
-                        if (move.first == kx && move.second == ky)
-                        {
-                            // kingcheck_Sound.play(1);
-                            return true; // The King is in check
-                        }
-                    }
-                }
-            }
-        }
-        return false; // King is not in check
+        return record.length();
     }
 
-    std::vector<std::tuple<int, int, int, int>> generateAllMoves(Color aiColor)
+    Color sideToMove() const
     {
-        std::vector<std::tuple<int, int, int, int>> allMoves;
-
-        for (int y = 0; y < 8; y++)
-        {
-            for (int x = 0; x < 8; x++)
-            {
-                Piece piece = board[y][x];
-                if (piece.color == aiColor)
-                {
-                    std::vector<std::pair<int, int>> possiblemoves = getLegalMoves(piece, x, y);
-                    for (auto move : possiblemoves)
-                    {
-                        allMoves.push_back(std::make_tuple(x, y, move.first, move.second));
-                    }
-                }
-            }
-        }
-        return allMoves;
+        return record.sideToMoveAt(record.ply());
     }
 
-    int evaluateBoard(Color aiColor)
+    bool stepBack()
     {
-        int score = 0;
-        for (int y = 0; y < 8; y++)
+        if (record.ply() == 0)
         {
-            for (int x = 0; x < 8; x++)
-            {
-                Piece piece = board[y][x];
-                int pieceValue = getPieceValue(piece);
-                if (piece.color == aiColor)
-                {
-                    score += pieceValue;
-                }
-                else if (piece.color == getOppositeColor(aiColor))
-                {
-                    score -= pieceValue;
-                }
-            }
+            return false;
         }
-        return score;
+        stopAI();
+        record.stepBack(position);
+        syncLastMove();
+        return true;
     }
 
-    int getPieceValue(Piece piece)
+    bool stepForward()
     {
-        switch (piece.TroopType)
+        if (record.ply() == record.length())
         {
-        case Troops::Queen:
-            return 9;
-        case Troops::Rook:
-            return 5;
-        case Troops::Bishop:
-        case Troops::Knight:
-            return 3;
-        case Troops::Pawn:
-            return 1;
-        case Troops::King:
-            return 0;
-        default:
-            return 0;
+            return false;
         }
+        stopAI();
+        record.stepForward(position);
+        syncLastMove();
+        return true;
     }
 
-    Color getOppositeColor(Color color)
+    void seekHistory(int ply)
     {
-        return (color == Color::White) ? Color::Black : Color::White;
+        stopAI();
+        record.seek(ply, position);
+        syncLastMove();
     }
 
-    void undoMove(int srcX, int srcY, int destX, int destY, Piece capturePiece)
+    Uint32 getAIMoveEvent() const
     {
-        board[srcY][srcX] = board[destY][destX];
-        board[destY][destX] = capturePiece;
+        return aiMoveEvent;
     }
 
-    Piece movePieceWithCapture(int srcX, int srcY, int destX, int destY)
+    // Results from earlier sessions; without the file the AI simply searches every move
+    bool openLearningFile(const std::string &path)
     {
-        Piece capturedPiece = board[destY][destX];
-        board[destY][destX] = board[srcY][srcX];
-        board[srcY][srcX] = Piece(Troops::None, Color::None);
-        return capturedPiece;
+        return learning.Open(path);
     }
 
-    bool isgameOver(Color currentTurnColor)
+    size_t learnedPositions() const
     {
-        std::vector<std::tuple<int, int, int, int>> allMoves = generateAllMoves(currentTurnColor);
-
-        std::pair<int, int> kingPosition = findKingPosition(currentTurnColor);
-        int kx = kingPosition.first;
-        int ky = kingPosition.second;
+        return learning.count();
+    }
 
-        bool kingInCheck = IsKingCheck(kx, ky, currentTurnColor);
+    // Starts the AI's search in the background; the move is announced with aiMoveEvent and
+    // picked up with getAIMove(). If the engine was pondering on the move the human just
+    // played, that search simply carries on. A position the learning file has a result for,
+    // from a search at least as deep as this one would be, is answered without searching.
+    void makeAIMove(Color aiColor)
+    {
+        TRACE_ZONE("makeAIMove");
+        learnedMove = Move();
+        if (useMcts)
+        {
+            // Picks up the tree from the last move when the game went the way it expected
+            int generation = aiGeneration;
+            mcts.start(position, aiColor, mctsLimits, [this, generation](const SearchResult &)
+                       { notifyAIMove(generation); });
+            return;
+        }
+        if (engine.isPondering() && engine.pondered() == lastMove)
+        {
+            engine.ponderHit();
+            return;
+        }
 
-        if (allMoves.empty())
+        if (playLearnedMove(aiColor))
         {
-            return kingInCheck;
+            return;
         }
 
-        return false; // The game is not over
+        uint64_t key = position.hash() ^ Position::sideKey(aiColor);
+        int generation = aiGeneration;
+        engine.start(position, aiColor, aiLimits, [this, key, generation](const SearchResult &result)
+                     {
+                         learn(key, result);
+                         notifyAIMove(generation); });
     }
 
-    int minimax(int depth, bool isMaximizingPlayer, int alpha, int beta, Color aiColor)
+    // The search chose the promotion piece too, as part of the move
+    Move getAIMove()
     {
-        if (depth == 0 || isgameOver(aiColor))
+        if (!learnedMove.isNull())
         {
-            return evaluateBoard(aiColor);
+            return learnedMove;
         }
-        Color currentPlayerColor = isMaximizingPlayer ? aiColor : getOppositeColor(aiColor);
-        std::vector<std::tuple<int, int, int, int>> allMoves = generateLegalMoves(currentPlayerColor);
+        return (useMcts ? mcts.lastResult() : engine.lastResult()).bestMove;
+    }
 
-        if (isMaximizingPlayer)
+    // Called once the AI's move is on the board: keep searching on the human's time, assuming
+    // they answer with the reply the last search expected
+    void startPondering(Color aiColor)
+    {
+        if (useMcts || !learnedMove.isNull())
         {
-            int maxEval = std::numeric_limits<int>::min();
-            for (auto move : allMoves)
-            {
-                int srcX, srcY, destX, destY;
-                std::tie(srcX, srcY, destX, destY) = move;
-
-                Piece capturedPiece = movePieceWithCapture(srcX, srcY, destX, destY);
+            return; // a learned move comes without the reply to expect
+        }
+        Move expected = engine.lastResult().ponderMove;
+        if (expected.isNull())
+        {
+            return;
+        }
 
-                int eval = minimax(depth - 1, false, alpha, beta, aiColor);
+        // The guess can come from the hash table, so make sure it is a legal reply here
+        Color humanColor = Position::getOppositeColor(aiColor);
+        std::vector<Move> replies = position.generateLegalMoves(humanColor);
+        if (std::find(replies.begin(), replies.end(), expected) == replies.end())
+        {
+            return;
+        }
 
-                undoMove(srcX, srcY, destX, destY, capturedPiece);
+        Position afterReply = position;
+        afterReply.makeMove(expected);
+        uint64_t key = afterReply.hash() ^ Position::sideKey(aiColor);
+        int generation = aiGeneration;
+        engine.startPonder(afterReply, aiColor, expected, aiLimits, [this, key, generation](const SearchResult &result)
+                           {
+                               learn(key, result);
+                               notifyAIMove(generation); });
+    }
 
-                maxEval = std::max(maxEval, eval);
-                alpha = std::max(alpha, eval);
-                if (beta <= alpha)
-                {
-                    break;
-                }
-            }
-            return maxEval;
-        }
-        else
-        {
-            int minEval = std::numeric_limits<int>::max();
-            for (auto move : allMoves)
-            {
-                int srcX, srcY, destX, destY;
-                std::tie(srcX, srcY, destX, destY) = move;
+    void stopAI()
+    {
+        engine.stop();
+        analysis.stop();
+        mcts.stop();
+        stopMateSearch();
+        aiGeneration++;
+    }
 
-                Piece capturedPiece = movePieceWithCapture(srcX, srcY, destX, destY);
+    // False for an aiMoveEvent left in the queue by a search that has since been stopped
+    bool isCurrentAIMove(const SDL_Event &event) const
+    {
+        return event.user.code == aiGeneration;
+    }
 
-                int eval = minimax(depth - 1, true, alpha, beta, aiColor);
+    // Switches the AI between the alpha-beta engine and the tree search; only between moves
+    void setMctsEnabled(bool enabled)
+    {
+        engine.stop();
+        mcts.stop();
+        aiGeneration++;
+        useMcts = enabled;
+    }
 
-                undoMove(srcX, srcY, destX, destY, capturedPiece);
+    bool isMctsEnabled() const
+    {
+        return useMcts;
+    }
 
-                // Minimize the eval
-                minEval = std::min(minEval, eval);
-                beta = std::min(beta, eval);
-                if (beta <= alpha)
-                {
-                    break; // Alpha-beta pruning
-                }
-            }
-            return minEval;
-        }
+    Uint32 getAnalysisEvent() const
+    {
+        return analysisEvent;
     }
 
-    std::pair<std::pair<int, int>, std::pair<int, int>> makeAIMove(Color aiColor, int depth = 3)
+    // (Re)starts open-ended analysis of the current position; every completed iteration is
+    // announced with analysisEvent and can be read with getAnalysis()
+    void startAnalysis(Color sideToMove, int lineCount)
     {
-        int bestValue = std::numeric_limits<int>::min();
-        std::tuple<int, int, int, int> bestMove;
+        SearchLimits limits;
+        limits.depth = SearchLimits::Infinite;
+        limits.multiPV = lineCount;
 
-        std::vector<std::tuple<int, int, int, int>> allMoves = generateAllMoves(aiColor);
+        auto notify = [this](const SearchResult &)
+        { pushEvent(analysisEvent); };
+        analysis.start(position, sideToMove, limits, notify, notify);
+    }
 
-        for (auto move : allMoves)
-        {
-            int srcX, srcY, destX, destY;
-            std::tie(srcX, srcY, destX, destY) = move;
+    void stopAnalysis()
+    {
+        analysis.stop();
+    }
 
-            // Make the move on the board
-            Piece capturedPiece = movePieceWithCapture(srcX, srcY, destX, destY);
+    SearchResult getAnalysis()
+    {
+        return analysis.lastResult();
+    }
 
-            // Call minimax to evaluate the move
-            int moveValue = minimax(depth, false, -10000, 10000, aiColor); // Depth of 3
+    Uint32 getMateEvent() const
+    {
+        return mateEvent;
+    }
 
-            undoMove(srcX, srcY, destX, destY, capturedPiece);
+    // Looks for a forced mate by sideToMove in up to maxMoves moves; mateEvent is pushed once
+    // the answer is ready for getMateResult(). Starting again abandons the previous attempt.
+    void startMateSearch(Color sideToMove, int maxMoves)
+    {
+        stopMateSearch();
+        MateLimits limits;
+        limits.maxMoves = maxMoves;
+        limits.stopSignal = &mateStop;
+        Position root = position;
+        mateDone = false;
+        mateThread = std::thread([this, root, sideToMove, limits]()
+                                 {
+                                     Trace::setThreadName("mate");
+                                     mateResult = mateSolver.solve(root, sideToMove, limits);
+                                     mateDone = true;
+                                     pushEvent(mateEvent); });
+    }
 
-            // If this move is better, update the best move
-            if (moveValue > bestValue)
-            {
-                bestValue = moveValue;
-                bestMove = move;
-            }
+    void stopMateSearch()
+    {
+        if (mateThread.joinable())
+        {
+            mateStop = true;
+            mateThread.join();
+            mateStop = false;
         }
+    }
+
+    // False while a search is running, so an event left over from an abandoned one is ignored
+    bool mateSearchDone() const
+    {
+        return mateDone;
+    }
 
-        return {{std::get<0>(bestMove), std::get<1>(bestMove)}, {std::get<2>(bestMove), std::get<3>(bestMove)}};
+    MateResult getMateResult()
+    {
+        stopMateSearch(); // already finished when mateEvent arrives, so this only joins
+        return mateResult;
     }
 
-    std::vector<std::tuple<int, int, int, int>> generateLegalMoves(Color currentPlayerColor)
+    SearchStats engineStats() const
     {
-        std::vector<std::tuple<int, int, int, int>> allMoves = generateAllMoves(currentPlayerColor);
-        std::vector<std::tuple<int, int, int, int>> legalMoves;
+        return useMcts ? mcts.liveStats() : engine.liveStats();
+    }
 
-        std::pair<int, int> kingPosition = findKingPosition(currentPlayerColor); // You may have this logic in your code
+    SearchStats analysisStats() const
+    {
+        return analysis.liveStats();
+    }
 
-        for (auto move : allMoves)
-        {
-            int srcX, srcY, destX, destY;
-            std::tie(srcX, srcY, destX, destY) = move;
+private:
+    // Runs on the search threads; SDL_PushEvent is safe to call from there
+    void pushEvent(Uint32 type, int code = 0)
+    {
+        SDL_Event event = {};
+        event.type = type;
+        event.user.code = code;
+        SDL_PushEvent(&event);
+    }
 
-            Piece capturedPiece = movePieceWithCapture(srcX, srcY, destX, destY);
+    void notifyAIMove(int generation)
+    {
+        pushEvent(aiMoveEvent, generation);
+    }
 
-            std::pair<int, int> proposedKingPosition = (board[srcY][srcX].TroopType == Troops::King)
-                                                           ? std::make_pair(destX, destY)
-                                                           : kingPosition;
+    // The last-move highlight follows the ply on the board
+    void syncLastMove()
+    {
+        lastMove = record.ply() > 0 ? record.moveAt(record.ply() - 1) : Move();
+        lastMovedPiece = lastMove.isNull() ? std::make_pair(-1, -1) : std::make_pair(static_cast<int>(lastMove.destX), static_cast<int>(lastMove.destY));
+        deselectPiece();
+        clearHighlightedMoves();
+    }
 
-            if (!IsKingCheck(proposedKingPosition.first, proposedKingPosition.second, currentPlayerColor))
-            {
-                legalMoves.push_back(move);
-            }
+    // Runs on the search thread once a search finishes
+    void learn(uint64_t key, const SearchResult &result)
+    {
+        LearningEntry entry;
+        entry.move = result.bestMove;
+        entry.score = static_cast<int16_t>(result.score);
+        entry.depth = static_cast<int8_t>(std::min(result.depth, 127));
+        learning.store(key, entry);
+        learning.flush();
+    }
 
-            undoMove(srcX, srcY, destX, destY, capturedPiece);
+    // The stored result knew nothing of this game's history, so it is not trusted once the
+    // position has been seen before or the fifty-move rule is near
+    bool playLearnedMove(Color aiColor)
+    {
+        LearningEntry entry;
+        if (!learning.probe(position.hash() ^ Position::sideKey(aiColor), entry) || entry.depth < aiLimits.depth ||
+            position.repetitions() > 0 || position.getHalfmoveClock() >= 80)
+        {
+            return false;
         }
-        return legalMoves;
+        std::vector<Move> moves = position.generateLegalMoves(aiColor);
+        if (std::find(moves.begin(), moves.end(), entry.move) == moves.end())
+        {
+            return false;
+        }
+
+        engine.stop(); // it may still be pondering on a reply the human did not play
+        learnedMove = entry.move;
+        notifyAIMove(aiGeneration);
+        return true;
     }
 };
 
@@ -1122,6 +762,19 @@ void RenderText(SDL_Renderer *renderer, const std::string &message, int x, int y
 
 int main()
 {
+    // CHESS_TRACE=1 traces from startup (asset loading included); T toggles it while running.
+    // Either way the capture goes to chess_trace.json when tracing stops.
+    const std::string traceFile = "chess_trace.json";
+    Trace::setEnabled(std::getenv("CHESS_TRACE") != nullptr);
+    Trace::setThreadName("main");
+    // CHESS_TREE_DUMP=tree.bin records every engine search tree for tools/tree_stats
+    if (const char *treeDumpPath = std::getenv("CHESS_TREE_DUMP"))
+    {
+        if (!TreeDump::start(treeDumpPath))
+        {
+            std::cout << "Cannot create " << treeDumpPath << std::endl;
+        }
+    }
 
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
     {
@@ -1142,7 +795,7 @@ int main()
         return -1;
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (!renderer)
     {
         std::cout << "Renderer could not be created: " << SDL_GetError() << std::endl;
@@ -1160,41 +813,92 @@ int main()
         std::cout << "sdl autio no initialsed " << std::endl;
     }
 
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+    // A small mixer buffer keeps sounds in step with the moves; CHESS_AUDIO_BUFFER overrides it
+    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, audioBufferSize()) < 0)
     {
         std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << std::endl;
         SDL_Quit();
         return 1;
     }
 
-    TTF_Font *Start_Screen = TTF_OpenFont("Font/LIVINGBY.TTF", 200);
+    // All assets come from one mmapped bundle next to the executable (see build.txt)
+    AssetBundle assets;
+    if (!assets.Open(DefaultBundlePath()))
+    {
+        std::cout << "Run the pack step from build.txt to create assets.pak" << std::endl;
+        return -1;
+    }
+
+    std::vector<std::string> imageFiles = pieceTextureFiles;
+    imageFiles.push_back("images/start_Screen.bmp");
+    imageFiles.push_back("images/GameOver_Screen.bmp");
+
+    const std::vector<std::string> soundFiles = {
+        "Sound/move-self.wav", "Sound/capture.wav", "Sound/game-end.wav",
+        "Sound/move-check.wav", "Sound/game-start.wav", "Sound/capture.wav"};
+
+    // Decode on worker threads, then upload to the GPU here on the render thread
+    std::vector<SDL_Surface *> surfaces;
+    std::vector<Mix_Chunk *> chunks;
+    assets.DecodeParallel(imageFiles, surfaces, soundFiles, chunks);
+
+    move_Sound.Load(chunks[0]);
+    attack_Sound.Load(chunks[1]);
+    checkmate_Sound.Load(chunks[2]);
+    kingcheck_Sound.Load(chunks[3]);
+    gamestart_Sound.Load(chunks[4]);
+    Promotion_Sound.Load(chunks[5]);
+
+    audio.setSound(SoundEvent::Move, &move_Sound);
+    audio.setSound(SoundEvent::Capture, &attack_Sound);
+    audio.setSound(SoundEvent::Promote, &Promotion_Sound);
+    audio.setSound(SoundEvent::Check, &kingcheck_Sound);
+    audio.setSound(SoundEvent::GameStart, &gamestart_Sound);
+    audio.setSound(SoundEvent::GameEnd, &checkmate_Sound);
+    audio.start();
+
+    TTF_Font *Start_Screen = TTF_OpenFontRW(assets.OpenRW("Font/LIVINGBY.TTF"), 1, 200);
     if (Start_Screen == nullptr)
     {
         std::cout << "Failed to load font: " << TTF_GetError() << std::endl;
     }
 
-    TTF_Font *Over_Screen = TTF_OpenFont("Font/LIVINGBY.TTF", 200);
+    TTF_Font *Over_Screen = TTF_OpenFontRW(assets.OpenRW("Font/LIVINGBY.TTF"), 1, 200);
     if (Over_Screen == nullptr)
     {
         std::cout << "Failed to load font: " << TTF_GetError() << std::endl;
     }
 
-    move_Sound.Load("Sound/move-self.wav");
-    attack_Sound.Load("Sound/capture.wav");
-    checkmate_Sound.Load("Sound/game-end.wav");
-    kingcheck_Sound.Load("Sound/move-check.wav");
-    gamestart_Sound.Load("Sound/game-start.wav");
-    Promotion_Sound.Load("Sound/capture.wav");
+    TTF_Font *Overlay_Font = TTF_OpenFontRW(assets.OpenRW("Font/LIVINGBY.TTF"), 1, 22);
+    if (Overlay_Font == nullptr)
+    {
+        std::cout << "Failed to load font: " << TTF_GetError() << std::endl;
+    }
 
-    SDL_Surface *startscreen = SDL_LoadBMP("images/start_Screen.bmp");
+    SDL_Surface *startscreen = surfaces[pieceTextureFiles.size()];
     SDL_Texture *start_texture = SDL_CreateTextureFromSurface(renderer, startscreen);
-    SDL_FreeSurface(startscreen);
 
-    SDL_Surface *GameOver_surface = SDL_LoadBMP("images/GameOver_Screen.bmp");
+    SDL_Surface *GameOver_surface = surfaces[pieceTextureFiles.size() + 1];
     SDL_Texture *GameOver_texture = SDL_CreateTextureFromSurface(renderer, GameOver_surface);
-    SDL_FreeSurface(GameOver_surface);
 
-    ChessBoard chessboard(renderer);
+    // The engine evaluates with nnue.bin next to the executable when present, otherwise with the
+    // material and piece-square tables, tuned ones from eval.params if tools/texel_tune.cpp wrote one
+    if (loadEvalParams(ExecutableDirectory() + "eval.params"))
+    {
+        std::cout << "Loaded tuned evaluation tables" << std::endl;
+    }
+    if (Nnue::load(ExecutableDirectory() + "nnue.bin"))
+    {
+        std::cout << "Loaded NNUE evaluation (" << Nnue::kernelName() << ")" << std::endl;
+    }
+
+    ChessBoard chessboard(renderer, surfaces);
+
+    for (auto surface : surfaces)
+    {
+        SDL_FreeSurface(surface);
+    }
+
     Color currentPlayerColor = Color::White;
     Piece *selectedPiece = nullptr;
     chessboard.printBoard();
@@ -1205,23 +909,395 @@ int main()
     Color aiColor = Color::Black;
 
     bool IsGameRunning = true;
+    bool needsRedraw = true;     // set whenever something visible changed since the last present
+    bool aiTurnPending = false;  // the AI is searching for its move in the background
+    Uint32 aiMoveEvent = chessboard.getAIMoveEvent();
+
+    // 'A' toggles live analysis of the side to move's best candidate lines
+    const int analysisLines = 3;
+    bool analysisEnabled = false;
+    Uint32 analysisEvent = chessboard.getAnalysisEvent();
+    AnalysisOverlay analysisOverlay(renderer, Overlay_Font);
+
+    // 'E' toggles the opening explorer panel, fed from explorer.idx next to the executable
+    // (built from PGN archives with tools/pgn_index.cpp)
+    OpeningExplorer explorer;
+    explorer.Open(ExecutableDirectory() + "explorer.idx");
+    bool explorerEnabled = false;
+    AnalysisOverlay explorerOverlay(renderer, Overlay_Font, 10, 520);
+
+    // The AI's search results are kept across sessions in learning.bin next to the executable
+    if (chessboard.openLearningFile(ExecutableDirectory() + "learning.bin"))
+    {
+        std::cout << "Learning file holds " << chessboard.learnedPositions() << " positions" << std::endl;
+    }
+
+    // 'M' asks the mate solver whether the side to move can force mate; the answer stays up
+    // until the next move
+    const int mateMoves = 12;
+    bool mateShown = false;
+    Uint32 mateEvent = chessboard.getMateEvent();
+    AnalysisOverlay mateOverlay(renderer, Overlay_Font, 10, 440);
+
+    // 'P' switches the AI player between alpha-beta and Monte Carlo tree search; CHESS_ENGINE=mcts
+    // starts with the tree search
+    const char *engineChoice = std::getenv("CHESS_ENGINE");
+    chessboard.setMctsEnabled(engineChoice && std::string(engineChoice) == "mcts");
+
+    // 'H' toggles the performance HUD; frames are recorded even while it is hidden
+    bool hudEnabled = false;
+    PerfHud perfHud(renderer, Overlay_Font, 400, 10);
+    double presentMs = 0;
+
+    auto refreshExplorer = [&]()
+    {
+        std::vector<std::string> lines;
+        if (!explorer.isOpen())
+        {
+            lines.push_back("No explorer.idx found");
+        }
+        else
+        {
+            std::vector<ExplorerMove> moves = explorer.lookup(chessboard.positionKey(currentPlayerColor));
+            lines.push_back(moves.empty() ? "Explorer: position not in the book" : "Explorer");
+            for (size_t i = 0; i < moves.size() && i < 5; i++)
+            {
+                const ExplorerMove &move = moves[i];
+                uint32_t games = move.games();
+                lines.push_back(moveToString(move.move) + "  " + std::to_string(games) + " games  W " +
+                                std::to_string(move.whiteWins * 100 / games) + "%  D " + std::to_string(move.draws * 100 / games) +
+                                "%  B " + std::to_string(move.blackWins * 100 / games) + "%");
+            }
+        }
+        explorerOverlay.setLines(lines);
+    };
+
+    // Check whether the game ended for the side to move and bring the overlays up to date
+    auto enterPosition = [&]()
+    {
+        if (mateShown)
+        {
+            chessboard.stopMateSearch();
+            mateOverlay.clear();
+            mateShown = false;
+        }
+
+        switch (chessboard.gameStatus(currentPlayerColor))
+        {
+        case GameStatus::Checkmate:
+            std::cout << "Checkmate!! " << ((currentPlayerColor == Color::White) ? "Black" : "White") << " wins!" << std::endl;
+            isCheckmate = true;
+            winner = (currentPlayerColor == Color::White) ? "Black" : "White";
+            gamestate = GAMEOVER;
+            break;
+        case GameStatus::Stalemate:
+            std::cout << "Stalemate! It's a draw." << std::endl;
+            isStalemate = true;
+            gamestate = GAMEOVER;
+            break;
+        case GameStatus::ThreefoldRepetition:
+            std::cout << "Threefold repetition! It's a draw." << std::endl;
+            gamestate = GAMEOVER;
+            break;
+        case GameStatus::FiftyMoveRule:
+            std::cout << "Fifty moves without a capture or pawn move! It's a draw." << std::endl;
+            gamestate = GAMEOVER;
+            break;
+        case GameStatus::InsufficientMaterial:
+            std::cout << "Insufficient material! It's a draw." << std::endl;
+            gamestate = GAMEOVER;
+            break;
+        case GameStatus::Ongoing:
+            break;
+        }
+
+        if (gamestate == GAMEOVER)
+        {
+            chessboard.stopAI(); // don't leave a ponder or analysis search running
+            audio.post(SoundEvent::GameEnd);
+        }
+        else if (analysisEnabled)
+        {
+            analysisOverlay.clear();
+            chessboard.startAnalysis(currentPlayerColor, analysisLines);
+        }
+
+        if (explorerEnabled)
+        {
+            refreshExplorer();
+        }
+    };
+
+    // Flip the side to move and check whether the game ended for the side now to move
+    auto finishTurn = [&]()
+    {
+        TRACE_ZONE("finishTurn");
+        currentPlayerColor = (currentPlayerColor == Color::Black) ? Color::White : Color::Black;
+        enterPosition();
+    };
+
+    // Backspace takes back to the human's previous turn, Left/Right step one ply, Home/End jump
+    // to either end and R replays the game from the start, faster with + and slower with -.
+    // The AI only picks the game up again at its end, on its turn.
+    bool replaying = false;
+    int replayDelayMs = 400;
+    auto nextReplayStep = std::chrono::steady_clock::now();
+    auto showHistoryPly = [&]()
+    {
+        aiTurnPending = false;
+        isCheckmate = false;
+        isStalemate = false;
+        gamestate = PLAYING;
+        currentPlayerColor = chessboard.sideToMove();
+        enterPosition();
+
+        if (gamestate == PLAYING && currentPlayerColor == aiColor && chessboard.historyPly() == chessboard.historyLength())
+        {
+            std::cout << "AI is thinking..." << std::endl;
+            chessboard.makeAIMove(aiColor);
+            aiTurnPending = true;
+        }
+        needsRedraw = true;
+    };
+
+    // The human's move, promotion piece included, then the AI's turn
+    Move pendingPromotion;
+    auto playHumanMove = [&](const Move &move)
+    {
+        if (!chessboard.movePiece(move.srcX, move.srcY, move.destX, move.destY, move.promotion))
+        {
+            return;
+        }
+        chessboard.clearHighlightedMoves();
+        finishTurn();
+
+        // After player's move, it's AI's turn
+        if (gamestate == PLAYING && currentPlayerColor == aiColor)
+        {
+            std::cout << "AI is thinking..." << std::endl;
+            chessboard.makeAIMove(aiColor);
+            aiTurnPending = true;
+        }
+    };
+
+    // Draws the HUD over whatever the game state rendered, then presents. With vsync the
+    // present is where the frame waits for the display.
+    auto present = [&]()
+    {
+        if (hudEnabled)
+        {
+            TRACE_ZONE("PerfHud::render");
+            perfHud.render(chessboard.engineStats(), chessboard.analysisStats());
+        }
+
+        TRACE_ZONE("SDL_RenderPresent");
+        auto presentStart = std::chrono::steady_clock::now();
+        SDL_RenderPresent(renderer);
+        presentMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - presentStart).count();
+    };
 
     while (IsGameRunning)
     {
         SDL_Event event;
-        while (SDL_PollEvent(&event))
+
+        // Sleep until an event arrives instead of spinning; the timeout only bounds how long a
+        // missed expose could leave the window stale. The AI's move arrives as an event too.
+        // With the HUD up, wake often enough to keep its numbers current.
+        int waitMs = hudEnabled ? PerfHud::RefreshMs : 500;
+        if (replaying)
+        {
+            auto untilStep = std::chrono::duration_cast<std::chrono::milliseconds>(nextReplayStep - std::chrono::steady_clock::now()).count();
+            waitMs = std::max(0, std::min(waitMs, static_cast<int>(untilStep)));
+        }
+        bool hasEvent = SDL_WaitEventTimeout(&event, waitMs) != 0;
+        auto frameStart = std::chrono::steady_clock::now();
+        TRACE_ZONE("frame");
+
+        while (hasEvent)
         {
+            TRACE_ZONE("handleEvent");
+
             if (event.type == SDL_QUIT)
             {
                 IsGameRunning = false;
             }
 
+            if (event.type == SDL_WINDOWEVENT)
+            {
+                needsRedraw = true;
+            }
+
+            if (event.type == aiMoveEvent && aiTurnPending && gamestate == PLAYING && chessboard.isCurrentAIMove(event))
+            {
+                Move aiMove = chessboard.getAIMove();
+                if (chessboard.movePiece(aiMove.srcX, aiMove.srcY, aiMove.destX, aiMove.destY, aiMove.promotion))
+                {
+                    finishTurn();
+                }
+                aiTurnPending = false;
+                needsRedraw = true;
+
+                // Keep thinking on the human's time
+                if (gamestate == PLAYING)
+                {
+                    chessboard.startPondering(aiColor);
+                }
+            }
+
+            if (event.type == analysisEvent && analysisEnabled)
+            {
+                SearchResult analysis = chessboard.getAnalysis();
+                if (analysis.depth > 0)
+                {
+                    analysisOverlay.update(analysis, currentPlayerColor);
+                    needsRedraw = true;
+                }
+            }
+
+            if (event.type == mateEvent && mateShown && chessboard.mateSearchDone())
+            {
+                MateResult mate = chessboard.getMateResult();
+                std::vector<std::string> lines;
+                if (mate.outcome == MateResult::Mate)
+                {
+                    std::string line;
+                    for (const Move &move : mate.line)
+                    {
+                        line += (line.empty() ? "" : " ") + moveToString(move);
+                    }
+                    lines.push_back("Mate in " + std::to_string(mate.mateIn) + " (" + std::to_string(mate.nodes) + " nodes)");
+                    lines.push_back(line);
+                }
+                else if (mate.outcome == MateResult::NoMate)
+                {
+                    lines.push_back("No mate in " + std::to_string(mateMoves) + " moves");
+                }
+                else
+                {
+                    lines.push_back("No mate in " + std::to_string(mate.decidedMoves) + " moves, stopped");
+                }
+                mateOverlay.setLines(lines);
+                needsRedraw = true;
+            }
+
+            if (gamestate == PLAYING && !aiTurnPending && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_m)
+            {
+                mateShown = true;
+                mateOverlay.setLines({"Looking for mate in up to " + std::to_string(mateMoves) + " moves..."});
+                chessboard.startMateSearch(currentPlayerColor, mateMoves);
+                needsRedraw = true;
+            }
+
+            if (gamestate == PLAYING && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_a)
+            {
+                analysisEnabled = !analysisEnabled;
+                analysisOverlay.clear();
+                if (analysisEnabled)
+                {
+                    chessboard.startAnalysis(currentPlayerColor, analysisLines);
+                }
+                else
+                {
+                    chessboard.stopAnalysis();
+                }
+                needsRedraw = true;
+            }
+
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_t)
+            {
+                if (Trace::isEnabled())
+                {
+                    Trace::setEnabled(false);
+                    if (Trace::writeChromeJson(traceFile))
+                    {
+                        std::cout << "Trace written to " << traceFile << std::endl;
+                    }
+                }
+                else
+                {
+                    Trace::clear();
+                    Trace::setEnabled(true);
+                    std::cout << "Tracing, press T again to save" << std::endl;
+                }
+            }
+
+            if (!aiTurnPending && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p)
+            {
+                chessboard.setMctsEnabled(!chessboard.isMctsEnabled());
+                std::cout << "AI player: " << (chessboard.isMctsEnabled() ? "Monte Carlo tree search" : "alpha-beta") << std::endl;
+            }
+
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_h)
+            {
+                hudEnabled = !hudEnabled;
+                needsRedraw = true;
+            }
+
+            if (gamestate == PLAYING && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_e)
+            {
+                explorerEnabled = !explorerEnabled;
+                if (explorerEnabled)
+                {
+                    refreshExplorer();
+                }
+                needsRedraw = true;
+            }
+
+            if ((gamestate == PLAYING || gamestate == GAMEOVER) && event.type == SDL_KEYDOWN)
+            {
+                SDL_Keycode key = event.key.keysym.sym;
+                bool moved = false;
+                if (key == SDLK_BACKSPACE)
+                {
+                    replaying = false;
+                    moved = chessboard.stepBack();
+                    if (moved && chessboard.sideToMove() == aiColor)
+                    {
+                        chessboard.stepBack();
+                    }
+                }
+                else if (key == SDLK_LEFT)
+                {
+                    replaying = false;
+                    moved = chessboard.stepBack();
+                }
+                else if (key == SDLK_RIGHT)
+                {
+                    replaying = false;
+                    moved = chessboard.stepForward();
+                }
+                else if (key == SDLK_HOME || key == SDLK_END)
+                {
+                    replaying = false;
+                    chessboard.seekHistory(key == SDLK_HOME ? 0 : chessboard.historyLength());
+                    moved = true;
+                }
+                else if (key == SDLK_r && chessboard.historyLength() > 0)
+                {
+                    replaying = true;
+                    chessboard.seekHistory(0);
+                    nextReplayStep = std::chrono::steady_clock::now() + std::chrono::milliseconds(replayDelayMs);
+                    moved = true;
+                }
+                else if (key == SDLK_EQUALS || key == SDLK_PLUS || key == SDLK_MINUS)
+                {
+                    replayDelayMs = key == SDLK_MINUS ? std::min(replayDelayMs * 2, 3200) : std::max(replayDelayMs / 2, 25);
+                    std::cout << "Replay: " << replayDelayMs << " ms per move" << std::endl;
+                }
+
+                if (moved)
+                {
+                    showHistoryPly();
+                }
+            }
+
             if (gamestate == STARTINGSCREEN)
             {
                 if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_RETURN)
                 {
-                    // gamestart_Sound.play(1);
+                    audio.post(SoundEvent::GameStart);
                     gamestate = PLAYING;
+                    needsRedraw = true;
                 }
             }
 
@@ -1233,158 +1309,162 @@ int main()
                 }
             }
 
-            if (gamestate == PLAYING)
+            if (gamestate == PROMOTING)
             {
                 if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT)
                 {
+                    Troops choice = ChessBoard::promotionChoiceAt(event.button.x, event.button.y);
+                    if (choice != Troops::None)
+                    {
+                        gamestate = PLAYING;
+                        pendingPromotion.promotion = choice;
+                        playHumanMove(pendingPromotion);
+                        needsRedraw = true;
+                    }
+                }
+                else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)
+                {
+                    gamestate = PLAYING; // take the pawn back and choose another move
+                    needsRedraw = true;
+                }
+            }
+            else if (gamestate == PLAYING && !aiTurnPending)
+            {
+                if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT)
+                {
+                    replaying = false; // playing a move from here takes over
                     int mouseX, mouseY;
                     SDL_GetMouseState(&mouseX, &mouseY);
                     int boardX = mouseX / 90; // Get the column
                     int boardY = mouseY / 90; // Get the row
 
-                    Piece &target_PieceAt = chessboard.get_PieceAt(boardX, boardY);
-
                     if (chessboard.isPieceSelected()) // If a piece is already selected
                     {
                         std::pair<int, int> selectedPiece = chessboard.getSelectedPiece();
 
                         if (chessboard.isLegalMove(boardX, boardY))
                         {
-                            bool moveSuccess = chessboard.movePiece(selectedPiece.first, selectedPiece.second, boardX, boardY);
-
-                            if (moveSuccess)
+                            if (chessboard.isPromotionMove(selectedPiece.first, selectedPiece.second, boardX, boardY))
                             {
-                                currentPlayerColor = (currentPlayerColor == Color::Black) ? Color::White : Color::Black;
-
-                                chessboard.clearHighlightedMoves();
-
-                                if (chessboard.isCheckMate(currentPlayerColor))
-                                {
-                                    std::cout << "Checkmate!! " << ((currentPlayerColor == Color::White) ? "Black" : "White") << " wins!" << std::endl;
-                                    isCheckmate = true;
-                                    winner = (currentPlayerColor == Color::White) ? "Black" : "White";
-                                    // checkmate_Sound.play(1);
-                                    gamestate = GAMEOVER;
-                                    SDL_Delay(35);
-                                }
-                                else if (chessboard.isStaleMate(currentPlayerColor))
-                                {
-                                    std::cout << "Stalemate! It's a draw." << std::endl;
-                                    isStalemate = true;
-                                    // checkmate_Sound.play(1);
-                                    gamestate = GAMEOVER;
-                                    SDL_Delay(35);
-                                }
-                                else
-                                {
-                                    chessboard.render(renderer);
-                                    SDL_RenderPresent(renderer);
-
-                                    // Delay to simulate AI thinking time
-                                    SDL_Delay(1000); // Adjust delay as needed
-
-                                    // After player's move, it's AI's turn
-                                    if (currentPlayerColor == aiColor)
-                                    {
-                                        std::cout << "AI is thinking..." << std::endl;
-                                        std::pair<int, int> aiMoveFrom, aiMoveTo;
-                                        std::tie(aiMoveFrom, aiMoveTo) = chessboard.makeAIMove(aiColor);
-
-                                        bool aiMoveSuccess = chessboard.movePiece(aiMoveFrom.first, aiMoveFrom.second, aiMoveTo.first, aiMoveTo.second);
-
-                                        if (aiMoveSuccess)
-                                        {
-                                            currentPlayerColor = (currentPlayerColor == Color::Black) ? Color::White : Color::Black;
-
-                                            // Check if AI move leads to game over
-                                            if (chessboard.isCheckMate(currentPlayerColor))
-                                            {
-                                                std::cout << "Checkmate!! " << ((currentPlayerColor == Color::White) ? "Black" : "White") << " wins!" << std::endl;
-                                                isCheckmate = true;
-                                                winner = (currentPlayerColor == Color::White) ? "Black" : "White";
-                                                // checkmate_Sound.play(1);
-                                                gamestate = GAMEOVER;
-                                                SDL_Delay(35);
-                                            }
-                                            else if (chessboard.isStaleMate(currentPlayerColor))
-                                            {
-                                                std::cout << "Stalemate! It's a draw." << std::endl;
-                                                isStalemate = true;
-                                                // checkmate_Sound.play(1);
-                                                gamestate = GAMEOVER;
-                                                SDL_Delay(35);
-                                            }
-
-                                            // Render the updated board after AI move
-                                            chessboard.render(renderer);
-                                            SDL_RenderPresent(renderer);
-                                        }
-                                    }
-                                }
-
-                                chessboard.deselectPiece();
+                                // The move waits for the piece choice, made in the PROMOTING state
+                                pendingPromotion = Move(selectedPiece.first, selectedPiece.second, boardX, boardY);
+                                gamestate = PROMOTING;
                             }
                             else
                             {
-                                chessboard.deselectPiece();
+                                playHumanMove(Move(selectedPiece.first, selectedPiece.second, boardX, boardY));
                             }
                         }
-                        else
-                        {
-                            chessboard.deselectPiece();
-                        }
+                        chessboard.deselectPiece();
                     }
                     else
                     {
-                        Piece &piece = chessboard.get_PieceAt(boardX, boardY);
+                        const Piece &piece = chessboard.get_PieceAt(boardX, boardY);
 
                         if (piece.TroopType != Troops::None && piece.color == currentPlayerColor)
                         {
                             chessboard.selectPiece(boardX, boardY);
                         }
                     }
+                    needsRedraw = true;
                 }
             }
+
+            hasEvent = SDL_PollEvent(&event) != 0;
         }
 
-        // Game Rendering based on Game State
-        switch (gamestate)
-        {
-        case GameState::STARTINGSCREEN:
+        if (replaying && std::chrono::steady_clock::now() >= nextReplayStep)
         {
-            SDL_RenderClear(renderer);
-            SDL_Rect rect = {0, 0, 720, 720};
-            SDL_RenderCopy(renderer, start_texture, nullptr, &rect);
-            RenderText(renderer, "Chess!!", 50, 50, Start_Screen);
-            SDL_RenderPresent(renderer);
-            break;
+            replaying = chessboard.stepForward() && chessboard.historyPly() < chessboard.historyLength();
+            showHistoryPly();
+            nextReplayStep += std::chrono::milliseconds(replayDelayMs);
         }
-        case GameState::PLAYING:
+
+        if (hudEnabled && perfHud.isStale())
         {
-            SDL_RenderClear(renderer);
-            chessboard.render(renderer);
-            SDL_RenderPresent(renderer);
-            break;
+            needsRedraw = true;
         }
-        case GameState::GAMEOVER:
+
+        // Game Rendering based on Game State, only when something changed. Frame pacing comes
+        // from the vsync'd present rather than a fixed delay.
+        if (needsRedraw)
         {
-            SDL_RenderClear(renderer);
-            SDL_Rect rect = {0, 0, 720, 720};
-            SDL_RenderCopy(renderer, GameOver_texture, nullptr, &rect);
-            RenderText(renderer, winner, 50, 50, Over_Screen);
-            RenderText(renderer, "Wins!!", 100, 250, Over_Screen);
-            SDL_RenderPresent(renderer);
-            break;
-        }
+            TRACE_ZONE("render");
+            switch (gamestate)
+            {
+            case GameState::STARTINGSCREEN:
+            {
+                SDL_RenderClear(renderer);
+                SDL_Rect rect = {0, 0, 720, 720};
+                SDL_RenderCopy(renderer, start_texture, nullptr, &rect);
+                RenderText(renderer, "Chess!!", 50, 50, Start_Screen);
+                present();
+                break;
+            }
+            case GameState::PLAYING:
+            {
+                SDL_RenderClear(renderer);
+                chessboard.render(renderer);
+                if (analysisEnabled)
+                {
+                    analysisOverlay.render();
+                }
+                if (explorerEnabled)
+                {
+                    explorerOverlay.render();
+                }
+                if (mateShown)
+                {
+                    mateOverlay.render();
+                }
+                present();
+                break;
+            }
+            case GameState::PROMOTING:
+            {
+                SDL_RenderClear(renderer);
+                chessboard.render(renderer);
+                chessboard.renderPromotionChoice(renderer, currentPlayerColor);
+                present();
+                break;
+            }
+            case GameState::GAMEOVER:
+            {
+                SDL_RenderClear(renderer);
+                SDL_Rect rect = {0, 0, 720, 720};
+                SDL_RenderCopy(renderer, GameOver_texture, nullptr, &rect);
+                if (isCheckmate)
+                {
+                    RenderText(renderer, winner, 50, 50, Over_Screen);
+                    RenderText(renderer, "Wins!!", 100, 250, Over_Screen);
+                }
+                else
+                {
+                    RenderText(renderer, "Draw!!", 50, 50, Over_Screen);
+                }
+                present();
+                break;
+            }
+            }
+            needsRedraw = false;
+            perfHud.addFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count(), presentMs);
         }
-
-        SDL_Delay(16);
     }
 
+    chessboard.stopAI();
+    TreeDump::stop();
+    if (Trace::isEnabled() && Trace::writeChromeJson(traceFile))
+    {
+        std::cout << "Trace written to " << traceFile << std::endl;
+    }
+    analysisOverlay.clear();
+    explorerOverlay.clear();
+    mateOverlay.clear();
     SDL_DestroyTexture(GameOver_texture);
     SDL_DestroyTexture(start_texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
+    audio.stop();
     SDL_Quit();
 
     return 0;
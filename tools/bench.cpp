@@ -0,0 +1,348 @@
+// Reproducible engine benchmarks, one JSON object per line so results can be diffed and
+// tracked commit by commit.
+//
+//   ./bench                  search bench followed by the microbenchmarks
+//   ./bench search --depth 7 only the search bench; its node count is the signature
+//   ./bench micro            only the microbenchmarks
+//   ./bench search --tree-dump tree.bin
+//                            also records the search trees for tools/tree_stats
+//   ./bench perft            move generation against the known perft counts of the first
+//                            positions; fails on a wrong count
+//   ./bench mcts --threads 64 --movetime 1000
+//                            Monte Carlo tree search playouts per second on one thread and on
+//                            --threads threads, and how much of the tree survives two moves
+//
+// The search bench clears the hash table before every position and searches to a fixed depth
+// with no time limit on one thread, so the node count only changes when the search or the
+// evaluation does. A loaded eval.params or nnue.bin would change it, so neither is read here.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../AttackMaps.hpp"
+#include "../Mcts.hpp"
+#include "../Position.hpp"
+#include "../Search.hpp"
+#include "../TreeDump.hpp"
+
+namespace
+{
+    const char *const BenchPositions[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+        "rnbqkb1r/pp1p1ppp/4pn2/2p5/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 0 4",
+        "r1bq1rk1/pp2ppbp/2np1np1/8/3NP3/2N1BP2/PPPQ2PP/R3KB1R w KQ - 3 9",
+        "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 50",
+        "8/pp3k2/2p1p1p1/3n4/3P4/2P1KN2/PP4PP/8 w - - 0 30",
+        "r1b2rk1/2q1bppp/p2p1n2/np2p3/3PP3/5N1P/PPBN1PP1/R1BQR1K1 w - - 0 13",
+    };
+
+    // Leaf counts of the standard perft positions, the first five bench positions
+    struct PerftCase
+    {
+        int depth;
+        uint64_t nodes;
+    };
+    const PerftCase PerftCases[] = {{5, 4865609}, {4, 4085603}, {5, 674624}, {4, 422333}, {4, 2103487}};
+
+    struct BenchPosition
+    {
+        Position position;
+        Color sideToMove;
+    };
+
+    std::vector<BenchPosition> loadPositions()
+    {
+        std::vector<BenchPosition> positions;
+        for (const char *fen : BenchPositions)
+        {
+            BenchPosition entry;
+            if (!entry.position.setFromFen(fen, entry.sideToMove))
+            {
+                std::fprintf(stderr, "bad bench FEN: %s\n", fen);
+                std::exit(1);
+            }
+            positions.push_back(entry);
+        }
+        return positions;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void runSearchBench(const std::vector<BenchPosition> &positions, int depth, int hashMegabytes)
+    {
+        Search search(hashMegabytes);
+        SearchLimits limits;
+        limits.depth = depth;
+
+        uint64_t nodes = 0;
+        double seconds = 0;
+        for (const auto &entry : positions)
+        {
+            search.clear();
+            std::promise<SearchResult> done;
+            auto start = std::chrono::steady_clock::now();
+            search.start(entry.position, entry.sideToMove, limits, [&done](const SearchResult &result)
+                         { done.set_value(result); });
+            SearchResult result = done.get_future().get();
+            seconds += secondsSince(start);
+            nodes += result.nodes;
+
+            std::printf("{\"bench\":\"search-position\",\"fen\":\"%s\",\"depth\":%d,\"bestmove\":\"%s\",\"score\":%d,\"nodes\":%llu}\n",
+                        BenchPositions[&entry - positions.data()], result.depth, moveToString(result.bestMove).c_str(), result.score,
+                        static_cast<unsigned long long>(result.nodes));
+        }
+        search.stop();
+
+        std::printf("{\"bench\":\"search\",\"positions\":%zu,\"depth\":%d,\"signature\":%llu,\"seconds\":%.3f,\"nps\":%.0f}\n",
+                    positions.size(), depth, static_cast<unsigned long long>(nodes), seconds, nodes / seconds);
+    }
+
+    bool runPerftBench(std::vector<BenchPosition> positions)
+    {
+        uint64_t nodes = 0;
+        double seconds = 0;
+        bool ok = true;
+        for (size_t i = 0; i < sizeof(PerftCases) / sizeof(PerftCases[0]); i++)
+        {
+            const PerftCase &expected = PerftCases[i];
+            auto start = std::chrono::steady_clock::now();
+            uint64_t count = positions[i].position.perft(positions[i].sideToMove, expected.depth);
+            seconds += secondsSince(start);
+            nodes += count;
+            ok = ok && count == expected.nodes;
+
+            std::printf("{\"bench\":\"perft-position\",\"fen\":\"%s\",\"depth\":%d,\"nodes\":%llu,\"expected\":%llu,\"ok\":%s}\n",
+                        BenchPositions[i], expected.depth, static_cast<unsigned long long>(count),
+                        static_cast<unsigned long long>(expected.nodes), count == expected.nodes ? "true" : "false");
+        }
+        std::printf("{\"bench\":\"perft\",\"nodes\":%llu,\"seconds\":%.3f,\"nps\":%.0f,\"ok\":%s}\n",
+                    static_cast<unsigned long long>(nodes), seconds, nodes / seconds, ok ? "true" : "false");
+        return ok;
+    }
+
+    // Timed rather than fixed like the search bench, so the numbers vary from run to run
+    void runMctsBench(const std::vector<BenchPosition> &positions, int threads, int moveTimeMs)
+    {
+        Mcts mcts(256);
+        MctsLimits limits;
+        limits.moveTimeMs = moveTimeMs;
+
+        double singleRate = 0;
+        for (int threadCount : {1, threads})
+        {
+            limits.threads = threadCount;
+            uint64_t playouts = 0;
+            uint64_t reused = 0;
+            double seconds = 0;
+            for (const auto &entry : positions)
+            {
+                mcts.clear();
+                auto start = std::chrono::steady_clock::now();
+                SearchResult result = mcts.run(entry.position, entry.sideToMove, limits);
+                seconds += secondsSince(start);
+                playouts += result.nodes;
+
+                // Play the expected line and search again: what the tree already knows is kept
+                if (!result.ponderMove.isNull())
+                {
+                    Position next = entry.position;
+                    next.makeMove(result.bestMove);
+                    next.makeMove(result.ponderMove);
+                    mcts.run(next, entry.sideToMove, limits);
+                    reused += mcts.reusedPlayouts();
+                }
+            }
+            double rate = playouts / seconds;
+            if (threadCount == 1)
+            {
+                singleRate = rate;
+            }
+            std::printf("{\"bench\":\"mcts\",\"threads\":%d,\"positions\":%zu,\"playouts\":%llu,\"seconds\":%.3f,\"playouts_per_second\":%.0f,\"speedup\":%.2f,\"reused_playouts\":%llu}\n",
+                        threadCount, positions.size(), static_cast<unsigned long long>(playouts), seconds, rate, rate / singleRate,
+                        static_cast<unsigned long long>(reused));
+            if (threads == 1)
+            {
+                break;
+            }
+        }
+    }
+
+    // Runs op(position, index, checksum) over every bench position until at least minSeconds
+    // have passed; op returns how many operations it did and folds a result into the checksum
+    // so nothing is optimised away
+    template <typename Op>
+    void runMicro(const char *name, std::vector<BenchPosition> positions, double minSeconds, Op op)
+    {
+        uint64_t operations = 0;
+        uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        do
+        {
+            for (size_t i = 0; i < positions.size(); i++)
+            {
+                operations += op(positions[i], i, checksum);
+            }
+        } while (secondsSince(start) < minSeconds);
+        double seconds = secondsSince(start);
+
+        std::printf("{\"bench\":\"%s\",\"operations\":%llu,\"seconds\":%.3f,\"ns_per_op\":%.2f,\"ops_per_second\":%.0f,\"checksum\":%llu}\n",
+                    name, static_cast<unsigned long long>(operations), seconds, seconds * 1e9 / operations, operations / seconds,
+                    static_cast<unsigned long long>(checksum));
+    }
+
+    void runMicroBenches(const std::vector<BenchPosition> &positions, double minSeconds)
+    {
+        std::printf("{\"bench\":\"kernels\",\"nnue\":\"%s\",\"attack_maps\":\"%s\"}\n", Nnue::kernelName(), attackKernelName());
+
+        runMicro("movegen", positions, minSeconds, [](BenchPosition &entry, size_t, uint64_t &checksum)
+                 {
+                     checksum += entry.position.generateLegalMoves(entry.sideToMove).size();
+                     return 1; });
+
+        runMicro("is-king-check", positions, minSeconds, [](BenchPosition &entry, size_t, uint64_t &checksum)
+                 {
+                     std::pair<int, int> king = entry.position.findKingPosition(entry.sideToMove);
+                     checksum += entry.position.IsKingCheck(king.first, king.second, entry.sideToMove);
+                     return 1; });
+
+        runMicro("eval", positions, minSeconds, [](BenchPosition &entry, size_t, uint64_t &checksum)
+                 {
+                     checksum += static_cast<uint64_t>(entry.position.evaluateBoard(entry.sideToMove));
+                     return 1; });
+
+        // The fills and term counts alone, without collecting the pieces from the board
+        struct PieceSets
+        {
+            uint64_t pieces[2][EvalParams::PieceTypes] = {};
+        };
+        std::vector<PieceSets> pieceSets(positions.size());
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            for (int square = 0; square < 64; square++)
+            {
+                const Piece &piece = positions[i].position.get_PieceAt(square % 8, square / 8);
+                if (piece.TroopType != Troops::None)
+                {
+                    pieceSets[i].pieces[static_cast<int>(piece.color)][static_cast<int>(piece.TroopType)] |= 1ull << square;
+                }
+            }
+        }
+        runMicro("attack-maps", positions, minSeconds, [&pieceSets](BenchPosition &, size_t index, uint64_t &checksum)
+                 {
+                     const PieceSets &sets = pieceSets[index];
+                     AttackMaps attacks;
+                     computeAttackMaps(sets.pieces, attacks);
+                     int counts[2][EvalParams::AttackTermCount];
+                     countAttackTerms(sets.pieces, attacks, counts);
+                     checksum += attacks.all[0] ^ attacks.all[1];
+                     for (int term = 0; term < EvalParams::AttackTermCount; term++)
+                     {
+                         checksum += counts[0][term] * 31 + counts[1][term];
+                     }
+                     return 1; });
+
+        std::vector<std::vector<Move>> moves;
+        for (BenchPosition entry : positions)
+        {
+            moves.push_back(entry.position.generateLegalMoves(entry.sideToMove));
+        }
+        runMicro("make-unmake", positions, minSeconds, [&moves](BenchPosition &entry, size_t index, uint64_t &checksum)
+                 {
+                     for (const Move &move : moves[index])
+                     {
+                         entry.position.makeMove(move);
+                         checksum += entry.position.hash();
+                         entry.position.unmakeMove();
+                     }
+                     return static_cast<int>(moves[index].size()); });
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string mode = "all";
+    int depth = 6;
+    int hashMegabytes = 16;
+    double minSeconds = 0.5;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    int moveTimeMs = 1000;
+    const char *treeDumpPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+        {
+            depth = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--hash") == 0 && i + 1 < argc)
+        {
+            hashMegabytes = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            minSeconds = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--movetime") == 0 && i + 1 < argc)
+        {
+            moveTimeMs = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--tree-dump") == 0 && i + 1 < argc)
+        {
+            treeDumpPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "search") == 0 || std::strcmp(argv[i], "micro") == 0 || std::strcmp(argv[i], "mcts") == 0 || std::strcmp(argv[i], "perft") == 0 ||
+                 std::strcmp(argv[i], "all") == 0)
+        {
+            mode = argv[i];
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [all|search|micro|mcts|perft] [--depth N] [--hash MB] [--seconds S] [--threads N] [--movetime MS] [--tree-dump FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchPosition> positions = loadPositions();
+    if (mode == "perft")
+    {
+        return runPerftBench(positions) ? 0 : 1;
+    }
+    if (mode == "mcts")
+    {
+        runMctsBench(positions, threads, moveTimeMs);
+        return 0;
+    }
+    if (mode != "micro")
+    {
+        if (treeDumpPath && !TreeDump::start(treeDumpPath))
+        {
+            std::fprintf(stderr, "cannot create %s\n", treeDumpPath);
+            return 1;
+        }
+        runSearchBench(positions, depth, hashMegabytes);
+        TreeDump::stop();
+    }
+    if (mode != "search")
+    {
+        runMicroBenches(positions, minSeconds);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Launcher for release builds with one binary per instruction set level. Installed under a
+// program's own name next to its builds (bench, bench-x86-64, bench-x86-64-v3, ...), it
+// starts the build for the best level this CPU supports with the same arguments. The NNUE
+// kernels and the compiler's vectorisation are chosen at compile time, so this is where the
+// AVX2 and AVX-512 builds get picked.
+//
+// tools/release_build.sh puts the launcher and the builds in place.
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+    // Best first
+    const char *const Levels[] = {"x86-64-v4", "x86-64-v3", "x86-64-v2", "x86-64"};
+
+    bool cpuSupports(const char *level)
+    {
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+        __builtin_cpu_init();
+        if (std::strcmp(level, "x86-64-v4") == 0)
+            return __builtin_cpu_supports("x86-64-v4");
+        if (std::strcmp(level, "x86-64-v3") == 0)
+            return __builtin_cpu_supports("x86-64-v3");
+        if (std::strcmp(level, "x86-64-v2") == 0)
+            return __builtin_cpu_supports("x86-64-v2");
+#elif defined(__x86_64__) && defined(__GNUC__)
+        // Older compilers only know the individual features; these are the ones the levels add
+        // that the compiler actually uses
+        __builtin_cpu_init();
+        if (std::strcmp(level, "x86-64-v4") == 0)
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") &&
+                   __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2");
+        if (std::strcmp(level, "x86-64-v3") == 0)
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("fma");
+        if (std::strcmp(level, "x86-64-v2") == 0)
+            return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+#endif
+        return std::strcmp(level, "x86-64") == 0;
+    }
+
+    std::string executableDirectory()
+    {
+        char path[PATH_MAX];
+        ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+        if (length <= 0)
+        {
+            return "./";
+        }
+        path[length] = '\0';
+        std::string directory(path);
+        return directory.substr(0, directory.rfind('/') + 1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    // The program is whatever name the launcher was installed or linked under
+    std::string name = argv[0];
+    name = name.substr(name.rfind('/') + 1);
+    std::string directory = executableDirectory();
+
+    for (const char *level : Levels)
+    {
+        std::string candidate = directory + name + "-" + level;
+        if (cpuSupports(level) && access(candidate.c_str(), X_OK) == 0)
+        {
+            if (getenv("CHESS_DISPATCH_VERBOSE"))
+            {
+                std::fprintf(stderr, "%s: running %s\n", name.c_str(), candidate.c_str());
+            }
+            execv(candidate.c_str(), argv);
+            std::perror(candidate.c_str());
+            return 127;
+        }
+    }
+
+    std::fprintf(stderr, "%s: no build of %s in %s for this CPU\n", name.c_str(), name.c_str(), directory.c_str());
+    return 127;
+}
@@ -0,0 +1,760 @@
+// Headless engine service: one process serves many games at once over a Unix domain socket,
+// instead of one GUI process (assets, tables and all) per game.
+//
+//   ./engine_daemon /tmp/chess.sock --threads 8 --hash 512 --book explorer.idx
+//
+// Every connection is a game session speaking newline-terminated commands:
+//
+//   position startpos|fen <fen> [moves e2e4 e7e5 ...]
+//   clock <remaining ms> [increment ms]   the session's time budget, from --budget by default
+//   go [depth N] [movetime ms]            replies "info ..." then "bestmove <move> [ponder <move>]"
+//   stop                                  ends the session's search, keeping what it found
+//   stats                                 server-wide counters
+//   isready                               replies "readyok"
+//   quit
+//
+// Searches from all sessions go into one queue served by a fixed pool of workers, earliest
+// deadline first. Each worker keeps its own Search but they all probe and store into one large
+// transposition table, and the evaluation tables, network and opening book are loaded once
+// for the whole process. A search's time counts from when its "go" arrived, so time spent
+// queued behind other sessions comes out of its own allotment instead of the session's clock.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../EvalParams.hpp"
+#include "../Nnue.hpp"
+#include "../OpeningExplorer.hpp"
+#include "../Position.hpp"
+#include "../Search.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int MinimumMoveMs = 10;   // even a nearly flagged session gets a depth-1 answer
+    constexpr int ClockMarginMs = 50;   // kept back for the reply to reach the client
+    constexpr uint32_t MinimumBookGames = 10;
+    constexpr size_t MaxPendingOutput = 1 << 20; // unsent reply bytes before a client that stopped reading is dropped
+
+    std::atomic<bool> shuttingDown{false};
+
+    // Write end of the pipe the I/O thread polls alongside the sockets, so a worker that leaves
+    // a reply waiting can have it watched for POLLOUT without waiting out the poll timeout
+    int wakeFd = -1;
+
+    void wakeIoThread()
+    {
+        char byte = 0;
+        if (wakeFd >= 0 && write(wakeFd, &byte, 1) < 0)
+        {
+            // The pipe is full, so the I/O thread is already due to wake
+        }
+    }
+
+    void setNonBlocking(int fd)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    int millisecondsSince(Clock::time_point start)
+    {
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count());
+    }
+
+    // One connected client and the game it is playing. The I/O thread owns the position; the
+    // clock is shared with the worker that settles it after each search.
+    struct Session
+    {
+        explicit Session(int socket) : fd(socket) {}
+        ~Session() { close(fd); }
+
+        // Replies come from the I/O thread and from workers, and never block either: the socket
+        // is non-blocking and what it won't take yet waits in output, sent by the I/O thread
+        // on POLLOUT. Lines stay whole and in order. A client that lets MaxPendingOutput bytes
+        // pile up has stopped reading and is disconnected.
+        void send(const std::string &line)
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            if (closed)
+            {
+                return;
+            }
+            output += line;
+            output += '\n';
+            writePending();
+            if (closed || output.empty())
+            {
+                return;
+            }
+            if (output.size() > MaxPendingOutput)
+            {
+                closed = true;
+                output.clear();
+                shutdown(fd, SHUT_RDWR); // the I/O thread sees the hangup and drops the session
+                return;
+            }
+            wakeIoThread();
+        }
+
+        // I/O thread, when the socket can take more
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            if (!closed)
+            {
+                writePending();
+            }
+        }
+
+        bool hasPendingOutput()
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            return !closed && !output.empty();
+        }
+
+        const int fd;
+        std::string input; // bytes received after the last complete line
+        Position position;
+        Color sideToMove = Color::White;
+
+        std::mutex clockMutex;
+        int64_t remainingMs = 0;
+        int64_t incrementMs = 0;
+
+        std::atomic<bool> searching{false};
+        std::atomic<bool> stopSignal{false};
+
+        std::mutex writeMutex;
+        bool closed = false;
+        std::string output; // reply bytes the socket hasn't taken yet
+
+    private:
+        // With writeMutex held
+        void writePending()
+        {
+            while (!output.empty())
+            {
+                ssize_t count = ::send(fd, output.data(), output.size(), MSG_NOSIGNAL);
+                if (count < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    return;
+                }
+                if (count <= 0)
+                {
+                    closed = true;
+                    output.clear();
+                    return;
+                }
+                output.erase(0, static_cast<size_t>(count));
+            }
+        }
+    };
+
+    struct Job
+    {
+        std::shared_ptr<Session> session;
+        Position position;
+        Color sideToMove;
+        SearchLimits limits;
+        int allottedMs;
+        Clock::time_point received;
+        Clock::time_point deadline;
+    };
+
+    struct EarliestDeadline
+    {
+        bool operator()(const std::shared_ptr<Job> &a, const std::shared_ptr<Job> &b) const { return a->deadline > b->deadline; }
+    };
+
+    struct ServerStats
+    {
+        std::atomic<uint64_t> sessions{0};
+        std::atomic<uint64_t> searches{0};
+        std::atomic<uint64_t> bookMoves{0};
+        std::atomic<uint64_t> nodes{0};
+        std::atomic<uint64_t> waitMsTotal{0};
+        std::atomic<uint64_t> latencyMsTotal{0};
+        std::atomic<uint64_t> latencyMsWorst{0};
+    };
+
+    class WorkerPool
+    {
+    public:
+        WorkerPool(int threadCount, size_t hashMegabytes, ServerStats &stats) : m_table(hashMegabytes), m_stats(stats)
+        {
+            for (int i = 0; i < threadCount; i++)
+            {
+                m_threads.emplace_back(&WorkerPool::work, this);
+            }
+        }
+
+        ~WorkerPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (auto &thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        void submit(std::shared_ptr<Job> job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push(std::move(job));
+            }
+            m_wake.notify_one();
+        }
+
+        size_t queued()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_queue.size();
+        }
+
+        int hashfull() const { return m_table.hashfull(); }
+
+    private:
+        void work()
+        {
+            Search search(m_table);
+
+            for (;;)
+            {
+                std::shared_ptr<Job> job;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this]
+                                { return m_stopping || !m_queue.empty(); });
+                    if (m_stopping)
+                    {
+                        return;
+                    }
+                    job = m_queue.top();
+                    m_queue.pop();
+                }
+                run(search, *job);
+            }
+        }
+
+        void run(Search &search, Job &job)
+        {
+            Session &session = *job.session;
+            int waitedMs = millisecondsSince(job.received);
+
+            // Whatever the queue took comes out of this search's share
+            SearchLimits limits = job.limits;
+            limits.moveTimeMs = std::max(MinimumMoveMs, job.allottedMs - waitedMs);
+            SearchResult result = search.run(job.position, job.sideToMove, limits);
+
+            int latencyMs = millisecondsSince(job.received);
+            {
+                std::lock_guard<std::mutex> lock(session.clockMutex);
+                session.remainingMs += session.incrementMs - latencyMs;
+            }
+
+            m_stats.searches++;
+            m_stats.nodes += result.nodes;
+            m_stats.waitMsTotal += static_cast<uint64_t>(waitedMs);
+            m_stats.latencyMsTotal += static_cast<uint64_t>(latencyMs);
+            uint64_t worst = m_stats.latencyMsWorst;
+            while (static_cast<uint64_t>(latencyMs) > worst && !m_stats.latencyMsWorst.compare_exchange_weak(worst, latencyMs))
+            {
+            }
+
+            std::string score = "cp " + std::to_string(result.score);
+            if (isMateScore(result.score))
+            {
+                int moves = (MateScore - std::abs(result.score) + 1) / 2;
+                score = "mate " + std::to_string(result.score > 0 ? moves : -moves);
+            }
+            session.send("info depth " + std::to_string(result.depth) + " score " + score + " nodes " + std::to_string(result.nodes) +
+                         " time " + std::to_string(latencyMs) + " wait " + std::to_string(waitedMs));
+            std::string reply = "bestmove " + (result.bestMove.isNull() ? std::string("0000") : moveToString(result.bestMove));
+            if (!result.ponderMove.isNull())
+            {
+                reply += " ponder " + moveToString(result.ponderMove);
+            }
+            session.searching = false;
+            session.send(reply);
+        }
+
+        TranspositionTable m_table;
+        ServerStats &m_stats;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::priority_queue<std::shared_ptr<Job>, std::vector<std::shared_ptr<Job>>, EarliestDeadline> m_queue;
+        bool m_stopping = false;
+        std::vector<std::thread> m_threads;
+    };
+
+    // Coordinate notation, checked against the legal moves so a client can't corrupt the board
+    bool parseMove(Position &position, Color sideToMove, const std::string &text, Move &move)
+    {
+        for (const Move &legal : position.generateLegalMoves(sideToMove))
+        {
+            if (moveToString(legal) == text)
+            {
+                move = legal;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    class Server
+    {
+    public:
+        Server(WorkerPool &pool, ServerStats &stats, const OpeningExplorer &book, int64_t budgetMs) : m_pool(pool), m_stats(stats), m_book(book), m_budgetMs(budgetMs)
+        {
+            if (pipe(m_wakePipe) == 0)
+            {
+                setNonBlocking(m_wakePipe[0]);
+                setNonBlocking(m_wakePipe[1]);
+                wakeFd = m_wakePipe[1];
+            }
+        }
+
+        bool listen(const std::string &path)
+        {
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(address.sun_path))
+            {
+                std::cerr << "Socket path too long: " << path << std::endl;
+                return false;
+            }
+            std::strcpy(address.sun_path, path.c_str());
+
+            m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+            unlink(path.c_str()); // a previous run's socket file would make bind fail
+            if (m_listener < 0 || bind(m_listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+                ::listen(m_listener, SOMAXCONN) != 0)
+            {
+                std::perror("listen");
+                return false;
+            }
+            m_path = path;
+            return true;
+        }
+
+        ~Server()
+        {
+            for (auto &entry : m_sessions)
+            {
+                closeSession(*entry.second);
+            }
+            if (m_listener >= 0)
+            {
+                close(m_listener);
+                unlink(m_path.c_str());
+            }
+            if (m_wakePipe[0] >= 0)
+            {
+                wakeFd = -1;
+                close(m_wakePipe[0]);
+                close(m_wakePipe[1]);
+            }
+        }
+
+        // Accepts connections and reads commands until a shutdown signal arrives
+        void serve()
+        {
+            std::vector<pollfd> fds;
+            while (!shuttingDown)
+            {
+                fds.clear();
+                fds.push_back({m_listener, POLLIN, 0});
+                fds.push_back({m_wakePipe[0], POLLIN, 0});
+                for (auto &entry : m_sessions)
+                {
+                    short events = POLLIN | (entry.second->hasPendingOutput() ? POLLOUT : 0);
+                    fds.push_back({entry.first, events, 0});
+                }
+
+                // The timeout only bounds how long a shutdown signal waits to be noticed
+                if (poll(fds.data(), fds.size(), 200) <= 0)
+                {
+                    continue;
+                }
+
+                if (fds[0].revents & POLLIN)
+                {
+                    accept();
+                }
+                if (fds[1].revents & POLLIN)
+                {
+                    char drain[64];
+                    while (read(m_wakePipe[0], drain, sizeof(drain)) > 0)
+                    {
+                    }
+                }
+                for (size_t i = 2; i < fds.size(); i++)
+                {
+                    if (fds[i].revents & POLLOUT)
+                    {
+                        auto entry = m_sessions.find(fds[i].fd);
+                        if (entry != m_sessions.end())
+                        {
+                            entry->second->flush();
+                        }
+                    }
+                    if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                    {
+                        receive(fds[i].fd);
+                    }
+                }
+            }
+        }
+
+    private:
+        void accept()
+        {
+            int fd = ::accept(m_listener, nullptr, nullptr);
+            if (fd < 0)
+            {
+                return;
+            }
+            setNonBlocking(fd);
+            auto session = std::make_shared<Session>(fd);
+            session->position.SetupBoard();
+            session->remainingMs = m_budgetMs;
+            m_sessions[fd] = session;
+            m_stats.sessions++;
+        }
+
+        void receive(int fd)
+        {
+            std::shared_ptr<Session> session = m_sessions[fd];
+            char buffer[4096];
+            ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                return;
+            }
+            if (count <= 0)
+            {
+                closeSession(*session);
+                m_sessions.erase(fd);
+                return;
+            }
+
+            session->input.append(buffer, static_cast<size_t>(count));
+            size_t newline;
+            while ((newline = session->input.find('\n')) != std::string::npos)
+            {
+                std::string line = session->input.substr(0, newline);
+                session->input.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r')
+                {
+                    line.pop_back();
+                }
+                if (!handle(session, line))
+                {
+                    closeSession(*session);
+                    m_sessions.erase(fd);
+                    return;
+                }
+            }
+        }
+
+        // Queued or running searches hold their own reference; they see the stop and finish
+        // quickly, and the socket closes when the last reference goes
+        void closeSession(Session &session)
+        {
+            session.stopSignal = true;
+            std::lock_guard<std::mutex> lock(session.writeMutex);
+            session.closed = true;
+            shutdown(session.fd, SHUT_RDWR);
+        }
+
+        // Returns false when the client asked to end the session
+        bool handle(const std::shared_ptr<Session> &session, const std::string &line)
+        {
+            std::istringstream words(line);
+            std::string command;
+            words >> command;
+
+            if (command.empty())
+            {
+                return true;
+            }
+            if (command == "quit")
+            {
+                return false;
+            }
+            if (command == "isready")
+            {
+                session->send("readyok");
+            }
+            else if (command == "stop")
+            {
+                session->stopSignal = true;
+            }
+            else if (command == "stats")
+            {
+                uint64_t searches = m_stats.searches;
+                uint64_t divisor = std::max<uint64_t>(searches, 1);
+                session->send("stats sessions " + std::to_string(m_sessions.size()) + " queued " + std::to_string(m_pool.queued()) +
+                              " searches " + std::to_string(searches) + " book " + std::to_string(m_stats.bookMoves.load()) +
+                              " nodes " + std::to_string(m_stats.nodes.load()) + " hashfull " + std::to_string(m_pool.hashfull()) +
+                              " avg-wait-ms " + std::to_string(m_stats.waitMsTotal / divisor) +
+                              " avg-latency-ms " + std::to_string(m_stats.latencyMsTotal / divisor) +
+                              " worst-latency-ms " + std::to_string(m_stats.latencyMsWorst.load()));
+            }
+            else if (session->searching)
+            {
+                // The session's clock and reply order depend on one search at a time
+                session->send("error search in progress");
+            }
+            else if (command == "position")
+            {
+                setPosition(*session, words);
+            }
+            else if (command == "clock")
+            {
+                int64_t remaining = 0, increment = 0;
+                words >> remaining >> increment;
+                std::lock_guard<std::mutex> lock(session->clockMutex);
+                session->remainingMs = std::max<int64_t>(remaining, 0);
+                session->incrementMs = std::max<int64_t>(increment, 0);
+            }
+            else if (command == "go")
+            {
+                go(session, words);
+            }
+            else
+            {
+                session->send("error unknown command " + command);
+            }
+            return true;
+        }
+
+        void setPosition(Session &session, std::istringstream &words)
+        {
+            Position position;
+            Color sideToMove = Color::White;
+            std::string word;
+            words >> word;
+            if (word == "startpos")
+            {
+                position.SetupBoard();
+                words >> word;
+            }
+            else if (word == "fen")
+            {
+                std::string fen;
+                while (words >> word && word != "moves")
+                {
+                    fen += (fen.empty() ? "" : " ") + word;
+                }
+                if (!position.setFromFen(fen, sideToMove))
+                {
+                    session.send("error bad fen");
+                    return;
+                }
+            }
+            else
+            {
+                session.send("error expected startpos or fen");
+                return;
+            }
+
+            if (word == "moves")
+            {
+                while (words >> word)
+                {
+                    Move move;
+                    if (!parseMove(position, sideToMove, word, move))
+                    {
+                        session.send("error illegal move " + word);
+                        return;
+                    }
+                    position.makeMove(move);
+                    sideToMove = Position::getOppositeColor(sideToMove);
+                }
+            }
+
+            session.position = position;
+            session.sideToMove = sideToMove;
+        }
+
+        void go(const std::shared_ptr<Session> &session, std::istringstream &words)
+        {
+            auto job = std::make_shared<Job>();
+            job->received = Clock::now();
+            job->session = session;
+            job->position = session->position;
+            job->sideToMove = session->sideToMove;
+            job->limits.depth = SearchLimits::Infinite;
+            job->limits.stopSignal = &session->stopSignal;
+
+            int requestedMs = 0;
+            std::string word;
+            while (words >> word)
+            {
+                if (word == "depth")
+                {
+                    words >> job->limits.depth;
+                    job->limits.depth = std::max(1, std::min(job->limits.depth, static_cast<int>(SearchLimits::Infinite)));
+                }
+                else if (word == "movetime")
+                {
+                    words >> requestedMs;
+                }
+            }
+
+            if (playFromBook(*session))
+            {
+                return;
+            }
+
+            // A fixed share of what's left plus most of the increment, never more than the clock
+            int64_t allotted;
+            {
+                std::lock_guard<std::mutex> lock(session->clockMutex);
+                allotted = session->remainingMs / 30 + session->incrementMs * 3 / 4;
+                allotted = std::min(allotted, session->remainingMs - ClockMarginMs);
+            }
+            if (requestedMs > 0)
+            {
+                allotted = std::min<int64_t>(allotted, requestedMs);
+            }
+            job->allottedMs = static_cast<int>(std::max<int64_t>(allotted, MinimumMoveMs));
+            job->deadline = job->received + std::chrono::milliseconds(job->allottedMs);
+
+            session->stopSignal = false;
+            session->searching = true;
+            m_pool.submit(std::move(job));
+        }
+
+        // Answers straight from the shared book without queueing when the position is well known
+        bool playFromBook(Session &session)
+        {
+            if (!m_book.isOpen())
+            {
+                return false;
+            }
+            std::vector<ExplorerMove> moves = m_book.lookup(session.position.placementKey() ^ Position::sideKey(session.sideToMove));
+            for (const ExplorerMove &candidate : moves)
+            {
+                if (candidate.games() < MinimumBookGames)
+                {
+                    break;
+                }
+                Move legal;
+                if (parseMove(session.position, session.sideToMove, moveToString(candidate.move), legal))
+                {
+                    m_stats.bookMoves++;
+                    session.send("info book games " + std::to_string(candidate.games()));
+                    session.send("bestmove " + moveToString(legal));
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        WorkerPool &m_pool;
+        ServerStats &m_stats;
+        const OpeningExplorer &m_book;
+        int64_t m_budgetMs;
+        int m_listener = -1;
+        int m_wakePipe[2] = {-1, -1};
+        std::string m_path;
+        std::map<int, std::shared_ptr<Session>> m_sessions;
+    };
+
+    void requestShutdown(int)
+    {
+        shuttingDown = true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argv[1][0] == '-')
+    {
+        std::cerr << "usage: " << argv[0] << " <socket path> [--threads N] [--hash MB] [--budget ms] [--book explorer.idx] [--eval eval.params] [--nnue nnue.bin]" << std::endl;
+        return 1;
+    }
+
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMegabytes = 256;
+    int64_t budgetMs = 300000;
+    OpeningExplorer book;
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--hash") == 0)
+        {
+            hashMegabytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--budget") == 0)
+        {
+            budgetMs = std::max(0LL, std::atoll(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--book") == 0 && !book.Open(argv[++i]))
+        {
+            std::cerr << "Cannot open book " << argv[i] << std::endl;
+            return 1;
+        }
+        else if (std::strcmp(argv[i], "--eval") == 0 && !loadEvalParams(argv[++i]))
+        {
+            std::cerr << "Cannot load " << argv[i] << std::endl;
+            return 1;
+        }
+        else if (std::strcmp(argv[i], "--nnue") == 0 && !Nnue::load(argv[++i]))
+        {
+            std::cerr << "Cannot load " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, requestShutdown);
+    std::signal(SIGTERM, requestShutdown);
+
+    ServerStats stats;
+    WorkerPool pool(threads, hashMegabytes, stats);
+    Server server(pool, stats, book, budgetMs);
+    if (!server.listen(argv[1]))
+    {
+        return 1;
+    }
+    std::cerr << "Serving on " << argv[1] << " with " << threads << " workers and " << hashMegabytes << " MB of hash" << std::endl;
+    server.serve();
+
+    std::cerr << "Served " << stats.sessions << " sessions, " << stats.searches << " searches, " << stats.bookMoves << " book moves" << std::endl;
+    return 0;
+}
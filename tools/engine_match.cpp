@@ -0,0 +1,171 @@
+// Plays the Monte Carlo tree search against the alpha-beta search at the same time per move,
+// each opening once with either colour, and prints one JSON line per game and a summary.
+//
+//   ./engine_match --movetime 1000 --threads 64 --openings 8
+//
+// Alpha-beta searches on one thread; the tree search uses --threads threads, so the result
+// shows what the extra cores buy it. The tree search keeps its tree from move to move, as in
+// the game.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "../Mcts.hpp"
+#include "../Position.hpp"
+#include "../Search.hpp"
+
+namespace
+{
+    const char *const Openings[] = {
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR b KQkq - 0 1",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+        "rnbqkb1r/pp1p1ppp/4pn2/2p5/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 0 4",
+        "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/ppp1pppp/8/3p4/2PP4/8/PP2PPPP/RNBQKBNR b KQkq - 0 2",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "rnbqkb1r/pppppp1p/5np1/8/2PP4/8/PP2PPPP/RNBQKBNR w KQkq - 0 3",
+    };
+
+    constexpr int MaxGamePlies = 300;
+
+    enum class Outcome
+    {
+        WhiteWins,
+        BlackWins,
+        Draw
+    };
+
+    const char *outcomeName(Outcome outcome)
+    {
+        return outcome == Outcome::WhiteWins ? "1-0" : outcome == Outcome::BlackWins ? "0-1" : "1/2-1/2";
+    }
+
+    Outcome playGame(const Position &start, Color side, Color mctsColor, int moveTimeMs, int threads, uint64_t &mctsPlayouts, uint64_t &alphaBetaNodes)
+    {
+        Position position = start;
+
+        Search alphaBeta(64);
+        SearchLimits searchLimits;
+        searchLimits.depth = SearchLimits::Infinite;
+        searchLimits.moveTimeMs = moveTimeMs;
+
+        Mcts mcts(256);
+        MctsLimits mctsLimits;
+        mctsLimits.moveTimeMs = moveTimeMs;
+        mctsLimits.threads = threads;
+
+        for (int ply = 0; ply < MaxGamePlies; ply++)
+        {
+            switch (position.gameStatus(side))
+            {
+            case GameStatus::Checkmate:
+                return side == Color::White ? Outcome::BlackWins : Outcome::WhiteWins;
+            case GameStatus::Ongoing:
+                break;
+            default:
+                return Outcome::Draw;
+            }
+
+            SearchResult result;
+            if (side == mctsColor)
+            {
+                result = mcts.run(position, side, mctsLimits);
+                mctsPlayouts += result.nodes;
+            }
+            else
+            {
+                result = alphaBeta.run(position, side, searchLimits);
+                alphaBetaNodes += result.nodes;
+            }
+            if (result.bestMove.isNull())
+            {
+                break;
+            }
+            position.makeMove(result.bestMove);
+            side = Position::getOppositeColor(side);
+        }
+        return Outcome::Draw;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int moveTimeMs = 1000;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    int openings = static_cast<int>(sizeof(Openings) / sizeof(Openings[0]));
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--movetime") == 0 && i + 1 < argc)
+        {
+            moveTimeMs = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--openings") == 0 && i + 1 < argc)
+        {
+            openings = std::min(openings, std::max(1, std::atoi(argv[++i])));
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--movetime MS] [--threads N] [--openings N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+    uint64_t mctsPlayouts = 0;
+    uint64_t alphaBetaNodes = 0;
+    for (int opening = 0; opening < openings; opening++)
+    {
+        Position start;
+        Color side = Color::White;
+        if (!start.setFromFen(Openings[opening], side))
+        {
+            std::fprintf(stderr, "{\"error\":\"bad opening\",\"opening\":\"%s\"}\n", Openings[opening]);
+            continue;
+        }
+
+        for (Color mctsColor : {Color::White, Color::Black})
+        {
+            Outcome outcome = playGame(start, side, mctsColor, moveTimeMs, threads, mctsPlayouts, alphaBetaNodes);
+            const char *result = "draw";
+            if (outcome != Outcome::Draw)
+            {
+                bool mctsWon = (outcome == Outcome::WhiteWins) == (mctsColor == Color::White);
+                result = mctsWon ? "mcts" : "alphabeta";
+                (mctsWon ? wins : losses)++;
+            }
+            else
+            {
+                draws++;
+            }
+            std::printf("{\"game\":%d,\"opening\":\"%s\",\"mcts\":\"%s\",\"result\":\"%s\",\"winner\":\"%s\"}\n",
+                        wins + draws + losses, Openings[opening], mctsColor == Color::White ? "white" : "black", outcomeName(outcome), result);
+            std::fflush(stdout);
+        }
+    }
+
+    // Elo difference from the score, clamped away from 0% and 100% where it is unbounded
+    int games = wins + draws + losses;
+    if (games == 0)
+    {
+        return 1;
+    }
+    double score = (wins + 0.5 * draws) / games;
+    double clamped = std::min(std::max(score, 0.01), 0.99);
+    double elo = -400.0 * std::log10(1.0 / clamped - 1.0);
+    std::printf("{\"summary\":\"mcts-vs-alphabeta\",\"games\":%d,\"wins\":%d,\"draws\":%d,\"losses\":%d,\"score\":%.3f,\"elo\":%.0f,\"movetime_ms\":%d,\"threads\":%d,\"mcts_playouts\":%llu,\"alphabeta_nodes\":%llu}\n",
+                games, wins, draws, losses, score, elo, moveTimeMs, threads, static_cast<unsigned long long>(mctsPlayouts),
+                static_cast<unsigned long long>(alphaBetaNodes));
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Packs the game's asset directories into the single bundle the game mmaps at startup.
+//
+//   g++ -std=c++17 tools/pack_assets.cpp -o pack_assets
+//   ./pack_assets assets.pak textures images Sound Font
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../AssetBundleFormat.hpp"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <output.pak> <asset dir>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; i++)
+    {
+        if (!fs::is_directory(argv[i]))
+        {
+            std::cerr << "Not a directory: " << argv[i] << std::endl;
+            return 1;
+        }
+        for (const auto &entry : fs::recursive_directory_iterator(argv[i]))
+        {
+            if (entry.is_regular_file())
+            {
+                files.push_back(entry.path().generic_string());
+            }
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<BundleEntry> entries(files.size());
+    std::vector<std::vector<char>> payloads(files.size());
+    uint64_t offset = sizeof(BundleHeader) + entries.size() * sizeof(BundleEntry);
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (files[i].size() >= BundleNameLength)
+        {
+            std::cerr << "Asset path too long for the bundle index: " << files[i] << std::endl;
+            return 1;
+        }
+
+        std::ifstream in(files[i], std::ios::binary);
+        payloads[i].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+        offset = (offset + BundleAlignment - 1) / BundleAlignment * BundleAlignment;
+        std::memset(&entries[i], 0, sizeof(BundleEntry));
+        std::memcpy(entries[i].name, files[i].c_str(), files[i].size());
+        entries[i].offset = offset;
+        entries[i].size = payloads[i].size();
+        offset += payloads[i].size();
+    }
+
+    BundleHeader header;
+    std::memcpy(header.magic, BundleMagic, sizeof(header.magic));
+    header.version = BundleVersion;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+
+    std::ofstream out(argv[1], std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(BundleEntry));
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        static const char padding[BundleAlignment] = {};
+        out.write(padding, entries[i].offset - static_cast<uint64_t>(out.tellp()));
+        out.write(payloads[i].data(), payloads[i].size());
+    }
+
+    if (!out)
+    {
+        std::cerr << "Failed to write " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << entries.size() << " assets into " << argv[1] << " (" << offset << " bytes)" << std::endl;
+    return 0;
+}
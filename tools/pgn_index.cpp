@@ -0,0 +1,65 @@
+// Builds the opening explorer index from PGN files.
+//
+//   g++ -std=c++17 -O2 tools/pgn_index.cpp AttackMaps.cpp Pgn.cpp OpeningExplorer.cpp PawnStructure.cpp Position.cpp EvalParams.cpp Nnue.cpp Trace.cpp -o pgn_index -lpthread
+//   ./pgn_index explorer.idx games1.pgn games2.pgn --plies 40 --threads 8
+//
+// Copy explorer.idx next to the game executable to enable the explorer panel (E key).
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Pgn.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <explorer.idx> <games.pgn>... [--plies N] [--threads N]" << std::endl;
+        return 1;
+    }
+
+    int plies = 40;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> inputs;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--plies") == 0 && i + 1 < argc)
+        {
+            plies = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else
+        {
+            inputs.push_back(argv[i]);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PgnIndexer indexer(plies);
+
+    for (const auto &input : inputs)
+    {
+        if (!indexer.addFile(input, threads))
+        {
+            return 1;
+        }
+    }
+    if (!indexer.write(argv[1]))
+    {
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const PgnStats &stats = indexer.stats();
+    std::cout << "games " << stats.games << " skipped " << stats.skipped << " positions " << stats.positions
+              << " seconds " << seconds << " games/min " << static_cast<uint64_t>(stats.games / seconds * 60) << std::endl;
+    return 0;
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Release build: -O3, link-time optimisation and a profile trained on the deterministic bench,
+# for every instruction set level, with a launcher that picks the level at run time.
+#
+#   tools/release_build.sh [output directory]        default: dist
+#   CHESS_LEVELS="x86-64 x86-64-v3" tools/release_build.sh
+#
+# Stage one builds an instrumented bench and runs the fixed-depth search bench and the perft
+# positions; both are deterministic, so the profile and the binaries come out the same every
+# time. Stage two builds everything once per level with that profile. The output directory then
+# holds <program>-<level> for each level and a launcher under each plain <program> name.
+
+set -eu
+
+source_dir=$(cd "$(dirname "$0")/.." && pwd)
+output=${1:-$source_dir/dist}
+levels=${CHESS_LEVELS:-"x86-64 x86-64-v2 x86-64-v3 x86-64-v4"}
+programs="chess bench pgn_index texel_tune engine_daemon mate_solve engine_match selfplay tree_stats"
+work=$output/.build
+profile=$work/profile
+jobs=$(nproc 2>/dev/null || echo 4)
+
+rm -rf "$work"
+mkdir -p "$profile"
+
+echo "== stage 1: training the profile"
+cmake -S "$source_dir" -B "$work/train" -DCMAKE_BUILD_TYPE=Release -DCHESS_BUILD_GUI=OFF -DCHESS_BUILD_TOOLS=OFF \
+    -DCHESS_PGO=GENERATE -DCHESS_PGO_DIR="$profile" >/dev/null
+cmake --build "$work/train" -j "$jobs" --target bench
+"$work/train/bench" search --depth 7 >/dev/null
+"$work/train/bench" perft >/dev/null
+
+for level in $levels; do
+    echo "== stage 2: $level"
+    cmake -S "$source_dir" -B "$work/$level" -DCMAKE_BUILD_TYPE=Release -DCHESS_MARCH="$level" \
+        -DCHESS_PGO=USE -DCHESS_PGO_DIR="$profile" >/dev/null
+    cmake --build "$work/$level" -j "$jobs"
+    for program in $programs; do
+        if [ -x "$work/$level/$program" ]; then
+            cp "$work/$level/$program" "$output/$program-$level"
+        fi
+    done
+done
+
+# The launcher and the assets are the same in every level's build; take the first
+first=$(echo "$levels" | cut -d' ' -f1)
+for program in $programs; do
+    if [ -x "$output/$program-$first" ]; then
+        cp "$work/$first/cpu_dispatch" "$output/$program"
+    fi
+done
+if [ -f "$work/$first/assets.pak" ]; then
+    cp "$work/$first/assets.pak" "$output/"
+fi
+
+echo "== bench signature per level (must all match)"
+for level in $levels; do
+    if "$output/bench-$level" micro --seconds 0 >/dev/null 2>&1; then
+        printf '%s: ' "$level"
+        "$output/bench-$level" search | tail -n 1
+    else
+        echo "$level: not supported by this CPU"
+    fi
+done
@@ -0,0 +1,390 @@
+// Self-play training data: plays engine-vs-engine games on every core and streams sampled
+// positions, labelled with the search score and the game result, to a positions file in the
+// 32-byte PackedPosition format that texel_tune reads.
+//
+//   ./selfplay data.bin --games 100000 --threads 32 --depth 6
+//   ./selfplay data.bin --positions 1000000000 --sample 0.3 --eval eval.params
+//
+// Each game starts from --random-plies random moves out of the start position (openings that
+// come out lopsided are dropped), then both sides search to --depth. Positions in check,
+// positions where the best move is a capture or promotion, and mate scores are not sampled, so
+// the scores match what a static evaluation can learn. Lost and drawn games are adjudicated
+// once the score has been decisive or dead level for a while.
+//
+// Every thread buffers its positions and appends them in chunks of ChunkRecords under one
+// lock, so the file grows by large sequential writes. An existing positions file is appended
+// to. Ctrl-C stops after the games in progress and flushes everything.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../EvalParams.hpp"
+#include "../Nnue.hpp"
+#include "../PackedPosition.hpp"
+#include "../Position.hpp"
+#include "../Search.hpp"
+
+namespace
+{
+    constexpr size_t ChunkRecords = 8192; // 256 KB per write
+    constexpr int MaxGamePlies = 400;
+    constexpr int OpeningMaxScore = 300;  // drop random openings already decided beyond this
+    constexpr int ResignScore = 1500;
+    constexpr int ResignPlies = 6;        // consecutive plies beyond ResignScore
+    constexpr int DrawScore = 5;
+    constexpr int DrawPlies = 16;         // consecutive plies within DrawScore
+    constexpr int DrawFromPly = 80;
+
+    std::atomic<bool> shutdownRequested{false};
+
+    void requestShutdown(int)
+    {
+        shutdownRequested = true;
+    }
+
+    struct Options
+    {
+        int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        int depth = 6;
+        int randomPlies = 8;
+        double sample = 0.5;
+        uint64_t games = 0;     // 0 for no limit
+        uint64_t positions = 0; // 0 for no limit
+        size_t hashMegabytes = 16;
+        uint64_t seed = 0;
+    };
+
+    // Appends chunks of records to one positions file from many threads
+    class PositionWriter
+    {
+    public:
+        ~PositionWriter()
+        {
+            if (out)
+            {
+                std::fclose(out);
+            }
+        }
+
+        bool open(const std::string &path)
+        {
+            // Keep appending to an existing positions file, otherwise start one
+            if (std::FILE *existing = std::fopen(path.c_str(), "rb"))
+            {
+                PositionFileHeader header;
+                bool valid = std::fread(&header, sizeof(header), 1, existing) == 1 &&
+                             std::memcmp(header.magic, PositionFileMagic, sizeof(PositionFileMagic)) == 0 &&
+                             header.version == PositionFileVersion;
+                std::fseek(existing, 0, SEEK_END);
+                long size = std::ftell(existing);
+                std::fclose(existing);
+                if (size > 0)
+                {
+                    if (!valid || (size - sizeof(PositionFileHeader)) % sizeof(PackedPosition) != 0)
+                    {
+                        std::cerr << path << " is not a positions file" << std::endl;
+                        return false;
+                    }
+                    out = std::fopen(path.c_str(), "ab");
+                    return out != nullptr;
+                }
+            }
+
+            out = std::fopen(path.c_str(), "wb");
+            if (!out)
+            {
+                return false;
+            }
+            PositionFileHeader header = makePositionFileHeader();
+            return std::fwrite(&header, sizeof(header), 1, out) == 1;
+        }
+
+        bool write(const std::vector<PackedPosition> &records)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::fwrite(records.data(), sizeof(PackedPosition), records.size(), out) == records.size();
+        }
+
+        bool close()
+        {
+            bool ok = std::fclose(out) == 0;
+            out = nullptr;
+            return ok;
+        }
+
+    private:
+        std::FILE *out = nullptr;
+        std::mutex mutex;
+    };
+
+    struct Counters
+    {
+        std::atomic<uint64_t> games{0};
+        std::atomic<uint64_t> positions{0};
+        std::atomic<bool> writeFailed{false};
+    };
+
+    bool isTactical(const Position &position, const Move &move)
+    {
+        const Piece &mover = position.get_PieceAt(move.srcX, move.srcY);
+        if (!position.isEmpty(move.destX, move.destY))
+        {
+            return true;
+        }
+        return mover.TroopType == Troops::Pawn && (move.srcX != move.destX || move.destY == 0 || move.destY == 7);
+    }
+
+    // Random moves out of the start position until one comes out that isn't already decided
+    Color playOpening(Position &position, Search &search, const Options &options, std::mt19937_64 &rng)
+    {
+        SearchLimits quick;
+        quick.depth = std::min(options.depth, 4);
+        for (;;)
+        {
+            position.SetupBoard();
+            Color side = Color::White;
+            bool ok = true;
+            for (int ply = 0; ply < options.randomPlies && ok; ply++)
+            {
+                std::vector<Move> moves = position.generateLegalMoves(side);
+                ok = !moves.empty();
+                if (ok)
+                {
+                    position.makeMove(moves[rng() % moves.size()]);
+                    side = Position::getOppositeColor(side);
+                }
+            }
+            if (ok && position.gameStatus(side) == GameStatus::Ongoing &&
+                std::abs(search.run(position, side, quick).score) <= OpeningMaxScore)
+            {
+                return side;
+            }
+        }
+    }
+
+    // Plays one game and returns its sampled positions with the result filled in
+    void playGame(Search &search, const Options &options, std::mt19937_64 &rng, std::vector<PackedPosition> &sampled)
+    {
+        Position position;
+        search.clear();
+        Color side = playOpening(position, search, options, rng);
+
+        SearchLimits limits;
+        limits.depth = options.depth;
+        std::bernoulli_distribution keep(options.sample);
+
+        size_t firstSample = sampled.size();
+        GameResult result = GameResult::Draw;
+        int resignCount = 0;
+        int drawCount = 0;
+        for (int ply = options.randomPlies; ply < MaxGamePlies; ply++)
+        {
+            GameStatus status = position.gameStatus(side);
+            if (status == GameStatus::Checkmate)
+            {
+                result = side == Color::White ? GameResult::BlackWins : GameResult::WhiteWins;
+                break;
+            }
+            if (status != GameStatus::Ongoing)
+            {
+                break;
+            }
+
+            SearchResult best = search.run(position, side, limits);
+            if (best.bestMove.isNull())
+            {
+                break;
+            }
+            int whiteScore = side == Color::White ? best.score : -best.score;
+
+            if (!isMateScore(best.score) && !position.inCheck(side) && !isTactical(position, best.bestMove) && keep(rng))
+            {
+                PackedPosition packed = packPosition(position, side);
+                packed.score = static_cast<int16_t>(std::max(-32000, std::min(32000, whiteScore)));
+                packed.ply = static_cast<uint16_t>(ply);
+                sampled.push_back(packed);
+            }
+
+            resignCount = std::abs(best.score) >= ResignScore ? resignCount + 1 : 0;
+            drawCount = ply >= DrawFromPly && std::abs(best.score) <= DrawScore ? drawCount + 1 : 0;
+            if (resignCount >= ResignPlies)
+            {
+                result = whiteScore > 0 ? GameResult::WhiteWins : GameResult::BlackWins;
+                break;
+            }
+            if (drawCount >= DrawPlies)
+            {
+                break;
+            }
+
+            position.makeMove(best.bestMove);
+            side = Position::getOppositeColor(side);
+        }
+
+        for (size_t i = firstSample; i < sampled.size(); i++)
+        {
+            sampled[i].result = static_cast<uint8_t>(result);
+        }
+    }
+
+    void worker(int index, const Options &options, PositionWriter &writer, Counters &counters)
+    {
+        std::mt19937_64 rng(options.seed + static_cast<uint64_t>(index) * 0x9E3779B97F4A7C15ull);
+        Search search(options.hashMegabytes);
+        std::vector<PackedPosition> buffer;
+        buffer.reserve(ChunkRecords + MaxGamePlies);
+
+        auto flush = [&]()
+        {
+            if (!buffer.empty() && !writer.write(buffer))
+            {
+                counters.writeFailed = true;
+            }
+            buffer.clear();
+        };
+
+        while (!shutdownRequested && !counters.writeFailed)
+        {
+            // Claim the game first so a --games limit is never overshot
+            uint64_t game = counters.games.fetch_add(1);
+            if ((options.games && game >= options.games) || (options.positions && counters.positions >= options.positions))
+            {
+                counters.games.fetch_sub(1);
+                break;
+            }
+
+            size_t before = buffer.size();
+            playGame(search, options, rng, buffer);
+            counters.positions += buffer.size() - before;
+            if (buffer.size() >= ChunkRecords)
+            {
+                flush();
+            }
+        }
+        flush();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argv[1][0] == '-')
+    {
+        std::cerr << "usage: " << argv[0] << " <positions.bin> [--games N] [--positions N] [--threads N] [--depth N] [--random-plies N]"
+                  << " [--sample P] [--hash MB] [--seed N] [--eval eval.params] [--nnue nnue.bin]" << std::endl;
+        return 1;
+    }
+
+    Options options;
+    options.seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--games") == 0)
+        {
+            options.games = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--positions") == 0)
+        {
+            options.positions = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--depth") == 0)
+        {
+            options.depth = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--random-plies") == 0)
+        {
+            options.randomPlies = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--sample") == 0)
+        {
+            options.sample = std::min(1.0, std::max(0.0, std::atof(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--hash") == 0)
+        {
+            options.hashMegabytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0)
+        {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--eval") == 0 && !loadEvalParams(argv[++i]))
+        {
+            std::cerr << "Cannot load " << argv[i] << std::endl;
+            return 1;
+        }
+        else if (std::strcmp(argv[i], "--nnue") == 0 && !Nnue::load(argv[++i]))
+        {
+            std::cerr << "Cannot load " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    PositionWriter writer;
+    if (!writer.open(argv[1]))
+    {
+        std::cerr << "Cannot write " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, requestShutdown);
+    std::signal(SIGTERM, requestShutdown);
+
+    Counters counters;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threads; i++)
+    {
+        threads.emplace_back(worker, i, std::cref(options), std::ref(writer), std::ref(counters));
+    }
+
+    // Progress on stderr while the workers play; the summary goes to stdout
+    std::atomic<bool> finished{false};
+    std::thread progress([&]()
+                         {
+                             while (!finished)
+                             {
+                                 for (int i = 0; i < 100 && !finished; i++)
+                                 {
+                                     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                                 }
+                                 double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                                 uint64_t positions = counters.positions;
+                                 std::fprintf(stderr, "games %llu positions %llu  %.0f positions/s  %.0f per thread\n",
+                                              static_cast<unsigned long long>(counters.games.load()), static_cast<unsigned long long>(positions),
+                                              positions / seconds, positions / seconds / options.threads);
+                             } });
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    finished = true;
+    progress.join();
+
+    bool ok = writer.close() && !counters.writeFailed;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t positions = counters.positions;
+    std::printf("{\"selfplay\":\"%s\",\"games\":%llu,\"positions\":%llu,\"bytes\":%llu,\"seconds\":%.1f,\"positions_per_second\":%.0f,\"positions_per_second_per_thread\":%.1f,\"threads\":%d,\"depth\":%d}\n",
+                argv[1], static_cast<unsigned long long>(counters.games.load()), static_cast<unsigned long long>(positions),
+                static_cast<unsigned long long>(positions * sizeof(PackedPosition)), seconds, positions / seconds,
+                positions / seconds / options.threads, options.threads, options.depth);
+    if (!ok)
+    {
+        std::cerr << "Writing " << argv[1] << " failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,393 @@
+// Tunes the evaluation tables (EvalParams) against game results with Texel's method: find the
+// scaling K that best maps evaluations to results, then minimise the mean squared error between
+// each result and sigmoid(K * eval) over all parameters by gradient descent.
+//
+//   g++ -std=c++17 -O2 tools/texel_tune.cpp AttackMaps.cpp EvalParams.cpp PackedPosition.cpp PawnStructure.cpp Position.cpp Nnue.cpp Trace.cpp -o texel_tune -lpthread
+//   ./texel_tune convert positions.bin labelled.epd...
+//   ./texel_tune tune positions.bin eval.params --epochs 200 --threads 8
+//
+// convert reads one position per line, a FEN followed by the game result as 1-0, 0-1,
+// 1/2-1/2 or [1.0], [0.5], [0.0], and writes the 32-byte packed format. tune mmaps that file
+// and streams over it once per epoch. Copy eval.params next to the game executable to use it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../AttackMaps.hpp"
+#include "../EvalParams.hpp"
+#include "../PackedPosition.hpp"
+#include "../PawnStructure.hpp"
+
+namespace
+{
+    using Weights = std::vector<double>;
+
+    bool parseResult(const std::string &line, GameResult &result)
+    {
+        // Draw markers first: "1/2-1/2" also contains "1-"
+        if (line.find("1/2-1/2") != std::string::npos || line.find("[0.5]") != std::string::npos)
+        {
+            result = GameResult::Draw;
+        }
+        else if (line.find("1-0") != std::string::npos || line.find("[1.0]") != std::string::npos || line.find("[1]") != std::string::npos)
+        {
+            result = GameResult::WhiteWins;
+        }
+        else if (line.find("0-1") != std::string::npos || line.find("[0.0]") != std::string::npos || line.find("[0]") != std::string::npos)
+        {
+            result = GameResult::BlackWins;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    int convert(const std::string &output, const std::vector<std::string> &inputs)
+    {
+        std::FILE *out = std::fopen(output.c_str(), "wb");
+        if (!out)
+        {
+            std::cerr << "Cannot write " << output << std::endl;
+            return 1;
+        }
+        PositionFileHeader header = makePositionFileHeader();
+        std::fwrite(&header, sizeof(header), 1, out);
+
+        uint64_t written = 0;
+        uint64_t skipped = 0;
+        std::vector<PackedPosition> buffer;
+        buffer.reserve(1 << 16);
+        for (const auto &input : inputs)
+        {
+            std::ifstream in(input);
+            if (!in)
+            {
+                std::cerr << "Cannot read " << input << std::endl;
+                std::fclose(out);
+                return 1;
+            }
+            std::string line;
+            while (std::getline(in, line))
+            {
+                PackedPosition packed;
+                GameResult result;
+                if (!packFen(line, packed) || !parseResult(line.substr(line.find(' ')), result))
+                {
+                    skipped++;
+                    continue;
+                }
+                packed.result = static_cast<uint8_t>(result);
+                buffer.push_back(packed);
+                if (buffer.size() == buffer.capacity())
+                {
+                    written += std::fwrite(buffer.data(), sizeof(PackedPosition), buffer.size(), out);
+                    buffer.clear();
+                }
+            }
+        }
+        written += std::fwrite(buffer.data(), sizeof(PackedPosition), buffer.size(), out);
+
+        bool ok = std::fclose(out) == 0;
+        std::cout << "positions " << written << " skipped " << skipped << std::endl;
+        return ok ? 0 : 1;
+    }
+
+    double resultScore(const PackedPosition &packed)
+    {
+        return packed.result * 0.5;
+    }
+
+    // The evaluation is a sum of parameters, each counted once per piece or pawn feature;
+    // calls f(parameter index, +1 for White or -1 for Black) for every term in that sum
+    template <typename F>
+    void forEachFeature(const PackedPosition &packed, F &&f)
+    {
+        uint64_t pawns[2] = {};
+        uint64_t pieces[2][EvalParams::PieceTypes] = {};
+        forEachPackedPiece(packed, [&](int square, Color color, Troops troop)
+                           {
+                               int sign = color == Color::White ? 1 : -1;
+                               f(EvalParams::valueIndex(troop), sign);
+                               f(EvalParams::squareIndex(troop, relativeSquare(color, square)), sign);
+                               pieces[static_cast<int>(color)][static_cast<int>(troop)] |= 1ull << square;
+                               if (troop == Troops::Pawn)
+                               {
+                                   pawns[static_cast<int>(color)] |= 1ull << square;
+                               } });
+
+        PawnEntry pawnEntry;
+        int counts[2][EvalParams::PawnTermCount];
+        analysePawns(pawns, counts, pawnEntry.passed);
+        for (int term = 0; term < EvalParams::PawnTermCount; term++)
+        {
+            for (int n = 0; n < counts[static_cast<int>(Color::White)][term]; n++)
+            {
+                f(EvalParams::termIndex(term), 1);
+            }
+            for (int n = 0; n < counts[static_cast<int>(Color::Black)][term]; n++)
+            {
+                f(EvalParams::termIndex(term), -1);
+            }
+        }
+
+        for (int us = 0; us < 2; us++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                if (pawns[us] & (0x0101010101010101ull << x))
+                {
+                    pawnEntry.pawnFiles[us] |= 1 << x;
+                }
+            }
+        }
+        forEachPackedPiece(packed, [&](int square, Color color, Troops troop)
+                           {
+                               int sign = color == Color::White ? 1 : -1;
+                               forEachFileTerm(pawnEntry, troop, color, square % 8, [&](int term)
+                                               { f(EvalParams::termIndex(term), sign); }); });
+
+        AttackMaps attacks;
+        computeAttackMaps(pieces, attacks);
+        int attackCounts[2][EvalParams::AttackTermCount];
+        countAttackTerms(pieces, attacks, attackCounts);
+        for (int term = 0; term < EvalParams::AttackTermCount; term++)
+        {
+            for (int n = 0; n < attackCounts[static_cast<int>(Color::White)][term]; n++)
+            {
+                f(EvalParams::attackIndex(term), 1);
+            }
+            for (int n = 0; n < attackCounts[static_cast<int>(Color::Black)][term]; n++)
+            {
+                f(EvalParams::attackIndex(term), -1);
+            }
+        }
+    }
+
+    // Evaluation for White, the same sum Position::evaluateBoard makes with the rounded tables
+    double evaluate(const PackedPosition &packed, const Weights &weights)
+    {
+        double score = 0;
+        forEachFeature(packed, [&](int index, int sign)
+                       { score += sign * weights[index]; });
+        return score;
+    }
+
+    double sigmoid(double k, double eval)
+    {
+        return 1.0 / (1.0 + std::pow(10.0, -k * eval / 400.0));
+    }
+
+    // Splits the positions into one contiguous range per thread; each range runs pass(begin, end, slot)
+    template <typename Pass>
+    void parallelFor(size_t count, int threads, Pass &&pass)
+    {
+        std::vector<std::thread> workers;
+        size_t chunk = (count + threads - 1) / threads;
+        for (int t = 0; t < threads; t++)
+        {
+            size_t begin = std::min(count, t * chunk);
+            size_t end = std::min(count, begin + chunk);
+            workers.emplace_back([&, begin, end, t]
+                                 { pass(begin, end, t); });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    double meanError(const PositionFile &file, const Weights &weights, double k, int threads)
+    {
+        std::vector<double> errors(threads, 0.0);
+        parallelFor(file.size(), threads, [&](size_t begin, size_t end, int slot)
+                    {
+                        double error = 0;
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            double diff = resultScore(file.data()[i]) - sigmoid(k, evaluate(file.data()[i], weights));
+                            error += diff * diff;
+                        }
+                        errors[slot] = error; });
+
+        double total = 0;
+        for (double error : errors)
+        {
+            total += error;
+        }
+        return total / std::max<size_t>(1, file.size());
+    }
+
+    // Golden-section search for the K that fits the starting tables best
+    double fitScaling(const PositionFile &file, const Weights &weights, int threads)
+    {
+        const double ratio = (std::sqrt(5.0) - 1) / 2;
+        double low = 0.1;
+        double high = 3.0;
+        for (int i = 0; i < 30; i++)
+        {
+            double a = high - ratio * (high - low);
+            double b = low + ratio * (high - low);
+            if (meanError(file, weights, a, threads) < meanError(file, weights, b, threads))
+            {
+                high = b;
+            }
+            else
+            {
+                low = a;
+            }
+        }
+        return (low + high) / 2;
+    }
+
+    double gradient(const PositionFile &file, const Weights &weights, double k, int threads, Weights &grad)
+    {
+        std::vector<Weights> partial(threads, Weights(EvalParams::Count, 0.0));
+        std::vector<double> errors(threads, 0.0);
+        const double slope = k * std::log(10.0) / 400.0;
+
+        parallelFor(file.size(), threads, [&](size_t begin, size_t end, int slot)
+                    {
+                        Weights &local = partial[slot];
+                        double error = 0;
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            const PackedPosition &packed = file.data()[i];
+                            double s = sigmoid(k, evaluate(packed, weights));
+                            double diff = resultScore(packed) - s;
+                            error += diff * diff;
+
+                            // d(diff^2)/d(eval), spread over the features the eval is a sum of
+                            double g = -2.0 * diff * s * (1.0 - s) * slope;
+                            forEachFeature(packed, [&](int index, int sign)
+                                           { local[index] += sign * g; });
+                        }
+                        errors[slot] = error; });
+
+        double count = std::max<size_t>(1, file.size());
+        std::fill(grad.begin(), grad.end(), 0.0);
+        double total = 0;
+        for (int t = 0; t < threads; t++)
+        {
+            for (int i = 0; i < EvalParams::Count; i++)
+            {
+                grad[i] += partial[t][i] / count;
+            }
+            total += errors[t];
+        }
+        return total / count;
+    }
+
+    EvalParams rounded(const Weights &weights)
+    {
+        EvalParams params;
+        for (int i = 0; i < EvalParams::Count; i++)
+        {
+            params.set(i, static_cast<int>(std::lround(weights[i])));
+        }
+        return params;
+    }
+
+    int tune(const std::string &input, const std::string &output, int epochs, int threads, double rate)
+    {
+        PositionFile file;
+        if (!file.Open(input))
+        {
+            std::cerr << "Cannot open " << input << std::endl;
+            return 1;
+        }
+        std::cout << "positions " << file.size() << " threads " << threads << std::endl;
+
+        Weights weights(EvalParams::Count);
+        for (int i = 0; i < EvalParams::Count; i++)
+        {
+            weights[i] = evalParams().get(i);
+        }
+
+        double k = fitScaling(file, weights, threads);
+        std::cout << "K " << k << " error " << meanError(file, weights, k, threads) << std::endl;
+
+        // Adam keeps the step size sensible for both rarely and constantly seen features
+        const double beta1 = 0.9;
+        const double beta2 = 0.999;
+        Weights grad(EvalParams::Count), m(EvalParams::Count, 0.0), v(EvalParams::Count, 0.0);
+        const int kingValue = EvalParams::valueIndex(Troops::King); // one king each, so it always cancels
+
+        for (int epoch = 1; epoch <= epochs; epoch++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            double error = gradient(file, weights, k, threads, grad);
+
+            for (int i = 0; i < EvalParams::Count; i++)
+            {
+                if (i == kingValue)
+                {
+                    continue;
+                }
+                m[i] = beta1 * m[i] + (1 - beta1) * grad[i];
+                v[i] = beta2 * v[i] + (1 - beta2) * grad[i] * grad[i];
+                double mHat = m[i] / (1 - std::pow(beta1, epoch));
+                double vHat = v[i] / (1 - std::pow(beta2, epoch));
+                weights[i] -= rate * mHat / (std::sqrt(vHat) + 1e-12);
+            }
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("epoch %d error %.8f seconds %.2f positions/s %.0f\n", epoch, error, seconds, file.size() / seconds);
+            if (epoch % 10 == 0 || epoch == epochs)
+            {
+                saveEvalParams(output, rounded(weights));
+            }
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4 || (std::strcmp(argv[1], "convert") != 0 && std::strcmp(argv[1], "tune") != 0))
+    {
+        std::cerr << "usage: " << argv[0] << " convert <positions.bin> <labelled.epd>...\n"
+                  << "       " << argv[0] << " tune <positions.bin> <eval.params> [--epochs N] [--threads N] [--rate R] [--init eval.params]" << std::endl;
+        return 1;
+    }
+
+    if (std::strcmp(argv[1], "convert") == 0)
+    {
+        return convert(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    int epochs = 100;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    double rate = 1.0;
+    for (int i = 4; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--epochs") == 0)
+        {
+            epochs = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--rate") == 0)
+        {
+            rate = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--init") == 0 && !loadEvalParams(argv[++i]))
+        {
+            std::cerr << "Cannot load " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    return tune(argv[2], argv[3], epochs, threads, rate);
+}
@@ -0,0 +1,581 @@
+// Offline analysis of the search trees recorded by TreeDump (bench search --tree-dump FILE, or
+// CHESS_TREE_DUMP=FILE for the game). Prints JSON lines, except export, which writes Graphviz.
+//
+//   ./tree_stats stats tree.bin     per iteration: nodes and branching factor; per ply: nodes,
+//                                   how they ended and how well the moves were ordered
+//   ./tree_stats hot tree.bin [--search N] [--iteration D] [--ply P] [--top K]
+//                                   the K largest subtrees P plies below the root
+//   ./tree_stats export tree.bin [--search N] [--iteration D] [--path e2e4,e7e5] [--plies 3] [--top 5] > tree.dot
+//                                   one subtree, keeping each node's K largest children
+//
+// A search is one thread's stream, numbered from 1 in the order they appear (in the bench, one
+// per position); hot and export default to the last search and its last finished iteration,
+// and look at the first multiPV line.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "../TreeDump.hpp"
+
+namespace
+{
+    using TreeDump::Outcome;
+    using TreeDump::Record;
+
+    constexpr int OutcomeCount = static_cast<int>(Outcome::Count);
+    const char *const OutcomeNames[OutcomeCount] = {"exact", "fail_high", "fail_low", "hash_cut", "leaf", "draw", "mate", "stalemate", "aborted", "iteration"};
+
+    constexpr int MaxPly = 64;
+
+    const char *outcomeName(Outcome outcome)
+    {
+        int index = static_cast<int>(outcome);
+        return index < OutcomeCount ? OutcomeNames[index] : "unknown";
+    }
+
+    std::string moveName(uint16_t move)
+    {
+        return move ? moveToString(unpackMove(move)) : "root";
+    }
+
+    // Walks the chunks of a dump, calling f(thread, records, count) for each
+    template <typename F>
+    bool readDump(const char *path, F &&f)
+    {
+        std::FILE *in = std::fopen(path, "rb");
+        if (!in)
+        {
+            std::fprintf(stderr, "cannot open %s\n", path);
+            return false;
+        }
+        TreeDump::FileHeader header;
+        if (std::fread(&header, sizeof(header), 1, in) != 1 || std::memcmp(header.magic, TreeDump::FileMagic, sizeof(header.magic)) != 0 ||
+            header.version != TreeDump::FileVersion || header.recordSize != sizeof(Record))
+        {
+            std::fprintf(stderr, "%s is not a tree dump this tool reads\n", path);
+            std::fclose(in);
+            return false;
+        }
+
+        std::vector<Record> records;
+        TreeDump::ChunkHeader chunk;
+        while (std::fread(&chunk, sizeof(chunk), 1, in) == 1)
+        {
+            records.resize(chunk.count);
+            if (std::fread(records.data(), sizeof(Record), chunk.count, in) != chunk.count)
+            {
+                std::fprintf(stderr, "%s ends inside a chunk; the rest is ignored\n", path);
+                break;
+            }
+            f(chunk.thread, records.data(), chunk.count);
+        }
+        std::fclose(in);
+        return true;
+    }
+
+    // Search numbers in order of first appearance
+    struct SearchNumbers
+    {
+        std::map<uint32_t, int> byThread;
+
+        int of(uint32_t thread)
+        {
+            auto found = byThread.find(thread);
+            if (found != byThread.end())
+            {
+                return found->second;
+            }
+            int number = static_cast<int>(byThread.size()) + 1;
+            byThread[thread] = number;
+            return number;
+        }
+    };
+
+    struct PlyStats
+    {
+        uint64_t nodes = 0;
+        uint64_t outcomes[OutcomeCount] = {};
+        uint64_t cutoffsAtFirst = 0; // fail-highs whose first move was enough
+        uint64_t cutoffIndexSum = 0;
+        uint64_t prunedMoves = 0;    // moves left unsearched after the cutoff
+        uint64_t hashMoveNodes = 0;
+        uint64_t hashMoveCutoffs = 0; // fail-highs on the hash move, tried first
+    };
+
+    // What the stats pass remembers about each thread's stream
+    struct StreamState
+    {
+        int search = 0;
+        int iteration = 0;
+        int pvIndex = 0;
+        uint64_t nodes = 0;
+        uint64_t firstLineNodes = 0; // of the latest first multiPV line
+        uint64_t previousNodes = 0;  // of the first line one iteration shallower, 0 if none
+        int rootScore = 0;
+        uint8_t lastIndex[MaxPly + 1] = {}; // move index of the latest node at each ply
+    };
+
+    void printIteration(const StreamState &stream)
+    {
+        if (stream.iteration == 0)
+        {
+            return;
+        }
+        std::printf("{\"search\":%d,\"iteration\":%d,\"pv_index\":%d,\"nodes\":%llu,\"score\":%d", stream.search, stream.iteration,
+                    stream.pvIndex, static_cast<unsigned long long>(stream.nodes), stream.rootScore);
+        if (stream.previousNodes > 0 && stream.pvIndex == 0)
+        {
+            std::printf(",\"branching\":%.2f", static_cast<double>(stream.nodes) / stream.previousNodes);
+        }
+        std::printf("}\n");
+    }
+
+    int runStats(const char *path)
+    {
+        std::map<uint32_t, StreamState> streams;
+        SearchNumbers numbers;
+        std::vector<PlyStats> plies(MaxPly);
+        uint64_t total = 0;
+
+        bool ok = readDump(path, [&](uint32_t thread, const Record *records, uint32_t count)
+                           {
+                               StreamState &stream = streams[thread];
+                               stream.search = numbers.of(thread);
+                               for (uint32_t i = 0; i < count; i++)
+                               {
+                                   const Record &record = records[i];
+                                   if (record.outcome == Outcome::Iteration)
+                                   {
+                                       printIteration(stream);
+                                       if (stream.pvIndex == 0)
+                                       {
+                                           stream.firstLineNodes = stream.nodes;
+                                       }
+                                       if (record.moveIndex == 0)
+                                       {
+                                           stream.previousNodes = record.depth == stream.iteration + 1 ? stream.firstLineNodes : 0;
+                                       }
+                                       stream.iteration = record.depth;
+                                       stream.pvIndex = record.moveIndex;
+                                       stream.nodes = 0;
+                                       continue;
+                                   }
+                                   if (record.ply >= MaxPly)
+                                   {
+                                       continue;
+                                   }
+                                   stream.nodes++;
+                                   total++;
+                                   if (record.ply == 0)
+                                   {
+                                       stream.rootScore = record.score;
+                                   }
+
+                                   PlyStats &ply = plies[record.ply];
+                                   ply.nodes++;
+                                   ply.outcomes[static_cast<int>(record.outcome)]++;
+                                   bool hadHashMove = (record.flags & TreeDump::HadHashMove) != 0;
+                                   ply.hashMoveNodes += hadHashMove;
+                                   // Children come just before their parent, so the last node one ply
+                                   // deeper is the move that caused the cutoff
+                                   if (record.outcome == Outcome::FailHigh && record.ply + 1 < MaxPly)
+                                   {
+                                       int index = stream.lastIndex[record.ply + 1];
+                                       ply.cutoffsAtFirst += index == 0;
+                                       ply.hashMoveCutoffs += index == 0 && hadHashMove;
+                                       ply.cutoffIndexSum += index;
+                                       ply.prunedMoves += record.moveCount > index + 1 ? record.moveCount - index - 1 : 0;
+                                   }
+                                   stream.lastIndex[record.ply] = record.moveIndex;
+                               } });
+        if (!ok)
+        {
+            return 1;
+        }
+        for (auto &entry : streams)
+        {
+            printIteration(entry.second);
+        }
+
+        for (int p = 0; p < MaxPly; p++)
+        {
+            const PlyStats &ply = plies[p];
+            if (ply.nodes == 0)
+            {
+                continue;
+            }
+            std::printf("{\"ply\":%d,\"nodes\":%llu", p, static_cast<unsigned long long>(ply.nodes));
+            for (int outcome = 0; outcome < static_cast<int>(Outcome::Iteration); outcome++)
+            {
+                std::printf(",\"%s\":%llu", OutcomeNames[outcome], static_cast<unsigned long long>(ply.outcomes[outcome]));
+            }
+            uint64_t cutoffs = ply.outcomes[static_cast<int>(Outcome::FailHigh)];
+            if (cutoffs > 0)
+            {
+                std::printf(",\"first_move_cutoff\":%.3f,\"mean_cutoff_index\":%.2f,\"hash_move_cutoff\":%.3f,\"pruned_moves\":%llu",
+                            static_cast<double>(ply.cutoffsAtFirst) / cutoffs, static_cast<double>(ply.cutoffIndexSum) / cutoffs,
+                            static_cast<double>(ply.hashMoveCutoffs) / cutoffs, static_cast<unsigned long long>(ply.prunedMoves));
+            }
+            std::printf(",\"hash_move_share\":%.3f}\n", static_cast<double>(ply.hashMoveNodes) / ply.nodes);
+        }
+        std::printf("{\"summary\":\"tree\",\"searches\":%zu,\"nodes\":%llu}\n", numbers.byThread.size(), static_cast<unsigned long long>(total));
+        return 0;
+    }
+
+    // One iteration's tree rebuilt from its post-order records
+    struct Tree
+    {
+        struct Node
+        {
+            Record record;
+            uint32_t parent = UINT32_MAX;
+            uint32_t firstChild = 0; // into children
+            uint32_t childCount = 0;
+            uint64_t size = 1;       // nodes in the subtree, this one included
+        };
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> children;
+        uint32_t root = UINT32_MAX;
+        uint64_t orphans = 0;
+
+        // Each record adopts the nodes one ply deeper waiting on the stack, which are its children
+        void build(const std::vector<Record> &records)
+        {
+            std::vector<uint32_t> pending;
+            for (const Record &record : records)
+            {
+                uint32_t index = static_cast<uint32_t>(nodes.size());
+                nodes.push_back(Node{record});
+                Node &node = nodes.back();
+
+                size_t first = pending.size();
+                while (first > 0 && nodes[pending[first - 1]].record.ply == record.ply + 1)
+                {
+                    first--;
+                }
+                node.firstChild = static_cast<uint32_t>(children.size());
+                node.childCount = static_cast<uint32_t>(pending.size() - first);
+                for (size_t i = first; i < pending.size(); i++)
+                {
+                    children.push_back(pending[i]);
+                    nodes[pending[i]].parent = index;
+                    node.size += nodes[pending[i]].size;
+                }
+                pending.resize(first);
+                // Anything deeper left behind never got a parent, e.g. a dump cut off mid-search
+                while (!pending.empty() && nodes[pending.back()].record.ply > record.ply)
+                {
+                    orphans += nodes[pending.back()].size;
+                    pending.pop_back();
+                }
+                pending.push_back(index);
+                if (record.ply == 0)
+                {
+                    root = index;
+                }
+            }
+        }
+
+        std::string path(uint32_t index) const
+        {
+            std::vector<std::string> moves;
+            for (; index != root && index != UINT32_MAX; index = nodes[index].parent)
+            {
+                moves.push_back(moveName(nodes[index].record.move));
+            }
+            std::string text;
+            for (auto it = moves.rbegin(); it != moves.rend(); ++it)
+            {
+                text += (text.empty() ? "" : " ") + *it;
+            }
+            return text;
+        }
+
+        std::string describe(uint32_t index) const
+        {
+            std::string moves = path(index);
+            return moves.empty() ? "the root" : "\"" + moves + "\"";
+        }
+
+        // Children ordered largest subtree first
+        std::vector<uint32_t> largestChildren(uint32_t index) const
+        {
+            const Node &node = nodes[index];
+            std::vector<uint32_t> result(children.begin() + node.firstChild, children.begin() + node.firstChild + node.childCount);
+            std::stable_sort(result.begin(), result.end(), [this](uint32_t a, uint32_t b)
+                             { return nodes[a].size > nodes[b].size; });
+            return result;
+        }
+    };
+
+    struct TreeQuery
+    {
+        int search = 0;    // 0 for the last one
+        int iteration = 0; // 0 for the last finished one
+    };
+
+    // Loads the records of the chosen search's iteration, first multiPV line only
+    bool loadIteration(const char *path, const TreeQuery &query, std::vector<Record> &records, int &search, int &iteration)
+    {
+        SearchNumbers numbers;
+        if (!readDump(path, [&](uint32_t thread, const Record *, uint32_t)
+                      { numbers.of(thread); }))
+        {
+            return false;
+        }
+        if (numbers.byThread.empty())
+        {
+            std::fprintf(stderr, "%s holds no searches\n", path);
+            return false;
+        }
+        search = query.search > 0 ? query.search : static_cast<int>(numbers.byThread.size());
+        uint32_t thread = 0;
+        for (auto &entry : numbers.byThread)
+        {
+            if (entry.second == search)
+            {
+                thread = entry.first;
+            }
+        }
+        if (thread == 0)
+        {
+            std::fprintf(stderr, "there is no search %d\n", search);
+            return false;
+        }
+
+        // The last iteration whose root finished, unless a depth was asked for
+        std::vector<Record> stream;
+        readDump(path, [&](uint32_t chunkThread, const Record *chunk, uint32_t count)
+                 {
+                     if (chunkThread == thread)
+                     {
+                         stream.insert(stream.end(), chunk, chunk + count);
+                     } });
+        size_t begin = 0;
+        size_t end = 0;
+        iteration = 0;
+        for (size_t i = 0; i < stream.size(); i++)
+        {
+            const Record &marker = stream[i];
+            if (marker.outcome != Outcome::Iteration || marker.moveIndex != 0 || (query.iteration > 0 && marker.depth != query.iteration))
+            {
+                continue;
+            }
+            for (size_t j = i + 1; j < stream.size() && stream[j].outcome != Outcome::Iteration; j++)
+            {
+                if (stream[j].ply == 0)
+                {
+                    begin = i + 1;
+                    end = j + 1;
+                    iteration = marker.depth;
+                    break;
+                }
+            }
+        }
+        if (iteration == 0)
+        {
+            std::fprintf(stderr, "search %d has no finished iteration%s\n", search, query.iteration > 0 ? " of that depth" : "");
+            return false;
+        }
+        records.assign(stream.begin() + begin, stream.begin() + end);
+        return true;
+    }
+
+    int runHot(const char *path, const TreeQuery &query, int ply, int top)
+    {
+        std::vector<Record> records;
+        int search = 0;
+        int iteration = 0;
+        if (!loadIteration(path, query, records, search, iteration))
+        {
+            return 1;
+        }
+        Tree tree;
+        tree.build(records);
+
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < tree.nodes.size(); i++)
+        {
+            if (tree.nodes[i].record.ply == ply)
+            {
+                candidates.push_back(i);
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [&tree](uint32_t a, uint32_t b)
+                         { return tree.nodes[a].size > tree.nodes[b].size; });
+        if (candidates.size() > static_cast<size_t>(top))
+        {
+            candidates.resize(top);
+        }
+
+        uint64_t total = tree.nodes[tree.root].size;
+        for (uint32_t index : candidates)
+        {
+            const Tree::Node &node = tree.nodes[index];
+            std::printf("{\"search\":%d,\"iteration\":%d,\"path\":\"%s\",\"nodes\":%llu,\"share\":%.4f,\"move_index\":%d,\"depth\":%d,\"alpha\":%d,\"beta\":%d,\"score\":%d,\"outcome\":\"%s\"}\n",
+                        search, iteration, tree.path(index).c_str(), static_cast<unsigned long long>(node.size), static_cast<double>(node.size) / total,
+                        node.record.moveIndex, node.record.depth, node.record.alpha, node.record.beta, node.record.score, outcomeName(node.record.outcome));
+        }
+        std::printf("{\"summary\":\"hot\",\"search\":%d,\"iteration\":%d,\"nodes\":%llu,\"orphans\":%llu}\n", search, iteration,
+                    static_cast<unsigned long long>(total), static_cast<unsigned long long>(tree.orphans));
+        return 0;
+    }
+
+    void exportNode(const Tree &tree, uint32_t index, int plies, int top)
+    {
+        const Tree::Node &node = tree.nodes[index];
+        const Record &record = node.record;
+        std::printf("  n%u [label=\"%s\\n%llu nodes\\n[%d, %d] -> %d\\n%s d%d\"%s];\n", index, moveName(record.move).c_str(),
+                    static_cast<unsigned long long>(node.size), record.alpha, record.beta, record.score, outcomeName(record.outcome), record.depth,
+                    record.outcome == Outcome::FailHigh ? " color=red" : record.outcome == Outcome::Exact ? " color=blue" : "");
+        if (plies == 0)
+        {
+            return;
+        }
+        std::vector<uint32_t> children = tree.largestChildren(index);
+        uint64_t hiddenNodes = 0;
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            if (i < static_cast<size_t>(top))
+            {
+                std::printf("  n%u -> n%u [label=\"#%d\"];\n", index, children[i], tree.nodes[children[i]].record.moveIndex);
+                exportNode(tree, children[i], plies - 1, top);
+            }
+            else
+            {
+                hiddenNodes += tree.nodes[children[i]].size;
+            }
+        }
+        if (children.size() > static_cast<size_t>(top))
+        {
+            std::printf("  n%u_more [label=\"%zu more moves\\n%llu nodes\" shape=plaintext];\n  n%u -> n%u_more [style=dashed];\n", index,
+                        children.size() - top, static_cast<unsigned long long>(hiddenNodes), index, index);
+        }
+    }
+
+    int runExport(const char *path, const TreeQuery &query, const std::string &movePath, int plies, int top)
+    {
+        std::vector<Record> records;
+        int search = 0;
+        int iteration = 0;
+        if (!loadIteration(path, query, records, search, iteration))
+        {
+            return 1;
+        }
+        Tree tree;
+        tree.build(records);
+
+        // Follow the path from the root, one comma-separated move at a time
+        uint32_t index = tree.root;
+        size_t start = 0;
+        while (start < movePath.size())
+        {
+            size_t comma = movePath.find(',', start);
+            std::string move = movePath.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+            start = comma == std::string::npos ? movePath.size() : comma + 1;
+
+            uint32_t next = UINT32_MAX;
+            const Tree::Node &node = tree.nodes[index];
+            for (uint32_t i = 0; i < node.childCount; i++)
+            {
+                uint32_t child = tree.children[node.firstChild + i];
+                if (moveName(tree.nodes[child].record.move) == move)
+                {
+                    next = child;
+                }
+            }
+            if (next == UINT32_MAX)
+            {
+                std::fprintf(stderr, "%s was not searched from %s\n", move.c_str(), tree.describe(index).c_str());
+                return 1;
+            }
+            index = next;
+        }
+
+        std::printf("digraph tree {\n  // search %d, iteration %d, from %s\n  node [shape=box fontname=monospace];\n", search, iteration,
+                    tree.describe(index).c_str());
+        exportNode(tree, index, plies, top);
+        std::printf("}\n");
+        return 0;
+    }
+
+    void usage(const char *program)
+    {
+        std::fprintf(stderr,
+                     "usage: %s stats FILE\n"
+                     "       %s hot FILE [--search N] [--iteration D] [--ply P] [--top K]\n"
+                     "       %s export FILE [--search N] [--iteration D] [--path m1,m2,...] [--plies N] [--top K]\n",
+                     program, program, program);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string mode = argv[1];
+    const char *path = argv[2];
+    TreeQuery query;
+    int ply = 1;
+    int plies = 3;
+    int top = 10;
+    bool topGiven = false;
+    std::string movePath;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--search") == 0 && i + 1 < argc)
+        {
+            query.search = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--iteration") == 0 && i + 1 < argc)
+        {
+            query.iteration = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--ply") == 0 && i + 1 < argc)
+        {
+            ply = std::min(MaxPly - 1, std::max(1, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--plies") == 0 && i + 1 < argc)
+        {
+            plies = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+        {
+            top = std::max(1, std::atoi(argv[++i]));
+            topGiven = true;
+        }
+        else if (std::strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+        {
+            movePath = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (mode == "stats")
+    {
+        return runStats(path);
+    }
+    if (mode == "hot")
+    {
+        return runHot(path, query, ply, top);
+    }
+    if (mode == "export")
+    {
+        return runExport(path, query, movePath, plies, topGiven ? top : 5);
+    }
+    usage(argv[0]);
+    return 1;
+}